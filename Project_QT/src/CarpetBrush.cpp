@@ -467,7 +467,7 @@ void CarpetBrush::draw(Map* map, Tile* tile, void* parameter) {
         Item* newItem = ItemManager::instance()->createItem(itemIdToPlace);
         if (newItem) {
             tile->addItem(newItem);
-            map->markModified();
+            map->markModified(tile);
             doCarpets(map, tile);
             for (int dx = -1; dx <= 1; ++dx) {
                 for (int dy = -1; dy <= 1; ++dy) {
@@ -484,21 +484,19 @@ void CarpetBrush::draw(Map* map, Tile* tile, void* parameter) {
 
 void CarpetBrush::undraw(Map* map, Tile* tile) {
     if (!map || !tile) return;
-    QMutableVectorIterator<Item*> it(tile->items());
     bool changed = false;
-    while (it.hasNext()) {
-        Item* item = it.next();
+    for (int i = tile->getItems().size() - 1; i >= 0; --i) {
+        Item* item = tile->getItems().at(i);
         if (item && item->isCarpet()) {
             Brush* itemBrush = item->getBrush();
             if (itemBrush == this) {
-                it.remove();
-                delete item;
+                tile->removeItem(item); // Deletes it, updates HasCarpet and marks the tile modified
                 changed = true;
             }
         }
     }
     if (changed) {
-        map->markModified();
+        map->markModified(tile);
         for (int dx = -1; dx <= 1; ++dx) {
             for (int dy = -1; dy <= 1; ++dy) {
                 Tile* neighbor_or_self = map->getTile(tile->x() + dx, tile->y() + dy, tile->z());
@@ -574,7 +572,9 @@ void CarpetBrush::doCarpets(Map* map, Tile* tile) {
     int y = pos.y();
     int z = tile->z();
 
-    for (Item* item : tile->items()) {
+    // Backwards by index: pieces without a replacement are removed from the tile below.
+    for (int i = tile->getItems().size() - 1; i >= 0; --i) {
+        Item* item = tile->getItems().at(i);
         if (!item || !item->isCarpet()) continue;
 
         CarpetBrush* itemCarpetBrush = dynamic_cast<CarpetBrush*>(item->getBrush());
@@ -599,20 +599,11 @@ void CarpetBrush::doCarpets(Map* map, Tile* tile) {
         }
 
         if (newItemId == 0) { // No suitable carpet piece found, remove existing
-            QMutableVectorIterator<Item*> it_remove(tile->items());
-            while(it_remove.hasNext()){
-                if(it_remove.next() == item){
-                    it_remove.remove();
-                    delete item;
-                    map->markModified();
-                    break;
-                }
-            }
+            tile->removeItem(item);
+            map->markModified(tile);
         } else if (item->getServerId() != newItemId) {
-            item->setServerId(newItemId);
-            const ItemProperties& newProps = ItemManager::instance()->getItemProperties(newItemId);
-            if(newProps.serverId != 0) item->setClientId(newProps.clientId);
-            map->markModified();
+            item->setServerId(newItemId); // Client id and flags follow from the new type
+            map->markModified(tile);
         }
     }
     // tile->update(); // Tile::update() should correctly set HasCarpet flag.
@@ -2,6 +2,8 @@
 #include "Brush.h" // For Brush* type
 #include <QPainter> // For draw method
 #include <QColor>   // For draw method placeholder
+#include "OutfitCompositor.h" // Outfit images for draw
+#include "Outfit.h"
 #include <QDebug>
 // DrawingOptions.h is included via Creature.h
 
@@ -264,7 +266,29 @@ Creature* Creature::deepCopy() const {
 void Creature::draw(QPainter* painter, const QRectF& targetRect, const DrawingOptions& options) const {
     if (!painter) return;
 
-    // Placeholder: Draw a semi-transparent reddish rectangle for a creature
+    if (options.outfits) {
+        Outfit look;
+        look.lookType = lookType_;
+        look.lookHead = lookHead_;
+        look.lookBody = lookBody_;
+        look.lookLegs = lookLegs_;
+        look.lookFeet = lookFeet_;
+        look.lookAddon = lookAddons_;
+        // Shared with every creature of the same look; recolored once (see OutfitCompositor).
+        const QImage image = options.outfits->outfitImage(look, static_cast<int>(direction_), 0);
+        if (!image.isNull()) {
+            // Outfits bigger than a tile extend up and to the left of it, like items.
+            const qreal scale = targetRect.width() / 32.0;
+            const QSizeF size(image.width() * scale, image.height() * scale);
+            painter->save();
+            painter->setOpacity(painter->opacity() * options.creatureOpacity);
+            painter->drawImage(QRectF(targetRect.bottomRight() - QPointF(size.width(), size.height()), size), image);
+            painter->restore();
+            return;
+        }
+    }
+
+    // Placeholder (no outfit compositor, or no sprite for the look type): Draw a semi-transparent reddish rectangle for a creature
     QColor creatureColor = Qt::red;
     // Vary color based on lookType_
     if (lookType_ != 0) { 
@@ -1,12 +1,12 @@
 #include "CreatureSpriteManager.h"
-// GameSprite.h is already included in CreatureSpriteManager.h for Outfit
-// #include "GraphicManager.h" // Dependency to be managed if actual GameSprites are fetched
+#include "OutfitCompositor.h"
 #include <QImage>
 #include <QPixmap> // Added for QPixmap
 #include <QPainter> 
 #include <QDebug>
 
-CreatureSpriteManager::CreatureSpriteManager() {
+CreatureSpriteManager::CreatureSpriteManager(OutfitCompositor& compositor) :
+    m_compositor(compositor) {
 }
 
 CreatureSpriteManager::~CreatureSpriteManager() {
@@ -17,19 +17,24 @@ void CreatureSpriteManager::clear() {
     m_sprite_pixmap_cache.clear();
 }
 
-QString CreatureSpriteManager::generateCacheKey(int looktype, const Outfit* outfit_ptr, int width, int height) const {
-    QString key = QString("lt:%1_w:%2_h:%3")
-                      .arg(looktype)
-                      .arg(width)
-                      .arg(height);
-    if (outfit_ptr) { 
-        key += QString("_head:%1_body:%2_legs:%3_feet:%4")
-                   .arg(outfit_ptr->lookHead)
-                   .arg(outfit_ptr->lookBody)
-                   .arg(outfit_ptr->lookLegs)
-                   .arg(outfit_ptr->lookFeet);
-    }
-    return key;
+CreatureSpriteManager::PixmapKey CreatureSpriteManager::generateCacheKey(int looktype, const Outfit& outfit, int width, int height) {
+    Outfit look = outfit;
+    look.lookType = looktype;
+    return PixmapKey(OutfitCompositor::lookKey(look, OutfitCompositor::South, 0),
+                     (quint32(width & 0xFFFF) << 16) | quint32(height & 0xFFFF));
+}
+
+QImage CreatureSpriteManager::placeholderImage() {
+    // Cyan square with the four template mask colors in its top left corner.
+    QImage image(32, 32, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::cyan);
+    QPainter painter(&image);
+    painter.fillRect(0, 0, 8, 8, QColor(255, 255, 0));
+    painter.fillRect(8, 0, 8, 8, QColor(255, 0, 0));
+    painter.fillRect(0, 8, 8, 8, QColor(0, 255, 0));
+    painter.fillRect(8, 8, 8, 8, QColor(0, 0, 255));
+    painter.end();
+    return image;
 }
 
 QPixmap CreatureSpriteManager::getSpritePixmap(int looktype, int width, int height) {
@@ -39,18 +44,20 @@ QPixmap CreatureSpriteManager::getSpritePixmap(int looktype, int width, int heig
 }
 
 QPixmap CreatureSpriteManager::getSpritePixmap(int looktype, const Outfit& outfit, int width, int height) {
-    QString key = generateCacheKey(looktype, &outfit, width, height);
-    
-    if (m_sprite_pixmap_cache.contains(key)) {
-        return m_sprite_pixmap_cache.value(key);
+    const PixmapKey key = generateCacheKey(looktype, outfit, width, height);
+    const auto cached = m_sprite_pixmap_cache.constFind(key);
+    if (cached != m_sprite_pixmap_cache.constEnd()) {
+        return cached.value();
     }
     
     QPixmap pixmap = createSpritePixmap(looktype, outfit, width, height);
     if (!pixmap.isNull()) {
         m_sprite_pixmap_cache.insert(key, pixmap);
     } else {
-        qWarning() << "CreatureSpriteManager: createSpritePixmap returned null for key" << key;
-        return QPixmap(width, height); 
+        qWarning() << "CreatureSpriteManager: createSpritePixmap returned null for looktype" << looktype;
+        QPixmap empty(width, height);
+        empty.fill(Qt::transparent);
+        return empty;
     }
     return pixmap;
 }
@@ -78,34 +85,15 @@ QPixmap CreatureSpriteManager::createSpritePixmap(int looktype, int width, int h
 }
 
 QPixmap CreatureSpriteManager::createSpritePixmap(int looktype, const Outfit& outfit, int target_width, int target_height) {
-    QSharedPointer<GameSprite> base_game_sprite = QSharedPointer<GameSprite>(new GameSprite());
-    if (base_game_sprite->getImage().isNull() || base_game_sprite->getImage().size().isEmpty()) {
-        QImage dummy_base(32,32, QImage::Format_ARGB32_Premultiplied);
-        dummy_base.fill(Qt::cyan); 
-        for(int y=0; y < 8; ++y) for(int x=0; x < 8; ++x) dummy_base.setPixelColor(x,y, QColor(255,255,0));
-        for(int y=0; y < 8; ++y) for(int x=8; x < 16; ++x) dummy_base.setPixelColor(x,y, QColor(255,0,0));
-        for(int y=8; y < 16; ++y) for(int x=0; x < 8; ++x) dummy_base.setPixelColor(x,y, QColor(0,255,0));
-        for(int y=8; y < 16; ++y) for(int x=8; x < 16; ++x) dummy_base.setPixelColor(x,y, QColor(0,0,255));
-        base_game_sprite->setImage(dummy_base);
-        base_game_sprite->sprite_parts.append(dummy_base); 
-        base_game_sprite->width = 1; base_game_sprite->height = 1; 
-        base_game_sprite->layers = 1; base_game_sprite->frames = 1;
-        base_game_sprite->pattern_x =1; base_game_sprite->pattern_y =1; base_game_sprite->pattern_z = 1;
-    }
-
-    if (!base_game_sprite || base_game_sprite->getImage().isNull()) { 
-        qWarning() << "CreatureSpriteManager: Could not get/create base GameSprite for looktype" << looktype;
-        return QPixmap(); 
-    }
-
-    QImage source_image_part = base_game_sprite->getSpritePart(0,0,0,0,0,0,0); 
-    if(source_image_part.isNull()) source_image_part = base_game_sprite->getImage(); 
-
-    QImage colorized_image = base_game_sprite->colorizeSpritePart(source_image_part, outfit);
+    // The compositor recolors through the template mask and shares the result with every
+    // creature of the same look; only the scaling to the palette size happens here.
+    Outfit look = outfit;
+    look.lookType = looktype;
+    QImage colorized_image = m_compositor.outfitImage(look, OutfitCompositor::South, 0);
 
     if (colorized_image.isNull()) {
-        qWarning() << "CreatureSpriteManager: Colorization resulted in null image for looktype" << looktype;
-        return QPixmap();
+        qWarning() << "CreatureSpriteManager: No outfit image for looktype" << looktype << "; using a placeholder.";
+        colorized_image = placeholderImage();
     }
     
     QImage final_image = colorized_image.scaled(target_width, target_height, Qt::KeepAspectRatio, Qt::SmoothTransformation);
@@ -1,7 +1,8 @@
 #ifndef CREATURESPRITEMANAGER_H
 #define CREATURESPRITEMANAGER_H
 
-#include <QMap>
+#include <QHash>
+#include <QPair>
 #include <QString>
 #include <QSharedPointer> 
 #include <QVector> 
@@ -9,6 +10,9 @@
 #include <QPixmap> 
 
 #include "GameSprite.h" 
+#include "Outfit.h"
+
+class OutfitCompositor;
 
 class Brush {}; 
 class CreatureBrush : public Brush { 
@@ -24,9 +28,11 @@ public:
 };
 using BrushVector = QVector<CreatureBrush*>; 
 
+// Palette-sized creature pixmaps. The outfits are rendered (and shared) by the compositor,
+// which must outlive this manager; looks it has no image for get a visible placeholder.
 class CreatureSpriteManager {
 public:
-    CreatureSpriteManager();
+    explicit CreatureSpriteManager(OutfitCompositor& compositor);
     ~CreatureSpriteManager();
 
     QPixmap getSpritePixmap(int looktype, int width = 32, int height = 32);
@@ -36,12 +42,16 @@ public:
     void clear();
 
 private:
-    QMap<QString, QPixmap> m_sprite_pixmap_cache; 
-    
+    // Keyed by the outfit's OutfitCompositor::lookKey() and the packed pixmap size.
+    using PixmapKey = QPair<quint64, quint32>;
+    QHash<PixmapKey, QPixmap> m_sprite_pixmap_cache;
+    OutfitCompositor& m_compositor;
+
     QPixmap createSpritePixmap(int looktype, int width, int height); 
     QPixmap createSpritePixmap(int looktype, const Outfit& outfit, int width, int height); 
 
-    QString generateCacheKey(int looktype, const Outfit* outfit_ptr, int width, int height) const;
+    static PixmapKey generateCacheKey(int looktype, const Outfit& outfit, int width, int height);
+    static QImage placeholderImage();
 };
 
 #endif // CREATURESPRITEMANAGER_H
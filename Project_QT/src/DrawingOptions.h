@@ -4,6 +4,10 @@
 // No external includes needed for these simple types,
 // unless a very specific type from another header was used (not the case here).
 
+class OutfitCompositor;
+class SpriteManager;
+class SpriteAtlasBatch;
+
 struct DrawingOptions {
     bool showGround = true;
     bool showItems = true;
@@ -24,6 +28,16 @@ struct DrawingOptions {
     bool highlightSelectedTile = true; // If the tile itself should indicate selection
     bool drawDebugInfo = false;      // For drawing bounding boxes, IDs, etc.
 
+    // Renders creature outfits when set (MapView sets it, see MapView::setSpriteManager);
+    // without it creatures are drawn as placeholders. Not owned.
+    OutfitCompositor* outfits = nullptr;
+
+    // Item sprites, set by MapView for the duration of a frame (see drawVisibleTiles). Items
+    // add their atlas frames to spriteBatch rather than painting them, so anything painted
+    // directly in between must flush the batch first to keep the stacking order. Not owned.
+    SpriteManager* sprites = nullptr;
+    SpriteAtlasBatch* spriteBatch = nullptr;
+
     // Default constructor
     DrawingOptions() {
         // Initialize to default sensible values
@@ -41,6 +55,9 @@ struct DrawingOptions {
         creatureOpacity = 1.0f;
         highlightSelectedTile = true;
         drawDebugInfo = false;
+        outfits = nullptr;
+        sprites = nullptr;
+        spriteBatch = nullptr;
     }
 };
 
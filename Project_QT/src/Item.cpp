@@ -3,14 +3,19 @@
 #include <QPainter> // For drawText and draw
 #include <QRectF>   // For drawText and draw
 #include <QColor>   // For draw method placeholder
-#include "ItemManager.h" // Required for ItemTypeData access
-#include "Brush.h"       // Required for Brush* return type and itemTypeData->brush
-#include <QDataStream>  // For unserializeOtbmAttributes
-#include <QByteArray>   // For unserializeOtbmAttributes
-#include <QIODevice>    // For QDataStream operations (usually included by QDataStream)
-#include "Tile.h"        // For qobject_cast<Tile*> in setModified
+#include "ItemManager.h" // Required for ItemProperties access
+#include "Brush.h"       // Required for Brush* return type and ItemProperties::brush
+#include <QtEndian>     // For qFromLittleEndian/qToLittleEndian in the OTBM attribute code
+#include <QHash>        // For the attribute name lookup
+#include <QByteArray>
+#include "Tile.h"        // For Tile::setModified in setModified
 
 #include "OtbmTypes.h" // For OTBM attribute enums
+#include "io/OtbmWriter.h" // For serializeOtbmNode
+#include "io/MapSnapshot.h" // For the snapshot item records
+#include <QDataStream>  // Snapshot encoding of ItemExtraAttributes
+#include "SpriteManager.h" // Item frames for draw
+#include "SpriteAtlas.h"
 
 // TODO (Task51): Implement client version specific logic for item attribute deserialization.
 // This might involve:
@@ -36,301 +41,362 @@ const QString Item::AttrTeleDestY = QStringLiteral("teleportDestY");
 const QString Item::AttrTeleDestZ = QStringLiteral("teleportDestZ");
 const QString Item::AttrDepotID = QStringLiteral("depotId");
 
-Item::Item(quint16 serverId, QObject *parent) : QObject(parent),
-    serverId_(serverId),
-    clientId_(0), // Typically set by ItemManager based on serverId_
-    // name_ is default QString()
-    // itemTypeName_ is default QString()
-    // Boolean flags default to false as per their declaration in the header
-    isMoveable_(false),
-    isBlocking_(true), // Default most items to blocking as per typical RME behavior
-    blocksMissiles_(true),
-    blocksPathfind_(true),
-    isStackable_(false),
-    isGroundTile_(false),
-    isAlwaysOnTop_(false),
-    topOrder_(1), // Default topOrder (0=ground, 1=on_ground, 2=creature/top, 3=always_on_top)
-    isTeleport_(false),
-    isContainer_(false),
-    isReadable_(false),
-    canWriteText_(false),
-    isPickupable_(true), // Most items are pickupable by default
-    isRotatable_(false),
-    isHangable_(false),
-    hasHookSouth_(false),
-    hasHookEast_(false),
-    hasHeight_(false),
-    // Initialize new dedicated members
-    description_(""),
-    editorSuffix_(""),
-    itemGroup_(ITEM_GROUP_NONE),
-    itemType_(ITEM_TYPE_NONE),
-    weight_(0.0f),
-    attack_(0),
-    defense_(0),
-    armor_(0),
-    charges_(0),
-    maxTextLen_(0),
-    rotateTo_(0),
-    volume_(0),
-    slotPosition_(0),
-    weaponType_(0), // Assuming 0 is WEAPON_NONE or similar default
-    lightLevel_(0),
-    lightColor_(0),
-    classification_(0)
+Item::Item(quint16 serverId) :
+    serverId_(serverId)
 {
-    // Name, ClientID, and flags are often set by an ItemManager after creation
-    // based on the serverId by reading an items.xml or similar definition file.
-    // The new dedicated members would also typically be set by ItemManager.
+    // Type data (name, client id, flags, ...) is not copied into the instance;
+    // it is read from ItemManager's shared ItemProperties for serverId_ on demand.
 }
 
+static_assert(sizeof(Item) <= MapArena::MaxObjectSize, "Items must be block-allocated for MapArena::arenaOf");
+
 Item::~Item() {
-    // attributes_ QMap<QString, QVariant> manages its own memory.
-    // QObject parent will handle deletion if parented.
+    // extra_ releases the shared attribute block once the last copy is gone.
+    // The owning Tile deletes its items.
+    untrack();
 }
 
-void Item::setModified(bool modified) {
-    if (m_modified != modified) {
-        m_modified = modified;
-        if (m_modified) { // Only propagate upwards if item becomes modified
-            // Attempt to get Tile* from parent.
-            // This assumes Item is directly parented to Tile.
-            // If there's an intermediate QObject, this cast might fail or need adjustment.
-            QObject* p = parent();
-            if (p) {
-                // Check if parent is a Tile. This requires RTTI if Tile is not QObject base.
-                // For now, assume Tile is a QObject or inherits it.
-                // #include "Tile.h" // Make sure Tile.h is included in Item.cpp
-                // Tile* tile = qobject_cast<Tile*>(p);
-                // For now, to avoid circular dependency issues if Tile.h isn't already included
-                // for other reasons, we'll just log a placeholder or emit a generic signal.
-                // A more robust solution might involve a signal/slot mechanism if direct casting is problematic,
-                // or ensuring Tile is forward-declared and qobject_cast can work.
-                // The prompt implies qobject_cast<Tile*>(parent()) should work.
-                // This requires Tile to be a QObject and Tile.h to be included.
-                // Assuming Tile.h will be included for qobject_cast<Tile*> to compile.
-                // Let's add a placeholder for Tile.h inclusion if not present.
-                // #include "Tile.h" // If not already included
-                Tile* tile = qobject_cast<Tile*>(p); // Requires "Tile.h"
-                if (tile) {
-                    tile->setModified(true);
-                } else {
-                    // Optional: Log if parent is not a Tile, as propagation won't occur.
-                    // qDebug() << "Item::setModified - Parent is not a Tile, modified state not propagated to Tile.";
-                }
-            }
+void Item::setOwnerTile(Tile* tile) {
+    if (tile == ownerTile_) {
+        return;
+    }
+    untrack();
+    const bool wasOnTile = ownerTile_ != nullptr;
+    ownerTile_ = tile;
+    if (tile) {
+        trackOnOwnerTile();
+    } else if (wasOnTile) {
+        // Now held by an undo command, the clipboard, ...; the map's arena must not drop it.
+        MapArena::pin(this);
+        arenaState_ = ArenaState::Pinned;
+    }
+}
+
+void Item::trackOnOwnerTile() {
+    MapArena* tileArena = MapArena::arenaOf(ownerTile_);
+    if (!tileArena || arenaState_ != ArenaState::Untracked) {
+        return;
+    }
+    // Items in the tile's own arena go with it, unless they own an attribute block.
+    if (extra_ || MapArena::arenaOf(this) != tileArena) {
+        tileArena->addFinalizer(this, &Item::finalize);
+        arenaState_ = ArenaState::Finalized;
+    }
+}
+
+void Item::untrack() {
+    if (arenaState_ == ArenaState::Finalized) {
+        if (MapArena* tileArena = MapArena::arenaOf(ownerTile_)) {
+            tileArena->removeFinalizer(this);
         }
-        // Optionally, emit a signal if needed: emit modifiedStatusChanged(m_modified);
+    } else if (arenaState_ == ArenaState::Pinned) {
+        MapArena::unpin(this);
     }
+    arenaState_ = ArenaState::Untracked;
+}
+
+void Item::finalize(void* object) {
+    Item* item = static_cast<Item*>(object);
+    item->arenaState_ = ArenaState::Untracked; // The arena has already removed the entry
+    if (MapArena::arenaOf(item) == MapArena::arenaOf(item->ownerTile_)) {
+        item->extra_.reset(); // The item itself is dropped with the arena
+    } else {
+        delete item; // Allocated elsewhere (e.g. by a brush outside the map's arena scope)
+    }
+}
+
+void Item::setModified(bool modified) {
+    m_modified = modified;
+    // Propagate every modification, not only the first one: the owning tile's map area has
+    // to be re-serialized on the next save even if the item was already flagged.
+    if (modified && ownerTile_) {
+        // Tiles are not QObjects, so the owning tile is tracked explicitly
+        // (see Tile::addItem/setGround) instead of via parent().
+        ownerTile_->setModified(true);
+    }
+    // Optionally, emit a signal if needed: emit modifiedStatusChanged(m_modified);
 }
 
 // Core Properties
 quint16 Item::getServerId() const { return serverId_; }
 void Item::setServerId(quint16 id) { 
     if (serverId_ != id) {
-        quint16 oldId = serverId_;
-        serverId_ = id;
-        qDebug() << "Item serverId changed from" << oldId << "to" << serverId_ << "(Warning: This is unusual)";
-        emit propertyChanged();
+        serverId_ = id; // All type-level data now comes from the new id's ItemProperties
+        setModified(true);
     }
 }
 
-quint16 Item::getClientId() const { return clientId_; }
-void Item::setClientId(quint16 id) {
-    if (clientId_ != id) {
-        clientId_ = id;
-        setModified(true);
-        emit propertyChanged(); 
-    }
+quint16 Item::getClientId() const { return type().clientId; }
+
+QString Item::name() const { return typeText().name; }
+
+QString Item::typeName() const { return typeText().name; }
+
+// Typed Attribute Storage
+static_assert(static_cast<int>(Item::AttributeKey::Last) <= 16, "attrMask_ has one bit per typed attribute key");
+
+namespace {
+// Indexed by Item::AttributeKey; must follow the enum order.
+const QString* const kAttributeNames[] = {
+    &Item::AttrCount, &Item::AttrActionID, &Item::AttrUniqueID, &Item::AttrCharges,
+    &Item::AttrText, &Item::AttrDescription, &Item::AttrWriter, &Item::AttrArticle,
+    &Item::AttrDuration, &Item::AttrDepotID, &Item::AttrTier,
+    &Item::AttrTeleDestX, &Item::AttrTeleDestY, &Item::AttrTeleDestZ
+};
+static_assert(sizeof(kAttributeNames) / sizeof(kAttributeNames[0]) == static_cast<size_t>(Item::AttributeKey::Last),
+              "kAttributeNames must list every typed attribute key");
+} // namespace
+
+Item::AttributeKey Item::attributeKey(const QString& name) {
+    static const QHash<QString, AttributeKey> keys = [] {
+        QHash<QString, AttributeKey> h;
+        for (int i = 0; i < static_cast<int>(AttributeKey::Last); ++i) {
+            h.insert(*kAttributeNames[i], static_cast<AttributeKey>(i));
+        }
+        return h;
+    }();
+    return keys.value(name, AttributeKey::Custom);
 }
 
-QString Item::name() const { return name_; }
-void Item::setName(const QString& name) {
-    if (name_ != name) {
-        name_ = name;
-        setModified(true);
-        emit propertyChanged();
-    }
+QString Item::attributeName(AttributeKey key) {
+    if (key >= AttributeKey::Last) return QString();
+    return *kAttributeNames[static_cast<int>(key)];
 }
 
-QString Item::typeName() const { return itemTypeName_; }
-void Item::setTypeName(const QString& typeName) {
-    if (itemTypeName_ != typeName) {
-        itemTypeName_ = typeName;
-        setModified(true);
-        emit propertyChanged();
+const ItemExtraAttributes& Item::extra() const {
+    static const ItemExtraAttributes empty;
+    return extra_ ? *extra_ : empty;
+}
+
+ItemExtraAttributes& Item::extraForWrite() {
+    if (!extra_) {
+        extra_.reset(new ItemExtraAttributes);
+        if (ownerTile_) {
+            trackOnOwnerTile(); // Can no longer be dropped without running its destructor
+        }
     }
+    return *extra_; // Detaches if shared with a copy
+}
+
+QVariant Item::getAttribute(AttributeKey key, const QVariant& defaultValue) const {
+    if (!hasAttribute(key)) {
+        return defaultValue;
+    }
+    const ItemExtraAttributes& ex = extra();
+    switch (key) {
+        case AttributeKey::Count:       return count_;
+        case AttributeKey::ActionId:    return actionId_;
+        case AttributeKey::UniqueId:    return uniqueId_;
+        case AttributeKey::Charges:     return charges_;
+        case AttributeKey::Text:        return ex.text;
+        case AttributeKey::Description: return ex.description;
+        case AttributeKey::Writer:      return ex.writer;
+        case AttributeKey::Article:     return ex.article;
+        case AttributeKey::Duration:    return ex.duration;
+        case AttributeKey::DepotId:     return ex.depotId;
+        case AttributeKey::Tier:        return ex.tier;
+        case AttributeKey::TeleDestX:   return ex.teleDestX;
+        case AttributeKey::TeleDestY:   return ex.teleDestY;
+        case AttributeKey::TeleDestZ:   return ex.teleDestZ;
+        default:                        return defaultValue;
+    }
+}
+
+void Item::setAttribute(AttributeKey key, const QVariant& value) {
+    if (key >= AttributeKey::Last) {
+        qWarning() << "Item::setAttribute - Not a typed attribute key:" << static_cast<int>(key);
+        return;
+    }
+    if (!value.isValid()) {
+        clearAttribute(key);
+        return;
+    }
+    if (hasAttribute(key) && getAttribute(key) == value) {
+        return;
+    }
+
+    switch (key) {
+        case AttributeKey::Count:       count_ = static_cast<quint16>(value.toUInt()); break;
+        case AttributeKey::ActionId:    actionId_ = static_cast<quint16>(value.toUInt()); break;
+        case AttributeKey::UniqueId:    uniqueId_ = static_cast<quint16>(value.toUInt()); break;
+        case AttributeKey::Charges:     charges_ = static_cast<quint16>(value.toUInt()); break;
+        case AttributeKey::Text:        extraForWrite().text = value.toString(); break;
+        case AttributeKey::Description: extraForWrite().description = value.toString(); break;
+        case AttributeKey::Writer:      extraForWrite().writer = value.toString(); break;
+        case AttributeKey::Article:     extraForWrite().article = value.toString(); break;
+        case AttributeKey::Duration:    extraForWrite().duration = value.toUInt(); break;
+        case AttributeKey::DepotId:     extraForWrite().depotId = static_cast<quint16>(value.toUInt()); break;
+        case AttributeKey::Tier:        extraForWrite().tier = static_cast<quint16>(value.toUInt()); break;
+        case AttributeKey::TeleDestX:   extraForWrite().teleDestX = static_cast<quint16>(value.toUInt()); break;
+        case AttributeKey::TeleDestY:   extraForWrite().teleDestY = static_cast<quint16>(value.toUInt()); break;
+        case AttributeKey::TeleDestZ:   extraForWrite().teleDestZ = static_cast<quint8>(value.toUInt()); break;
+        default: break;
+    }
+    attrMask_ |= attributeBit(key);
+    setModified(true);
+}
+
+void Item::clearAttribute(AttributeKey key) {
+    if (key >= AttributeKey::Last || !hasAttribute(key)) {
+        return;
+    }
+    attrMask_ &= ~attributeBit(key);
+    switch (key) {
+        case AttributeKey::Count:    count_ = 0; break;
+        case AttributeKey::ActionId: actionId_ = 0; break;
+        case AttributeKey::UniqueId: uniqueId_ = 0; break;
+        case AttributeKey::Charges:  charges_ = 0; break;
+        default: break; // Values in extra_ are ignored while their bit is clear
+    }
+    setModified(true);
 }
 
 // Generic Attribute System
 void Item::setAttribute(const QString& key, const QVariant& value) {
-    QVariant oldValue = attributes_.value(key);
-    if (oldValue != value) {
-        attributes_.insert(key, value);
+    const AttributeKey typedKey = attributeKey(key);
+    if (typedKey != AttributeKey::Custom) {
+        setAttribute(typedKey, value);
+        return;
+    }
+    if (!value.isValid()) {
+        clearAttribute(key);
+        return;
+    }
+    if (extra().custom.value(key) != value) {
+        extraForWrite().custom.insert(key, value);
         setModified(true);
-        emit attributeChanged(key, value);
     }
 }
 
 QVariant Item::getAttribute(const QString& key, const QVariant& defaultValue) const {
-    return attributes_.value(key, defaultValue);
+    const AttributeKey typedKey = attributeKey(key);
+    if (typedKey != AttributeKey::Custom) {
+        return getAttribute(typedKey, defaultValue);
+    }
+    return extra().custom.value(key, defaultValue);
 }
 
 bool Item::hasAttribute(const QString& key) const {
-    return attributes_.contains(key);
+    const AttributeKey typedKey = attributeKey(key);
+    if (typedKey != AttributeKey::Custom) {
+        return hasAttribute(typedKey);
+    }
+    return extra().custom.contains(key);
 }
 
 void Item::clearAttribute(const QString& key) {
-    if (attributes_.remove(key)) {
+    const AttributeKey typedKey = attributeKey(key);
+    if (typedKey != AttributeKey::Custom) {
+        clearAttribute(typedKey);
+        return;
+    }
+    if (extra().custom.contains(key) && extraForWrite().custom.remove(key)) {
         setModified(true);
-        emit attributeChanged(key, QVariant());
     }
 }
 
-const QMap<QString, QVariant>& Item::getAttributes() const {
-    return attributes_;
-}
-
-// Specific Attribute Accessors
-int Item::getCount() const {
-    if (isStackable_) {
-        return getAttribute(Item::AttrCount, 1).toInt();
+QMap<QString, QVariant> Item::getAttributes() const {
+    QMap<QString, QVariant> result = extra().custom;
+    for (int i = 0; i < static_cast<int>(AttributeKey::Last); ++i) {
+        const AttributeKey key = static_cast<AttributeKey>(i);
+        if (hasAttribute(key)) {
+            result.insert(*kAttributeNames[i], getAttribute(key));
+        }
     }
-    return 1;
+    return result;
 }
 
+// Specific Attribute Accessors
 void Item::setCount(int count) {
-    if (isStackable_) {
+    if (type().isStackable) {
         if (count <= 0) count = 1;
-        setAttribute(Item::AttrCount, count); // This emits attributeChanged
-        // No direct member for stackable count other than through attributes_
+        setAttribute(AttributeKey::Count, count); // Marks the item (and its tile) modified
     } else if (count != 1) {
-        // qWarning() << "Item (ID:" << serverId_ << ", Name:" << name_ << ") is not stackable, cannot set count to" << count;
+        // qWarning() << "Item (ID:" << serverId_ << ", Name:" << name() << ") is not stackable, cannot set count to" << count;
     }
 }
 
 QString Item::getText() const {
-    return getAttribute(Item::AttrText).toString();
+    return hasAttribute(AttributeKey::Text) ? extra().text : QString();
 }
 void Item::setText(const QString& text) {
-    // This setter will update attributes_ and emit attributeChanged.
-    // If there was a direct member like text_, it would be set here too.
-    setAttribute(Item::AttrText, text);
+    setAttribute(AttributeKey::Text, text);
 }
 
-int Item::getActionId() const {
-    // Assuming actionId is primarily stored in attributes_
-    return getAttribute(Item::AttrActionID).toInt();
-}
 void Item::setActionId(int id) {
-    // This setter will update attributes_ and emit attributeChanged.
-    // If there was a direct member like actionId_, it would be set here too.
-    setAttribute(Item::AttrActionID, id);
+    setAttribute(AttributeKey::ActionId, id);
 }
 
-int Item::getUniqueId() const {
-    // Assuming uniqueId is primarily stored in attributes_
-    return getAttribute(Item::AttrUniqueID).toInt();
-}
 void Item::setUniqueId(int id) {
-    // This setter will update attributes_ and emit attributeChanged.
-    // If there was a direct member like uniqueId_, it would be set here too.
-    setAttribute(Item::AttrUniqueID, id);
-}
-
-// Boolean Flag Getters/Setters
-#define ITEM_BOOL_PROPERTY_IMPL(PropNameCapital, MemberName) \
-bool Item::is##PropNameCapital() const { return MemberName; } \
-void Item::set##PropNameCapital(bool on) { if (MemberName != on) { MemberName = on; setModified(true); emit propertyChanged(); } }
-
-ITEM_BOOL_PROPERTY_IMPL(Moveable, isMoveable_)
-ITEM_BOOL_PROPERTY_IMPL(Blocking, isBlocking_)
-ITEM_BOOL_PROPERTY_IMPL(Stackable, isStackable_)
-ITEM_BOOL_PROPERTY_IMPL(GroundTile, isGroundTile_)
-ITEM_BOOL_PROPERTY_IMPL(AlwaysOnTop, isAlwaysOnTop_)
-ITEM_BOOL_PROPERTY_IMPL(Teleport, isTeleport_)
-ITEM_BOOL_PROPERTY_IMPL(Container, isContainer_)
-ITEM_BOOL_PROPERTY_IMPL(Readable, isReadable_)
-ITEM_BOOL_PROPERTY_IMPL(CanWriteText, canWriteText_)
-ITEM_BOOL_PROPERTY_IMPL(Pickupable, isPickupable_)
-ITEM_BOOL_PROPERTY_IMPL(Rotatable, isRotatable_)
-ITEM_BOOL_PROPERTY_IMPL(Hangable, isHangable_)
-ITEM_BOOL_PROPERTY_IMPL(HasHookSouth, hasHookSouth_)
-ITEM_BOOL_PROPERTY_IMPL(HasHookEast, hasHookEast_)
-ITEM_BOOL_PROPERTY_IMPL(HasHeight, hasHeight_)
-
-// These have different names or slightly different logic from the macro
-bool Item::blocksMissiles() const { return blocksMissiles_; }
-void Item::setBlocksMissiles(bool on) { if (blocksMissiles_ != on) { blocksMissiles_ = on; setModified(true); emit propertyChanged(); } }
-
-bool Item::blocksPathfind() const { return blocksPathfind_; }
-void Item::setBlocksPathfind(bool on) { if (blocksPathfind_ != on) { blocksPathfind_ = on; setModified(true); emit propertyChanged(); } }
-
-int Item::getTopOrder() const { return topOrder_; }
-void Item::setTopOrder(int order) { if (topOrder_ != order) { topOrder_ = order; setModified(true); emit propertyChanged(); } }
-
-// Renamed setters for macro compatibility in Item.h, now implementing them directly for clarity
-void Item::setIsTeleport(bool on) { setTeleport(on); }
-void Item::setIsContainer(bool on) { setContainer(on); }
-
-
-// Brush-related property implementations
-bool Item::isTable() const {
-    // Assuming ItemManager::getInstance() and getItemTypeData() are thread-safe if used across threads.
-    // For typical editor usage, this might be single-threaded.
-    const ItemTypeData* itemTypeData = ItemManager::getInstance().getItemTypeData(serverId_);
-    if (itemTypeData) {
-        return itemTypeData->isTable; // Assumes ItemTypeData struct has 'isTable'
-    }
-    return false;
-}
-
-bool Item::isCarpet() const {
-    const ItemTypeData* itemTypeData = ItemManager::getInstance().getItemTypeData(serverId_);
-    if (itemTypeData) {
-        return itemTypeData->isCarpet; // Assumes ItemTypeData struct has 'isCarpet'
-    }
-    return false;
-}
+    setAttribute(AttributeKey::UniqueId, id);
+}
+
+// Boolean Flag Getters (type-level, from the shared ItemProperties)
+#define ITEM_TYPE_FLAG_IMPL(Getter, PropMember) \
+bool Item::Getter() const { return type().PropMember; }
+
+ITEM_TYPE_FLAG_IMPL(isMoveable, isMoveable)
+ITEM_TYPE_FLAG_IMPL(isBlocking, isBlocking)
+ITEM_TYPE_FLAG_IMPL(blocksMissiles, blockMissiles)
+ITEM_TYPE_FLAG_IMPL(blocksPathfind, blockPathfind)
+ITEM_TYPE_FLAG_IMPL(isStackable, isStackable)
+ITEM_TYPE_FLAG_IMPL(isGroundTile, isGroundTile)
+ITEM_TYPE_FLAG_IMPL(isAlwaysOnTop, alwaysOnBottom) // Note: OTB ALWAYSONTOP is stored as alwaysOnBottom, see ItemManager::parseOtb
+ITEM_TYPE_FLAG_IMPL(isReadable, isReadable)
+ITEM_TYPE_FLAG_IMPL(canWriteText, canWriteText)
+ITEM_TYPE_FLAG_IMPL(isPickupable, isPickupable)
+ITEM_TYPE_FLAG_IMPL(isRotatable, isRotatable)
+ITEM_TYPE_FLAG_IMPL(isHangable, isHangable)
+ITEM_TYPE_FLAG_IMPL(hasHookSouth, hasHookSouth)
+ITEM_TYPE_FLAG_IMPL(hasHookEast, hasHookEast)
+ITEM_TYPE_FLAG_IMPL(hasHeight, hasElevation)
+ITEM_TYPE_FLAG_IMPL(isUseable, isUseable)
+ITEM_TYPE_FLAG_IMPL(isWall, isWall)
+ITEM_TYPE_FLAG_IMPL(isTable, isTable)
+ITEM_TYPE_FLAG_IMPL(isCarpet, isCarpet)
+
+#undef ITEM_TYPE_FLAG_IMPL
+
+int Item::getTopOrder() const { return type().topOrder; }
+
+bool Item::isTeleport() const { return type().type == ITEM_TYPE_TELEPORT; }
+bool Item::isContainer() const { return type().type == ITEM_TYPE_CONTAINER; }
 
 Brush* Item::getBrush() const {
-    const ItemTypeData* itemTypeData = ItemManager::getInstance().getItemTypeData(serverId_);
-    if (itemTypeData) {
-        return itemTypeData->brush; // Assumes ItemTypeData struct has 'brush'
-    }
-    return nullptr;
+    return type().brush;
 }
 
 
 // Other methods
 QString Item::getDescription() const {
-    QString desc = name_;
+    const ItemProperties& props = type();
+    QString desc = typeText().name;
     if (!desc.isEmpty()) {
         desc += " ";
     }
     desc += QString("(ID: %1").arg(serverId_);
-    if (clientId_ != 0 && clientId_ != serverId_) {
-        desc += QString(", ClientID: %1").arg(clientId_);
+    if (props.clientId != 0 && props.clientId != serverId_) {
+        desc += QString(", ClientID: %1").arg(props.clientId);
     }
     desc += ")";
 
-    // Append text from AttrText if available
-    if (hasAttribute(Item::AttrText)) {
-        QString textAttr = getText(); // getText() now uses Item::AttrText
+    // Append text if available
+    if (hasAttribute(AttributeKey::Text)) {
+        QString textAttr = getText();
         if(!textAttr.isEmpty()){
              desc += "\n\"" + textAttr + "\"";
         }
     }
-    // Append additional description from AttrDescription if available
-    // This is different from the primary item look description stored in member description_
-    if (hasAttribute(Item::AttrDescription)) {
-        desc += "\n" + getAttribute(Item::AttrDescription).toString();
+    // Append additional description if available
+    // This is the per-instance override of the type's look description
+    if (hasAttribute(AttributeKey::Description)) {
+        desc += "\n" + extra().description;
     }
     return desc;
 }
 
 void Item::drawText(QPainter* painter, const QRectF& targetRect, const QMap<QString, QVariant>& options) {
-    if (painter && isStackable_ && getCount() > 1) {
+    if (painter && isStackable() && getCount() > 1) {
         QString countStr = QString::number(getCount());
         painter->save();
         QFont font = painter->font();
@@ -345,56 +411,85 @@ void Item::drawText(QPainter* painter, const QRectF& targetRect, const QMap<QStr
 }
 
 Item* Item::deepCopy() const {
+    // Type data is shared through ItemManager, so a copy is just the id, the fixed
+    // attribute slots and the implicitly shared extra block (copied on first write).
     Item* newItem = new Item(this->serverId_); 
-    
-    newItem->clientId_ = this->clientId_;
-    newItem->name_ = this->name_;
-    newItem->itemTypeName_ = this->itemTypeName_;
-    newItem->attributes_ = this->attributes_; 
-
-    newItem->isMoveable_ = this->isMoveable_;
-    newItem->isBlocking_ = this->isBlocking_;
-    newItem->blocksMissiles_ = this->blocksMissiles_;
-    newItem->blocksPathfind_ = this->blocksPathfind_;
-    newItem->isStackable_ = this->isStackable_;
-    newItem->isGroundTile_ = this->isGroundTile_;
-    newItem->isAlwaysOnTop_ = this->isAlwaysOnTop_;
-    newItem->topOrder_ = this->topOrder_;
-    newItem->isTeleport_ = this->isTeleport_;
-    newItem->isContainer_ = this->isContainer_;
-    newItem->isReadable_ = this->isReadable_;
-    newItem->canWriteText_ = this->canWriteText_;
-    newItem->isPickupable_ = this->isPickupable_;
-    newItem->isRotatable_ = this->isRotatable_;
-    newItem->isHangable_ = this->isHangable_;
-    newItem->hasHookSouth_ = this->hasHookSouth_;
-    newItem->hasHookEast_ = this->hasHookEast_;
-    newItem->hasHeight_ = this->hasHeight_;
-    
-    newItem->description_ = this->description_;
-    newItem->editorSuffix_ = this->editorSuffix_;
-    newItem->itemGroup_ = this->itemGroup_;
-    newItem->itemType_ = this->itemType_;
-    newItem->weight_ = this->weight_;
-    newItem->attack_ = this->attack_;
-    newItem->defense_ = this->defense_;
-    newItem->armor_ = this->armor_;
+    newItem->attrMask_ = this->attrMask_;
+    newItem->count_ = this->count_;
+    newItem->actionId_ = this->actionId_;
+    newItem->uniqueId_ = this->uniqueId_;
     newItem->charges_ = this->charges_;
-    newItem->maxTextLen_ = this->maxTextLen_;
-    newItem->rotateTo_ = this->rotateTo_;
-    newItem->volume_ = this->volume_;
-    newItem->slotPosition_ = this->slotPosition_;
-    newItem->weaponType_ = this->weaponType_;
-    newItem->lightLevel_ = this->lightLevel_;
-    newItem->lightColor_ = this->lightColor_;
-    newItem->classification_ = this->classification_;
-
+    newItem->extra_ = this->extra_;
     return newItem;
 }
 
+void Item::writeSnapshotRecord(SnapshotItemRecord& record, QByteArray& extras) const {
+    record.serverId = serverId_;
+    record.attrMask = attrMask_;
+    record.count = count_;
+    record.actionId = actionId_;
+    record.uniqueId = uniqueId_;
+    record.charges = charges_;
+    record.extraSize = 0;
+    if (!extra_) {
+        return;
+    }
+    const qsizetype start = extras.size();
+    QDataStream out(&extras, QIODevice::WriteOnly | QIODevice::Append);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << extra_->text << extra_->description << extra_->writer << extra_->article
+        << extra_->duration << extra_->depotId << extra_->tier
+        << extra_->teleDestX << extra_->teleDestY << extra_->teleDestZ << extra_->custom;
+    record.extraSize = static_cast<quint32>(extras.size() - start);
+}
+
+Item* Item::fromSnapshotRecord(const SnapshotItemRecord& record, QByteArrayView extra) {
+    Item* item = new Item(record.serverId);
+    item->attrMask_ = record.attrMask;
+    item->count_ = record.count;
+    item->actionId_ = record.actionId;
+    item->uniqueId_ = record.uniqueId;
+    item->charges_ = record.charges;
+    if (!extra.isEmpty()) {
+        const QByteArray data = QByteArray::fromRawData(extra.data(), extra.size());
+        QDataStream in(data);
+        in.setVersion(QDataStream::Qt_6_0);
+        ItemExtraAttributes& attributes = item->extraForWrite();
+        in >> attributes.text >> attributes.description >> attributes.writer >> attributes.article
+           >> attributes.duration >> attributes.depotId >> attributes.tier
+           >> attributes.teleDestX >> attributes.teleDestY >> attributes.teleDestZ >> attributes.custom;
+        if (in.status() != QDataStream::Ok) {
+            qWarning() << "Item::fromSnapshotRecord - Corrupt attributes for item" << record.serverId;
+        }
+    }
+    return item;
+}
+
 void Item::draw(QPainter* painter, const QRectF& targetRect, const DrawingOptions& options) const {
     if (!painter) return;
-    
+
+    if (options.sprites && options.spriteBatch) {
+        // Patterns wrap (see SpriteManager::resolveFrame), so the tile position picks the variant.
+        const int x = ownerTile_ ? ownerTile_->x() : 0;
+        const int y = ownerTile_ ? ownerTile_->y() : 0;
+        const int z = ownerTile_ ? ownerTile_->z() : 0;
+        const SpriteAtlas::Entry entry = options.sprites->atlasFrame(getClientId(), 0, x, y, z);
+        if (entry.isValid()) {
+            // Frames bigger than a tile extend up and to the left of it.
+            const qreal scale = targetRect.width() / 32.0;
+            const QPointF topLeft = targetRect.bottomRight() - QPointF(entry.rect.width() * scale, entry.rect.height() * scale);
+            options.spriteBatch->add(entry, topLeft, scale, options.itemOpacity);
+            if (!options.drawDebugInfo) {
+                return;
+            }
+        }
+        options.spriteBatch->flush(painter); // Painted directly below, so everything batched goes first
+        if (entry.isValid()) {
+            drawDebugInfo(painter, targetRect);
+            return;
+        }
+    }
+
     QColor itemColor = Qt::blue;
     itemColor.setHsv(((serverId_ * 37) % 360), 200, 220); 
     
@@ -403,448 +498,253 @@ void Item::draw(QPainter* painter, const QRectF& targetRect, const DrawingOption
     painter->drawRect(targetRect);
 
     if (options.drawDebugInfo) {
-        painter->save();
-        QPen debugPen(Qt::magenta);
-        debugPen.setStyle(Qt::DotLine);
-        painter->setPen(debugPen);
-        painter->drawRect(targetRect);
-
-        QString idText = QString("ID:%1").arg(serverId_);
-        QFont font = painter->font();
-        font.setPointSize(8);
-        painter->setFont(font);
-        painter->setPen(Qt::white);
-        painter->drawText(targetRect.adjusted(2, 2, -2, -2), Qt::AlignTop | Qt::AlignLeft | Qt::TextDontClip, idText);
-        painter->restore();
-    }
-}
-
-// --- New Dedicated Property Getters and Setters ---
-QString Item::descriptionText() const { return description_; }
-void Item::setDescriptionText(const QString& description) {
-    if (description_ != description) {
-        description_ = description;
-        setModified(true); // Also sets modified if direct member changes
-        setAttribute(Item::AttrDescription, description_); // Keep attributes_ in sync
-        emit propertyChanged();
-    }
-}
-
-QString Item::editorSuffix() const { return editorSuffix_; }
-void Item::setEditorSuffix(const QString& suffix) {
-    if (editorSuffix_ != suffix) {
-        editorSuffix_ = suffix;
-        setModified(true);
-        emit propertyChanged();
+        drawDebugInfo(painter, targetRect);
     }
 }
 
-ItemGroup_t Item::itemGroup() const { return itemGroup_; }
-void Item::setItemGroup(ItemGroup_t group) {
-    if (itemGroup_ != group) {
-        itemGroup_ = group;
-        setModified(true);
-        emit propertyChanged();
-    }
-}
-
-ItemTypes_t Item::itemType() const { return itemType_; }
-void Item::setItemType(ItemTypes_t type) {
-    if (itemType_ != type) {
-        itemType_ = type;
-        setModified(true);
-        emit propertyChanged();
-    }
-}
+void Item::drawDebugInfo(QPainter* painter, const QRectF& targetRect) const {
+    painter->save();
+    QPen debugPen(Qt::magenta);
+    debugPen.setStyle(Qt::DotLine);
+    painter->setPen(debugPen);
+    painter->drawRect(targetRect);
 
-float Item::weight() const { return weight_; }
-void Item::setWeight(float weight) {
-    if (qAbs(weight_ - weight) > 0.0001f) { 
-        weight_ = weight;
-        setModified(true);
-        emit propertyChanged();
-    }
+    QString idText = QString("ID:%1").arg(serverId_);
+    QFont font = painter->font();
+    font.setPointSize(8);
+    painter->setFont(font);
+    painter->setPen(Qt::white);
+    painter->drawText(targetRect.adjusted(2, 2, -2, -2), Qt::AlignTop | Qt::AlignLeft | Qt::TextDontClip, idText);
+    painter->restore();
+}
+
+// --- Type-level Property Getters ---
+QString Item::editorSuffix() const { return typeText().editorSuffix; }
+ItemGroup_t Item::itemGroup() const { return type().group; }
+ItemTypes_t Item::itemType() const { return type().type; }
+float Item::weight() const { return type().weight; }
+qint16 Item::attack() const { return type().attack; }
+qint16 Item::defense() const { return type().defense; }
+qint16 Item::armor() const { return type().armor; }
+quint16 Item::maxTextLen() const { return type().maxTextLen; }
+quint16 Item::rotateTo() const { return type().rotateTo; }
+quint16 Item::volume() const { return type().volume; }
+quint32 Item::slotPosition() const { return type().slotPosition; }
+quint8 Item::weaponType() const { return type().weaponType; }
+quint16 Item::lightLevel() const { return type().lightLevel; }
+quint16 Item::lightColor() const { return type().lightColor; }
+
+// --- Instance Properties (fall back to the type value until set on the item) ---
+QString Item::descriptionText() const {
+    return hasAttribute(AttributeKey::Description) ? extra().description : typeText().description;
 }
-
-qint16 Item::attack() const { return attack_; }
-void Item::setAttack(qint16 attack) {
-    if (attack_ != attack) {
-        attack_ = attack;
-        setModified(true);
-        emit propertyChanged();
-    }
+void Item::setDescriptionText(const QString& description) {
+    setAttribute(AttributeKey::Description, description);
 }
 
-qint16 Item::defense() const { return defense_; }
-void Item::setDefense(qint16 defense) {
-    if (defense_ != defense) {
-        defense_ = defense;
-        setModified(true);
-        emit propertyChanged();
-    }
+quint16 Item::charges() const {
+    return hasAttribute(AttributeKey::Charges) ? charges_ : type().charges;
 }
-
-qint16 Item::armor() const { return armor_; }
-void Item::setArmor(qint16 armor) {
-    if (armor_ != armor) {
-        armor_ = armor;
-        setModified(true);
-        emit propertyChanged();
-    }
-}
-
-quint16 Item::charges() const { return charges_; }
 void Item::setCharges(quint16 charges) {
-    if (charges_ != charges) {
-        charges_ = charges;
-        setModified(true); // Also sets modified if direct member changes
-        setAttribute(Item::AttrCharges, charges_); // Keep attributes_ in sync
-        emit propertyChanged();
-    }
-}
-
-quint16 Item::maxTextLen() const { return maxTextLen_; }
-void Item::setMaxTextLen(quint16 len) {
-    if (maxTextLen_ != len) {
-        maxTextLen_ = len;
-        setModified(true);
-        emit propertyChanged();
-    }
-}
-
-quint16 Item::rotateTo() const { return rotateTo_; }
-void Item::setRotateTo(quint16 id) {
-    if (rotateTo_ != id) {
-        rotateTo_ = id;
-        setModified(true);
-        emit propertyChanged();
-    }
-}
-
-quint16 Item::volume() const { return volume_; }
-void Item::setVolume(quint16 volume) {
-    if (this->volume_ != volume) {
-        this->volume_ = volume;
-        setModified(true);
-        emit propertyChanged();
-    }
-}
-
-quint32 Item::slotPosition() const { return slotPosition_; }
-void Item::setSlotPosition(quint32 slotPos) {
-    if (slotPosition_ != slotPos) {
-        slotPosition_ = slotPos;
-        setModified(true);
-        emit propertyChanged();
-    }
+    setAttribute(AttributeKey::Charges, charges);
 }
 
-quint8 Item::weaponType() const { return weaponType_; }
-void Item::setWeaponType(quint8 type) {
-    if (weaponType_ != type) {
-        weaponType_ = type;
-        setModified(true);
-        emit propertyChanged();
-    }
-}
-
-quint16 Item::lightLevel() const { return lightLevel_; }
-void Item::setLightLevel(quint16 level) {
-    if (lightLevel_ != level) {
-        lightLevel_ = level;
-        setModified(true);
-        emit propertyChanged();
-    }
+quint16 Item::classification() const {
+    return hasAttribute(AttributeKey::Tier) ? extra().tier : type().classification;
 }
-
-quint16 Item::lightColor() const { return lightColor_; }
-void Item::setLightColor(quint16 color) {
-    if (lightColor_ != color) {
-        lightColor_ = color;
-        setModified(true);
-        emit propertyChanged();
-    }
-}
-
-quint16 Item::classification() const { return classification_; }
 void Item::setClassification(quint16 classification) {
-    if (classification_ != classification) {
-        classification_ = classification;
-        setModified(true); // Also sets modified if direct member changes
-        setAttribute(Item::AttrTier, classification_); // Keep attributes_ in sync using AttrTier
-        emit propertyChanged();
-    }
+    setAttribute(AttributeKey::Tier, classification);
 }
 
 // Helper methods
 bool Item::isFluidContainer() const {
-    const ItemProperties& props = ItemManager::instance()->getItemProperties(getServerId());
-    return props.group == ITEM_GROUP_FLUID;
+    return type().group == ITEM_GROUP_FLUID;
 }
 
 bool Item::isSplash() const {
-    const ItemProperties& props = ItemManager::instance()->getItemProperties(getServerId());
-    return props.group == ITEM_GROUP_SPLASH;
+    return type().group == ITEM_GROUP_SPLASH;
 }
 
 bool Item::isCharged() const {
-    const ItemProperties& props = ItemManager::instance()->getItemProperties(getServerId());
+    const ItemProperties& props = type();
     return props.clientCharges || props.extraChargeable;
 }
 
-// Note: The local OtbmAttr namespace has been removed. Constants are now from OtbmTypes.h
+// OTBM attribute decoding. Every attribute id maps to a small function that writes the value
+// into the item's fields and sets its attribute bit, without the QVariant round trip and
+// modification tracking of setAttribute(); freshly read items are unmodified anyway.
+struct ItemOtbmDecoding {
+    static void mark(Item& item, Item::AttributeKey key) { item.attrMask_ |= Item::attributeBit(key); }
 
-bool Item::unserializeOtbmAttributes(QDataStream& stream, quint32 otbItemsMajorVersion, quint32 otbItemsMinorVersion) {
-    // TODO: Use otbItemsMajorVersion for OTBMv1 subtype logic if not handled in OtbmReader
-    // Q_UNUSED(otbItemsMajorVersion); // mapOtbmFormatVersion is not available here, only OTB item versions.
-                                     // This was a mistake in plan. OtbmReader handles OTBMv1 subtype with mapOtbmFormatVersion.
-                                     // Here, we only have OTB item versions.
-    // Q_UNUSED(otbItemsMinorVersion); // Will be used for OTBM_ATTR_CHARGES
-    if (stream.atEnd()) {
-        // No attributes to read, which is valid.
+    static bool description(Item& item, quint8, QByteArrayView data) {
+        item.extraForWrite().description = QString::fromUtf8(data);
+        mark(item, Item::AttributeKey::Description);
         return true;
     }
-
-    stream.setByteOrder(QDataStream::LittleEndian);
-
-    while (!stream.atEnd()) {
-        quint8 attributeId;
-        stream >> attributeId;
-        if (stream.status() != QDataStream::Ok) {
-            qWarning() << "Item::unserializeOtbmAttributes - Failed to read attribute ID. Stream status:" << stream.status();
-            return false;
-        }
-
-        quint16 dataLength;
-        stream >> dataLength;
-        if (stream.status() != QDataStream::Ok) {
-            qWarning() << "Item::unserializeOtbmAttributes - Failed to read data length for attribute ID" << attributeId << ". Stream status:" << stream.status();
-            return false;
-        }
-
-        QByteArray attributeDataBytes;
-        if (dataLength > 0) { // Only resize and read if dataLength > 0
-            attributeDataBytes.resize(dataLength);
-            if (stream.readRawData(attributeDataBytes.data(), dataLength) != dataLength) {
-                qWarning() << "Item::unserializeOtbmAttributes - Failed to read attribute data for ID" << attributeId << "Expected length:" << dataLength;
-                return false;
-            }
+    static bool text(Item& item, quint8, QByteArrayView data) {
+        item.extraForWrite().text = QString::fromUtf8(data);
+        mark(item, Item::AttributeKey::Text);
+        return true;
+    }
+    static bool writer(Item& item, quint8, QByteArrayView data) {
+        item.extraForWrite().writer = QString::fromUtf8(data);
+        mark(item, Item::AttributeKey::Writer);
+        return true;
+    }
+    static bool setCharges(Item& item, quint16 charges) {
+        item.charges_ = charges;
+        mark(item, Item::AttributeKey::Charges);
+        return true;
+    }
+    // quint8. For OTBMv1 the subtype byte has already been applied by OtbmReader::readItem, so
+    // a COUNT here is an explicit override; on non-stackables it is taken as charges.
+    static bool count(Item& item, quint8, QByteArrayView data) {
+        if (data.isEmpty()) return false;
+        const quint8 value = static_cast<quint8>(data.at(0));
+        if (!item.type().isStackable) {
+            return setCharges(item, value);
         }
-
-        QDataStream attributeValueStream(attributeDataBytes);
-        attributeValueStream.setByteOrder(QDataStream::LittleEndian);
-
-        const ItemProperties& iType = ItemManager::instance()->getItemProperties(getServerId());
-        // TODO (Task51-OTBMv1): Handle OTBMv1 initial subtype reading if not done in OtbmReader.
-        // This might involve a special check here if otbItemsMajorVersion (or map OTBM version) indicates OTBMv1
-        // and reading a subtype/count if the item is stackable, fluid, or splash.
-
-        switch (static_cast<OTBM_ItemAttribute>(attributeId)) {
-            case OTBM_ATTR_DESCRIPTION:
-            case OTBM_ATTR_DESC: { // OTBM_ATTR_DESC is often the primary one
-                setDescriptionText(QString::fromUtf8(attributeDataBytes));
-                break;
-            }
-            case OTBM_ATTR_TEXT: {
-                setText(QString::fromUtf8(attributeDataBytes));
-                break;
-            }
-            case OTBM_ATTR_WRITTENBY: { // Corrected enum name
-                // Assuming no dedicated member for writer yet, just use attribute
-                setAttribute(Item::AttrWriter, QString::fromUtf8(attributeDataBytes));
-                break;
-            }
-            case OTBM_ATTR_COUNT: { // quint8. OTBMv1 uses this for subtype for some items.
-                                    // This logic assumes OtbmReader already handled initial subtype for OTBMv1.
-                                    // So, if COUNT appears for OTBMv1 here, it's likely an actual count override or error.
-                if (dataLength < sizeof(quint8)) { qWarning("ATTR_COUNT data too short"); break; }
-                quint8 val; attributeValueStream >> val;
-                if (iType.isStackable) {
-                    setCount(val);
-                } else {
-                    // For non-stackables, COUNT attribute is unusual post-OTBMv1 subtype handling.
-                    // Could be charges for some specific old items or custom server usage.
-                    qDebug() << "Item ID" << getServerId() << "is not stackable but received OTBM_ATTR_COUNT:" << val << ". Treating as charges.";
-                    setCharges(val);
-                }
-                break;
-            }
-            case OTBM_ATTR_RUNE_CHARGES: { // Typically quint8
-                if (dataLength < sizeof(quint8)) { qWarning("ATTR_RUNE_CHARGES data too short"); break; }
-                quint8 val; attributeValueStream >> val;
-                setCharges(val); // Map to general charges
-                break;
-            }
-            case OTBM_ATTR_CHARGES: { // Typically quint16
-                if (dataLength < sizeof(quint16)) { qWarning("ATTR_CHARGES data too short"); break; }
-                quint16 val; attributeValueStream >> val;
-                // Use OTB item minor version (ClientVersionID). CLIENT_VERSION_820 corresponds to value 10.
-                // TODO (Task51-ClientVer): Confirm '10' is the correct enum/define for CLIENT_VERSION_820 from client_version.h or similar.
-                if (otbItemsMinorVersion >= 10) { // CLIENT_VERSION_820 or newer
-                    if (iType.clientCharges || iType.extraChargeable) { // Check if item type actually supports charges
-                        setCharges(val);
-                    } else {
-                        qDebug() << "Item ID" << getServerId() << "received ATTR_CHARGES but type is not client-chargeable by OTB version" << otbItemsMinorVersion;
-                        // Optionally store as generic attribute if needed: setAttribute(Item::AttrCharges, val);
-                    }
-                } else { // Older clients might use ATTR_CHARGES differently or not at all for some items
-                    qDebug() << "Item ID" << getServerId() << "ATTR_CHARGES (" << val << ") encountered for older OTB version " << otbItemsMinorVersion << ". Applying directly.";
-                    setCharges(val); // Default handling: apply if present
-                }
-                break;
-            }
-            case OTBM_ATTR_ACTION_ID: {
-                if (dataLength < sizeof(quint16)) break;
-                quint16 val;
-                attributeValueStream >> val;
-                setActionId(val);
-                break;
-            }
-            case OTBM_ATTR_UNIQUE_ID: {
-                if (dataLength < sizeof(quint16)) break;
-                quint16 val;
-                attributeValueStream >> val;
-                setUniqueId(val);
-                break;
-            }
-            case OTBM_ATTR_DURATION: {
-                if (dataLength < sizeof(quint32)) break;
-                quint32 val;
-                attributeValueStream >> val;
-                setAttribute(Item::AttrDuration, val);
-                break;
-            }
-            case OTBM_ATTR_DEPOT_ID: {
-                if (dataLength < sizeof(quint16)) break;
-                quint16 val;
-                attributeValueStream >> val;
-                setAttribute(Item::AttrDepotID, val);
-                break;
-            }
-            case OTBM_ATTR_TELE_DEST: { // Corrected enum name
-                if (dataLength < (sizeof(quint16) * 2 + sizeof(quint8))) break;
-                quint16 x, y;
-                quint8 z;
-                attributeValueStream >> x >> y >> z;
-                if (attributeValueStream.status() == QDataStream::Ok) {
-                    setAttribute(Item::AttrTeleDestX, x);
-                    setAttribute(Item::AttrTeleDestY, y);
-                    setAttribute(Item::AttrTeleDestZ, z);
-                } else {
-                     qWarning() << "Item::unserializeOtbmAttributes - Failed to read TELEPORT_DEST components.";
-                }
-                break;
-            }
-             case OTBM_ATTR_TIER: {
-                if (dataLength < sizeof(quint16)) break;
-                quint16 val;
-                attributeValueStream >> val;
-                setClassification(val); // This will also set AttrTier via the setter
-                break;
+        item.count_ = value == 0 ? 1 : value;
+        mark(item, Item::AttributeKey::Count);
+        return true;
+    }
+    static bool runeCharges(Item& item, quint8, QByteArrayView data) {
+        if (data.isEmpty()) return false;
+        return setCharges(item, static_cast<quint8>(data.at(0)));
+    }
+    // quint16. From CLIENT_VERSION_820 (items minor version 10) on, only types with client
+    // charges keep it; older item sets apply it as is.
+    // TODO (Task51-ClientVer): Confirm '10' is the correct enum/define for CLIENT_VERSION_820.
+    template <bool ClientCharges>
+    static bool charges(Item& item, quint8, QByteArrayView data) {
+        if (data.size() < qsizetype(sizeof(quint16))) return false;
+        if (ClientCharges) {
+            const ItemProperties& iType = item.type();
+            if (!iType.clientCharges && !iType.extraChargeable) {
+                return true;
             }
-            // case OTBM_ATTR_WRITTENDATE: // Example: quint32
-            // case OTBM_ATTR_HOUSEDOORID: // Example: quint8
-
-            default:
-                qDebug() << "Item::unserializeOtbmAttributes - Unhandled attribute ID:" << Qt::hex << attributeId << "Length:" << dataLength;
-                QString unknownKey = QString("otbm_attr_%1").arg(attributeId, 2, 16, QChar('0'));
-                setAttribute(unknownKey, QVariant(attributeDataBytes)); // Store raw bytes
-                break;
         }
-
-        // Check stream status for operations that read from attributeValueStream
-        bool isStringType = (attributeId == OTBM_ATTR_DESCRIPTION ||
-                             attributeId == OTBM_ATTR_DESC ||
-                             attributeId == OTBM_ATTR_TEXT ||
-                             attributeId == OTBM_ATTR_WRITTENBY);
-
-        if (!isStringType && attributeValueStream.status() != QDataStream::Ok) {
-             // If dataLength was 0, status might be Ok but nothing was read, which is fine.
-            if (dataLength > 0) {
-                qWarning() << "Item::unserializeOtbmAttributes - Error reading value for attribute ID" << attributeId
-                           << "Stream status:" << attributeValueStream.status();
-                // Depending on strictness, might return false here.
-                // For now, we'll continue and try to read other attributes.
-            }
+        return setCharges(item, qFromLittleEndian<quint16>(data.data()));
+    }
+    static bool actionId(Item& item, quint8, QByteArrayView data) {
+        if (data.size() < qsizetype(sizeof(quint16))) return false;
+        item.actionId_ = qFromLittleEndian<quint16>(data.data());
+        mark(item, Item::AttributeKey::ActionId);
+        return true;
+    }
+    static bool uniqueId(Item& item, quint8, QByteArrayView data) {
+        if (data.size() < qsizetype(sizeof(quint16))) return false;
+        item.uniqueId_ = qFromLittleEndian<quint16>(data.data());
+        mark(item, Item::AttributeKey::UniqueId);
+        return true;
+    }
+    static bool duration(Item& item, quint8, QByteArrayView data) {
+        if (data.size() < qsizetype(sizeof(quint32))) return false;
+        item.extraForWrite().duration = qFromLittleEndian<quint32>(data.data());
+        mark(item, Item::AttributeKey::Duration);
+        return true;
+    }
+    static bool depotId(Item& item, quint8, QByteArrayView data) {
+        if (data.size() < qsizetype(sizeof(quint16))) return false;
+        item.extraForWrite().depotId = qFromLittleEndian<quint16>(data.data());
+        mark(item, Item::AttributeKey::DepotId);
+        return true;
+    }
+    static bool teleDest(Item& item, quint8, QByteArrayView data) {
+        if (data.size() < qsizetype(sizeof(quint16) * 2 + sizeof(quint8))) {
+            qWarning() << "Item::unserializeOtbmAttribute - TELEPORT_DEST data too short.";
+            return false;
         }
+        ItemExtraAttributes& ex = item.extraForWrite();
+        ex.teleDestX = qFromLittleEndian<quint16>(data.data());
+        ex.teleDestY = qFromLittleEndian<quint16>(data.data() + 2);
+        ex.teleDestZ = static_cast<quint8>(data.at(4));
+        mark(item, Item::AttributeKey::TeleDestX);
+        mark(item, Item::AttributeKey::TeleDestY);
+        mark(item, Item::AttributeKey::TeleDestZ);
+        return true;
+    }
+    static bool tier(Item& item, quint8, QByteArrayView data) {
+        if (data.size() < qsizetype(sizeof(quint16))) return false;
+        item.extraForWrite().tier = qFromLittleEndian<quint16>(data.data());
+        mark(item, Item::AttributeKey::Tier);
+        return true;
+    }
+    // Attributes without a typed slot keep their raw bytes as a custom attribute.
+    // TODO: OTBM_ATTR_WRITTENDATE (quint32), OTBM_ATTR_HOUSEDOORID (quint8)
+    static bool unknown(Item& item, quint8 attributeId, QByteArrayView data) {
+        qDebug() << "Item::unserializeOtbmAttribute - Unhandled attribute ID:" << Qt::hex << attributeId << "Length:" << data.size();
+        item.extraForWrite().custom.insert(QString("otbm_attr_%1").arg(attributeId, 2, 16, QChar('0')), QVariant(data.toByteArray()));
+        return true;
     }
-    this->setModified(false); // Item state reflects persistent storage
-    return true; // Successfully read all available attributes
-}
 
-bool Item::serializeOtbmAttributes(QDataStream& stream, quint32 mapOtbmFormatVersion, quint32 otbItemsMajorVersion, quint32 otbItemsMinorVersion) const {
+    template <bool InitialSubtype, bool ClientCharges>
+    static constexpr ItemAttributeDecoders makeTable() {
+        ItemAttributeDecoders table{};
+        for (ItemAttributeDecoders::Decoder& decoder : table.byId) {
+            decoder = &unknown;
+        }
+        table.byId[OTBM_ATTR_DESCRIPTION] = &description;
+        table.byId[OTBM_ATTR_DESC] = &description;
+        table.byId[OTBM_ATTR_TEXT] = &text;
+        table.byId[OTBM_ATTR_WRITTENBY] = &writer;
+        table.byId[OTBM_ATTR_COUNT] = &count;
+        table.byId[OTBM_ATTR_RUNE_CHARGES] = &runeCharges;
+        table.byId[OTBM_ATTR_CHARGES] = &charges<ClientCharges>;
+        table.byId[OTBM_ATTR_ACTION_ID] = &actionId;
+        table.byId[OTBM_ATTR_UNIQUE_ID] = &uniqueId;
+        table.byId[OTBM_ATTR_DURATION] = &duration;
+        table.byId[OTBM_ATTR_DEPOT_ID] = &depotId;
+        table.byId[OTBM_ATTR_TELE_DEST] = &teleDest;
+        table.byId[OTBM_ATTR_TIER] = &tier;
+        table.initialSubtype = InitialSubtype;
+        return table;
+    }
+};
+
+namespace {
+// [OTBMv1][items version >= CLIENT_VERSION_820]
+constexpr ItemAttributeDecoders kOtbmAttributeDecoders[2][2] = {
+    { ItemOtbmDecoding::makeTable<false, false>(), ItemOtbmDecoding::makeTable<false, true>() },
+    { ItemOtbmDecoding::makeTable<true, false>(), ItemOtbmDecoding::makeTable<true, true>() },
+};
+} // namespace
+
+const ItemAttributeDecoders& Item::otbmAttributeDecoders(quint32 mapOtbmFormatVersion, quint32 otbItemsMajorVersion, quint32 otbItemsMinorVersion) {
+    // TODO (Task51): otbItemsMajorVersion does not change the decoding of any attribute yet.
+    Q_UNUSED(otbItemsMajorVersion);
+    return kOtbmAttributeDecoders[mapOtbmFormatVersion == 0][otbItemsMinorVersion >= 10];
+}
+
+bool Item::serializeOtbmAttributes(OtbmWriter& writer, quint32 mapOtbmFormatVersion, quint32 otbItemsMajorVersion, quint32 otbItemsMinorVersion) const {
     // TODO (Task51): Implement client version specific logic for item attribute serialization.
     // This might involve:
     // - Writing different attribute IDs based on target client version.
-    // TODO: Use otbItemsMajorVersion for OTBMv1 subtype logic if not handled in OtbmWriter
-    // Q_UNUSED(otbItemsMajorVersion); // mapOtbmFormatVersion will be used for this
-    // Q_UNUSED(otbItemsMinorVersion); // Will be used
     // - Converting values to older formats if necessary.
-    // Map* map = qobject_cast<Map*>(this->parent()->parent()); // Example
-    // if (map && map->getOtbmMajorVersion() < SOME_VERSION) { /* save old way */ }
-
-    stream.setByteOrder(QDataStream::LittleEndian);
-
-    // Helper lambda to write string attributes
-    auto writeStringAttribute = [&](quint8 attrId, const QString& value) {
-        if (!value.isEmpty()) {
-            stream << attrId;
-            QByteArray utf8Value = value.toUtf8();
-            stream << static_cast<quint16>(utf8Value.length());
-            stream.writeRawData(utf8Value.constData(), utf8Value.length());
-        }
-    };
-
-    // Helper lambda for numeric attributes
-    template<typename T>
-    auto writeNumericAttribute = [&](quint8 attrId, T value, T defaultValue = 0) {
-        if (value != defaultValue) {
-            stream << attrId;
-            stream << static_cast<quint16>(sizeof(T));
-            stream << value;
-        }
-    };
+    Q_UNUSED(otbItemsMajorVersion);
 
-    const ItemProperties& iType = ItemManager::instance()->getItemProperties(getServerId());
-    // TODO (Task51-OTBMv1): Handle OTBMv1 initial subtype writing if not done in OtbmWriter.
-    // This might involve a special check here if otbItemsMajorVersion (or map OTBM version) indicates OTBMv1
-    // and writing a subtype/count if the item is stackable, fluid, or splash.
+    const ItemProperties& iType = type();
 
     // Write known attributes
-    // For description, use the direct member description_ if available, otherwise from attributes map
-    QString currentDescription = descriptionText(); // This getter accesses description_
-    if (!currentDescription.isEmpty() || hasAttribute(Item::AttrDescription)) { // Check direct member or if it was set via generic attributes
-         writeStringAttribute(OTBM_ATTR_DESC, currentDescription.isEmpty() ? getAttribute(Item::AttrDescription).toString() : currentDescription);
+    // Only a per-instance description is map data; the type's description comes from items.xml
+    const ItemExtraAttributes& ex = extra();
+    if (hasAttribute(AttributeKey::Description) && !ex.description.isEmpty()) {
+        writer.writeAttributeString(OTBM_ATTR_DESC, ex.description);
     }
-
-    if (hasAttribute(Item::AttrText)) { // Text is purely from attributes map via getText()
-        writeStringAttribute(OTBM_ATTR_TEXT, getText());
+    if (hasAttribute(AttributeKey::Text) && !ex.text.isEmpty()) {
+        writer.writeAttributeString(OTBM_ATTR_TEXT, ex.text);
     }
-    if (hasAttribute(Item::AttrWriter)) {
-        writeStringAttribute(OTBM_ATTR_WRITTENBY, getAttribute(Item::AttrWriter).toString());
+    if (hasAttribute(AttributeKey::Writer) && !ex.writer.isEmpty()) {
+        writer.writeAttributeString(OTBM_ATTR_WRITTENBY, ex.writer);
     }
 
     // Charges / Count
-    // Charges / Count
-    if (mapOtbmFormatVersion == 0) { // OTBM Version 1 (0-indexed from map's m_otbmMajorVersion)
-        // For OTBMv1, stackable, splash, and fluid items write their subtype/count using OTBM_ATTR_COUNT.
-        // This is *after* the initial subtype byte has already been written by OtbmWriter::writeItemNode
-        // IF this initial subtype logic is chosen for OtbmWriter.
-        // The current plan has OtbmReader handle initial subtype, so OtbmWriter might not need to write it separately.
-        // This attribute serialization should reflect what's left or what's standard for attributes.
-        // Based on wxwidgets Item::serializeAttributes, for OTBMv1, it does NOT write count/charges here again
-        // if it was already handled by the initial subtype byte.
-        // So, for OTBMv1, we might skip writing COUNT/CHARGES here if they were part of that initial byte.
-        // This needs careful alignment with OtbmReader's OTBMv1 handling.
-        // For now, let's assume if mapOtbmFormatVersion == 0, the initial subtype was the *only* place for these.
-        // So we do NOT write OTBM_ATTR_COUNT or OTBM_ATTR_CHARGES/OTBM_ATTR_RUNE_CHARGES for OTBMv1 here.
-        // TODO (Task51-OTBMv1): Confirm this interpretation. If OTBMv1 items can *also* have these as attributes beyond initial subtype.
-    } else { // Later OTBM Versions (mapOtbmFormatVersion >= 1, i.e., OTBM v2+)
+    // OTBMv1 (mapOtbmFormatVersion == 0) stores count/charges of stackables, splashes and fluids
+    // as the initial subtype byte written by serializeOtbmNode, so they are not repeated here.
+    if (mapOtbmFormatVersion != 0) {
         if (iType.isStackable) {
             if (getCount() > 0) {
-                stream << static_cast<quint8>(OTBM_ATTR_COUNT);
-                stream << static_cast<quint16>(sizeof(quint8));
-                stream << static_cast<quint8>(getCount());
+                writer.writeAttributeByte(OTBM_ATTR_COUNT, static_cast<quint8>(getCount()));
             }
         }
         // For non-stackable charged items (runes, amulets, etc.)
@@ -852,71 +752,66 @@ bool Item::serializeOtbmAttributes(QDataStream& stream, quint32 mapOtbmFormatVer
             // Use OTB item minor version (ClientVersionID). CLIENT_VERSION_820 is 10.
             // TODO (Task51-ClientVer): Confirm '10' for CLIENT_VERSION_820.
             if (otbItemsMinorVersion >= 10) { // CLIENT_VERSION_820 or newer
-                if (getCharges() > 0) {
-                    stream << static_cast<quint8>(OTBM_ATTR_CHARGES); // Use OTBM_ATTR_CHARGES (u16)
-                    stream << static_cast<quint16>(sizeof(quint16));
-                    stream << static_cast<quint16>(getCharges());
-                }
-            } else { // Older clients might use OTBM_ATTR_RUNE_CHARGES (u8) or omit for some items.
-                if (iType.group == ITEM_GROUP_RUNE && getCharges() > 0) { // Example: only write for runes on old clients
-                   stream << static_cast<quint8>(OTBM_ATTR_RUNE_CHARGES);
-                   stream << static_cast<quint16>(sizeof(quint8));
-                   stream << static_cast<quint8>(getCharges());
+                if (charges() > 0) {
+                    writer.writeAttributeU16(OTBM_ATTR_CHARGES, static_cast<quint16>(charges()));
                 }
-                // Other non-rune charged items on old clients might not save charges attribute.
+            } else if (iType.group == ITEM_GROUP_RUNE && charges() > 0) {
+                // Older clients only keep rune charges, as OTBM_ATTR_RUNE_CHARGES (u8).
+                writer.writeAttributeByte(OTBM_ATTR_RUNE_CHARGES, static_cast<quint8>(charges()));
             }
         }
     }
-    // Note: OTBM_ATTR_RUNE_CHARGES could also be handled if needed for newer versions if distinct from general charges.
 
-    if (getActionId() > 0) { // getActionId() retrieves from AttrActionID
-        writeNumericAttribute<quint16>(OTBM_ATTR_ACTION_ID, getActionId());
+    if (actionId_ > 0) {
+        writer.writeAttributeU16(OTBM_ATTR_ACTION_ID, actionId_);
     }
-    if (getUniqueId() > 0) { // getUniqueId() retrieves from AttrUniqueID
-        writeNumericAttribute<quint16>(OTBM_ATTR_UNIQUE_ID, getUniqueId());
+    if (uniqueId_ > 0) {
+        writer.writeAttributeU16(OTBM_ATTR_UNIQUE_ID, uniqueId_);
     }
-    if (classification_ > 0) { // Tier/Classification - direct member
-        writeNumericAttribute<quint16>(OTBM_ATTR_TIER, classification_);
+    if (hasAttribute(AttributeKey::Tier) && ex.tier > 0) { // Tier/Classification - instance value only
+        writer.writeAttributeU16(OTBM_ATTR_TIER, ex.tier);
     }
 
-    if (hasAttribute(Item::AttrDuration) && getAttribute(Item::AttrDuration).toUInt() > 0) {
-        writeNumericAttribute<quint32>(OTBM_ATTR_DURATION, getAttribute(Item::AttrDuration).toUInt());
+    if (hasAttribute(AttributeKey::Duration) && ex.duration > 0) {
+        writer.writeAttributeU32(OTBM_ATTR_DURATION, ex.duration);
     }
-    if (hasAttribute(Item::AttrDepotID) && getAttribute(Item::AttrDepotID).toUInt() > 0) {
-        writeNumericAttribute<quint16>(OTBM_ATTR_DEPOT_ID, static_cast<quint16>(getAttribute(Item::AttrDepotID).toUInt()));
+    if (hasAttribute(AttributeKey::DepotId) && ex.depotId > 0) {
+        writer.writeAttributeU16(OTBM_ATTR_DEPOT_ID, ex.depotId);
     }
 
-    if (hasAttribute(Item::AttrTeleDestX)) {
-        stream << static_cast<quint8>(OTBM_ATTR_TELE_DEST);
-        stream << static_cast<quint16>(sizeof(quint16) * 2 + sizeof(quint8)); // Size of x, y, z
-        stream << static_cast<quint16>(getAttribute(Item::AttrTeleDestX).toUInt());
-        stream << static_cast<quint16>(getAttribute(Item::AttrTeleDestY).toUInt());
-        stream << static_cast<quint8>(getAttribute(Item::AttrTeleDestZ).toUInt());
+    if (hasAttribute(AttributeKey::TeleDestX)) {
+        uchar dest[5];
+        qToLittleEndian<quint16>(ex.teleDestX, dest);
+        qToLittleEndian<quint16>(ex.teleDestY, dest + 2);
+        dest[4] = ex.teleDestZ;
+        writer.writeAttributeData(OTBM_ATTR_TELE_DEST, QByteArrayView(reinterpret_cast<const char*>(dest), sizeof(dest)));
     }
 
-    // TODO: Serialize other generic attributes from m_attributes if they don't map to known OTBM types
+    // TODO: Serialize custom attributes (ex.custom) if they don't map to known OTBM types
     // This might involve using OTBM_ATTR_ATTRIBUTE_MAP for TFS 1.x+ style custom attributes.
     // For now, only known/typed attributes are serialized.
 
-    return stream.status() == QDataStream::Ok;
+    return true;
 }
 
-bool Item::serializeOtbmNode(QDataStream& stream, quint32 mapOtbmFormatVersion, quint32 otbItemsMajorVersion, quint32 otbItemsMinorVersion) const {
-    stream.setByteOrder(QDataStream::LittleEndian);
+bool Item::serializeOtbmNode(OtbmWriter& writer, quint32 mapOtbmFormatVersion, quint32 otbItemsMajorVersion, quint32 otbItemsMinorVersion) const {
+    writer.beginNode(OTBM_ITEM);
+    writer.writeU16(getServerId());
 
-    stream << static_cast<quint8>(OTBM_ITEM); // Use OTBM_NodeTypes_t enum value
-    stream << getServerId(); // quint16 serverId_ member
-
-    // Write attributes. The OTBM format implies attributes follow directly.
-    // The overall length of the item node (including attributes) is typically handled
-    // by the calling OtbmWriter when it finalizes the node.
-    if (!serializeOtbmAttributes(stream, mapOtbmFormatVersion, otbItemsMajorVersion, otbItemsMinorVersion)) {
-        return false;
+    // OTBMv1: stackables, splashes and fluids carry their count/subtype as a byte right after
+    // the id (mirrors OtbmReader::readItem).
+    if (mapOtbmFormatVersion == 0) {
+        const ItemProperties& iType = type();
+        if (iType.isStackable) {
+            writer.writeByte(static_cast<quint8>(getCount()));
+        } else if (iType.group == ITEM_GROUP_SPLASH || iType.group == ITEM_GROUP_FLUID) {
+            writer.writeByte(static_cast<quint8>(charges()));
+        }
     }
 
-    // After attributes, for OTBM, an end byte (0xFF) is typically written by the OtbmWriter
-    // to signify the end of the current node's properties/attributes, before writing children.
-    // This method only serializes the item's direct properties. Node structure is for OtbmWriter.
+    const bool ok = serializeOtbmAttributes(writer, mapOtbmFormatVersion, otbItemsMajorVersion, otbItemsMinorVersion);
 
-    return stream.status() == QDataStream::Ok;
+    // Container contents would be written here as child OTBM_ITEM nodes.
+    writer.endNode();
+    return ok;
 }
@@ -1,73 +1,146 @@
 #ifndef ITEM_H
 #define ITEM_H
 
-#include <QObject>
 #include <QString>
 #include <QMap>
 #include <QVariant>
+#include <QSharedData> // For ItemExtraAttributes
 #include <QtGlobal> // For quint16
-#include <QDataStream> // For unserializeOtbmAttributes
+#include <QByteArrayView> // For unserializeOtbmAttribute
 
 #include <QRectF> // For draw method targetRect
 #include "DrawingOptions.h" // For draw method options
 #include "ItemManager.h" // For ItemGroup_t, ItemTypes_t
+#include "MapArena.h"    // Item storage
 
 // Forward declarations
 class QPainter;
 class Brush; // Added forward declaration for Brush
+class OtbmWriter; // For serializeOtbmNode
+struct SnapshotItemRecord; // For the snapshot records (io/MapSnapshot.h)
+class Tile;  // Owning tile (tiles are not QObjects, so they cannot be the QObject parent)
 // QRectF is included above via #include <QRectF>
 // QVariantMap is typedef for QMap<QString, QVariant> - no need to forward declare if QMap is included
 
-class Item : public QObject {
-    Q_OBJECT
+// Rarely used per-instance attributes. Allocated only once one of them is set and
+// implicitly shared between copies, so most items pay a single null pointer for it.
+struct ItemExtraAttributes : public QSharedData {
+    QString text;
+    QString description;
+    QString writer;
+    QString article;
+    quint32 duration = 0;
+    quint16 depotId = 0;
+    quint16 tier = 0;
+    quint16 teleDestX = 0;
+    quint16 teleDestY = 0;
+    quint8 teleDestZ = 0;
+    QMap<QString, QVariant> custom; // Free-form attributes without a typed slot (e.g. unknown OTBM attributes)
+};
+
+// Decoders for OTBM item attributes, one per attribute id, as tables built at compile time
+// (see Item.cpp). Each entry writes the value straight into the item's typed fields. The
+// few attributes whose meaning depends on the map's format or items version get one table
+// per variant; Item::otbmAttributeDecoders() picks the right one once per file, so nothing
+// is decided per item.
+struct ItemAttributeDecoders {
+    // Returns false if data is too short for the attribute. data is not retained.
+    using Decoder = bool (*)(Item& item, quint8 attributeId, QByteArrayView data);
+
+    Decoder byId[256];
+    bool initialSubtype; // OTBMv1: stackables, splashes and fluids store a subtype byte after the id
+};
 
+// An Item instance is deliberately small: it stores only its server id and the
+// per-instance data written to OTBM (count, action/unique id, text, teleport
+// destination, ...). Everything that is the same for every item of a type
+// (flags, top order, names, weight, light, ...) is read from the shared, immutable
+// ItemProperties record in ItemManager, looked up by server id. Changing the
+// server id therefore changes the item's whole type.
+class Item {
 public:
     // Constructors & Destructor
-    explicit Item(quint16 serverId, QObject *parent = nullptr);
-    ~Item() override;
+    explicit Item(quint16 serverId);
+    virtual ~Item();
+
+    // Items live in the current MapArena; the sized delete gets the dynamic size via the virtual destructor
+    static void* operator new(size_t size) { return MapArena::current()->allocate(size); }
+    static void operator delete(void* p, size_t size) { MapArena::deallocate(p, size); }
 
     // Modified State
     bool isModified() const { return m_modified; }
     void setModified(bool modified);
 
+    // Tile this item currently lies on; set by Tile when the item is added or removed.
+    // Also keeps the item's MapArena bookkeeping: while on a tile it is dropped with the
+    // tile's arena, unless it needs a finalizer; taken off a tile it is pinned (see MapArena).
+    Tile* ownerTile() const { return ownerTile_; }
+    void setOwnerTile(Tile* tile);
+
+    // Shared type descriptor for this item's server id
+    const ItemProperties& type() const { return ItemManager::instance()->getItemProperties(serverId_); }
+    const ItemTypeText& typeText() const { return ItemManager::instance()->getItemText(serverId_); } // Names and descriptions
+
     // Core Properties
     quint16 getServerId() const;
-    void setServerId(quint16 id); // Typically fixed after creation, but providing setter for flexibility
+    void setServerId(quint16 id); // Switches the item to another type; instance attributes are kept
 
     quint16 getClientId() const;
-    void setClientId(quint16 id);
-
     QString name() const;
-    void setName(const QString& name);
-
     QString typeName() const; 
-    void setTypeName(const QString& typeName);
 
-    // Generic Attribute System
+    // Typed attribute keys. The first block lives in fixed fields of the item, the rest in
+    // ItemExtraAttributes; anything else is a Custom attribute addressed by name only.
+    enum class AttributeKey : quint8 {
+        Count = 0,
+        ActionId,
+        UniqueId,
+        Charges,
+        Text,
+        Description,
+        Writer,
+        Article,
+        Duration,
+        DepotId,
+        Tier,
+        TeleDestX,
+        TeleDestY,
+        TeleDestZ,
+        Last,
+        Custom = 0xFF
+    };
+    static AttributeKey attributeKey(const QString& name); // Custom if name has no typed slot
+    static QString attributeName(AttributeKey key);
+
+    bool hasAttribute(AttributeKey key) const { return (attrMask_ & attributeBit(key)) != 0; }
+    QVariant getAttribute(AttributeKey key, const QVariant& defaultValue = QVariant()) const;
+    void setAttribute(AttributeKey key, const QVariant& value);
+    void clearAttribute(AttributeKey key);
+
+    // Generic Attribute System (by name; typed keys are resolved through attributeKey())
     void setAttribute(const QString& key, const QVariant& value);
     QVariant getAttribute(const QString& key, const QVariant& defaultValue = QVariant()) const;
     bool hasAttribute(const QString& key) const;
     void clearAttribute(const QString& key);
-    const QMap<QString, QVariant>& getAttributes() const; 
+    QMap<QString, QVariant> getAttributes() const; // Snapshot of all set attributes, typed and custom
 
-    // Specific Attribute Accessors (examples, more can be added)
-    int getCount() const;
+    // Specific Attribute Accessors
+    int getCount() const { return hasAttribute(AttributeKey::Count) ? count_ : 1; }
     void setCount(int count);
 
     QString getText() const;
     void setText(const QString& text);
 
-    int getActionId() const;
+    int getActionId() const { return actionId_; }
     void setActionId(int id);
 
-    int getUniqueId() const;
+    int getUniqueId() const { return uniqueId_; }
     void setUniqueId(int id);
     
     // Add more specific attribute getters/setters as identified from wxItem
     // e.g., charges, duration, fluidType etc.
 
-    // Boolean Flags (derived from ItemType, set by ItemManager or specific subclasses)
-    // Getters
+    // Boolean Flags (read from the shared ItemProperties of this item's type)
     bool isMoveable() const;
     bool isBlocking() const;      
     bool blocksMissiles() const;  
@@ -86,42 +159,23 @@ public:
     bool hasHookSouth() const;
     bool hasHookEast() const;
     bool hasHeight() const;       
+    bool isUseable() const;
+    bool isWall() const;
     // Add more as per ItemPropertyFlag in wxItem and ItemType properties
 
     // Brush-related properties
     bool isTable() const;
     bool isCarpet() const; // <-- ADDED THIS LINE
-    // Add isCarpet(), isWall() etc. here if they follow the same pattern of querying ItemTypeData
-
-    // Setters for these flags (mainly for ItemManager/subclass setup)
-    void setMoveable(bool on);
-    void setBlocking(bool on);
-    void setBlocksMissiles(bool on);
-    void setBlocksPathfind(bool on);
-    void setStackable(bool on);
-    void setGroundTile(bool on);
-    void setAlwaysOnTop(bool on);
-    void setTopOrder(int order);
-    void setIsTeleport(bool on); 
-    void setIsContainer(bool on); 
-    void setReadable(bool on);
-    void setCanWriteText(bool on);
-    void setPickupable(bool on);
-    void setRotatable(bool on);
-    void setHangable(bool on);
-    void setHasHookSouth(bool on);
-    void setHasHookEast(bool on);
-    void setHasHeight(bool on);
-
 
     // Other methods
-    virtual QString getDescription() const; // Now a dedicated member, getter remains.
+    virtual QString getDescription() const;
     virtual void drawText(QPainter* painter, const QRectF& targetRect, const QMap<QString, QVariant>& options); // Changed QVariantMap to QMap
+    // With DrawingOptions::sprites/spriteBatch set, adds the item's frame to the batch;
+    // otherwise (or without a frame for the item) paints a placeholder.
     virtual void draw(QPainter* painter, const QRectF& targetRect, const DrawingOptions& options) const;
-    virtual Item* deepCopy() const; 
+    virtual Item* deepCopy() const; // Copies server id and instance attributes only
 
-    // New dedicated property getters
-    QString descriptionText() const; // Renamed to avoid conflict with virtual getDescription
+    // Type-level property getters (from ItemProperties)
     QString editorSuffix() const;
     ItemGroup_t itemGroup() const;
     ItemTypes_t itemType() const;
@@ -129,7 +183,6 @@ public:
     qint16 attack() const;
     qint16 defense() const;
     qint16 armor() const;
-    quint16 charges() const;
     quint16 maxTextLen() const;
     quint16 rotateTo() const;
     quint16 volume() const;
@@ -137,27 +190,15 @@ public:
     quint8 weaponType() const;
     quint16 lightLevel() const;
     quint16 lightColor() const;
-    quint16 classification() const;
 
     class Brush* getBrush() const; // Returns the brush associated with this item's type
 
-    // New dedicated property setters
+    // Instance properties that default to the type value until set on the item
+    QString descriptionText() const; // Renamed to avoid conflict with virtual getDescription
     void setDescriptionText(const QString& description); // Renamed
-    void setEditorSuffix(const QString& suffix);
-    void setItemGroup(ItemGroup_t group);
-    void setItemType(ItemTypes_t type);
-    void setWeight(float weight);
-    void setAttack(qint16 attack);
-    void setDefense(qint16 defense);
-    void setArmor(qint16 armor);
+    quint16 charges() const;
     void setCharges(quint16 charges);
-    void setMaxTextLen(quint16 len);
-    void setRotateTo(quint16 id);
-    void setVolume(quint16 volume);
-    void setSlotPosition(quint32 slotPos);
-    void setWeaponType(quint8 type);
-    void setLightLevel(quint16 level);
-    void setLightColor(quint16 color);
+    quint16 classification() const;
     void setClassification(quint16 classification);
 
     // Helper methods
@@ -165,17 +206,26 @@ public:
     bool isSplash() const;
     bool isCharged() const;
 
-    // Returns true if successful, false on error (e.g., stream error)
-    // Stream should be positioned at the start of the item's attribute block.
-    // This method will read all attributes for this item.
-    // TODO (Task51): Consider if client version is needed for attribute interpretation.
-    // If so, this method might need access to Map's version information.
-    bool unserializeOtbmAttributes(QDataStream& stream, quint32 otbItemsMajorVersion, quint32 otbItemsMinorVersion); // Signature from previous step, no change here.
+    // Decoder table for a map's OTBM format version and items version (see ItemAttributeDecoders).
+    static const ItemAttributeDecoders& otbmAttributeDecoders(quint32 mapOtbmFormatVersion, quint32 otbItemsMajorVersion, quint32 otbItemsMinorVersion);
 
-    // Returns true if successful, false on stream error.
+    // Applies one OTBM item attribute. data is the attribute's (already unescaped) value,
+    // usually a view straight into the mapped map file; it is not retained. The item is not
+    // marked modified. Returns false if the value is too short for the attribute.
+    bool unserializeOtbmAttribute(const ItemAttributeDecoders& decoders, quint8 attributeId, QByteArrayView data) {
+        return decoders.byId[attributeId](*this, attributeId, data);
+    }
+
+    // Appends the item's attributes / its complete OTBM_ITEM node (markers included) to writer.
     // TODO (Task51): Consider if client version affects how attributes are written.
-    bool serializeOtbmAttributes(QDataStream& stream, quint32 mapOtbmFormatVersion, quint32 otbItemsMajorVersion, quint32 otbItemsMinorVersion) const; // UPDATED
-    bool serializeOtbmNode(QDataStream& stream, quint32 mapOtbmFormatVersion, quint32 otbItemsMajorVersion, quint32 otbItemsMinorVersion) const; // UPDATED
+    bool serializeOtbmAttributes(OtbmWriter& writer, quint32 mapOtbmFormatVersion, quint32 otbItemsMajorVersion, quint32 otbItemsMinorVersion) const;
+    bool serializeOtbmNode(OtbmWriter& writer, quint32 mapOtbmFormatVersion, quint32 otbItemsMajorVersion, quint32 otbItemsMinorVersion) const;
+
+    // Editor snapshot (see MapSnapshot): the fixed fields go into record as they are, the extra
+    // attributes (if any) are appended to extras. fromSnapshotRecord() creates the item in the
+    // current MapArena; extra is the record's share of the extras, empty if it has none.
+    void writeSnapshotRecord(SnapshotItemRecord& record, QByteArray& extras) const;
+    static Item* fromSnapshotRecord(const SnapshotItemRecord& record, QByteArrayView extra);
 
 public:
     // Attribute Keys
@@ -183,8 +233,8 @@ public:
     static const QString AttrActionID;
     static const QString AttrUniqueID;
     static const QString AttrText;
-    static const QString AttrDescription; // Note: distinct from member description_ for "look" text
-    static const QString AttrCharges;     // Note: distinct from member charges_
+    static const QString AttrDescription; // Per-instance override of the type's look description
+    static const QString AttrCharges;     // Per-instance override of the type's default charges
     static const QString AttrDuration;
     static const QString AttrWriter;
     static const QString AttrArticle;
@@ -194,59 +244,34 @@ public:
     static const QString AttrTeleDestZ;
     static const QString AttrDepotID;
 
-signals:
-    void attributeChanged(const QString& key, const QVariant& newValue);
-    void propertyChanged(); 
-
 private:
+    friend struct ItemOtbmDecoding; // The decoder table entries (Item.cpp)
+
+    static quint16 attributeBit(AttributeKey key) { return static_cast<quint16>(1u << static_cast<quint8>(key)); }
+    const ItemExtraAttributes& extra() const;
+    void drawDebugInfo(QPainter* painter, const QRectF& targetRect) const;
+    ItemExtraAttributes& extraForWrite();
+
+    enum class ArenaState : quint8 {
+        Untracked, // Not on a tile yet, or on one and dropped with its arena
+        Finalized, // On a tile; registered with the tile's arena (see finalize)
+        Pinned     // Taken off a tile and still alive; must survive MapArena::drop
+    };
+    void trackOnOwnerTile(); // Registers a finalizer if the item cannot simply be dropped
+    void untrack();
+    static void finalize(void* item);
+
+    Tile* ownerTile_ = nullptr; // Not owned
+    QSharedDataPointer<ItemExtraAttributes> extra_; // Null until a rare attribute is set
     quint16 serverId_ = 0;
-    quint16 clientId_ = 0;
-    QString name_;
-    QString itemTypeName_; 
-
-    QMap<QString, QVariant> attributes_;
-
-    // Direct member bool flags for common properties
-    bool isMoveable_ = false;
-    bool isBlocking_ = false;
-    bool blocksMissiles_ = false;
-    bool blocksPathfind_ = false;
-    bool isStackable_ = false;
-    bool isGroundTile_ = false;
-    bool isAlwaysOnTop_ = false; 
-    int topOrder_ = 1;          
-    bool isTeleport_ = false;   
-    bool isContainer_ = false;  
-    bool isReadable_ = false;
-    bool canWriteText_ = false;
-    bool isPickupable_ = false;
-    bool isRotatable_ = false;
-    bool isHangable_ = false;
-    bool hasHookSouth_ = false;
-    bool hasHookEast_ = false;
-    bool hasHeight_ = false;
-
-    // New dedicated members
-    QString description_; // For the item's look description
-    QString editorSuffix_;
-    ItemGroup_t itemGroup_ = ITEM_GROUP_NONE;
-    ItemTypes_t itemType_ = ITEM_TYPE_NONE; 
-    
-    float weight_ = 0.0f;
-    qint16 attack_ = 0;
-    qint16 defense_ = 0;
-    qint16 armor_ = 0;
-    quint16 charges_ = 0; 
-    quint16 maxTextLen_ = 0;
-    quint16 rotateTo_ = 0; 
-    quint16 volume_ = 0;   
-    quint32 slotPosition_ = 0; 
-    quint8 weaponType_ = 0;  
-    quint16 lightLevel_ = 0;
-    quint16 lightColor_ = 0;
-    quint16 classification_ = 0;
-
+    quint16 attrMask_ = 0; // One bit per AttributeKey that is set on this item
+    // Fixed slots for the attributes nearly every saved item uses
+    quint16 count_ = 0;
+    quint16 actionId_ = 0;
+    quint16 uniqueId_ = 0;
+    quint16 charges_ = 0;
     mutable bool m_modified = false;
+    ArenaState arenaState_ = ArenaState::Untracked;
 };
 
 #endif // ITEM_H
@@ -3,11 +3,22 @@
 #include <QFile>
 #include <QDataStream>
 #include <QXmlStreamReader> // For optional XML parsing
+#include <QCryptographicHash> // Item database cache keys
+#include <QStandardPaths>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QElapsedTimer>
+#include <QtEndian>
 #include <QDebug>
+#include <cstring> // For memcpy
+#include <type_traits>
+#include <utility> // For std::as_const
 
 // Static member initialization
 ItemManager* ItemManager::s_instance = nullptr;
 ItemProperties ItemManager::defaultProperties_; 
+ItemTypeText ItemManager::defaultText_;
 
 // OTB specific enums (mirror from wxwidgets/items.h or define appropriately)
 // These might be better in a private section of ItemManager.h or a dedicated OTB parser helper later
@@ -89,6 +100,60 @@ enum ItemFlags_OTB : quint32 {
 };
 
 
+// Item database cache. The merged result of items.otb and items.xml is written to the user's
+// cache directory and memory-mapped on the next start while both files hash the same:
+//   header (ItemCacheHeaderSize bytes): magic, format version, sizeof(ItemProperties),
+//       record count, SHA-1 of items.otb, SHA-1 of items.xml (zeros if none)
+//   records: properties_ as raw ItemProperties, one per server id
+//   texts:   for every defined id, u16 id and u16-length-prefixed UTF-8 name, description
+//            and editor suffix
+// The records are only valid for the build that wrote them, hence the record size check;
+// bump ItemCacheVersion whenever ItemProperties changes without changing its size.
+static_assert(std::is_trivially_copyable<ItemProperties>::value, "ItemProperties is cached as raw bytes");
+
+namespace {
+const char ItemCacheMagic[8] = { 'R', 'M', 'E', 'I', 'T', 'E', 'M', 'S' };
+constexpr quint32 ItemCacheVersion = 1;
+constexpr int ItemCacheHashSize = 20; // SHA-1
+constexpr qsizetype ItemCacheHeaderSize = 64;
+
+QByteArray hashItemSource(const QString& path) {
+    QFile file(path);
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (path.isEmpty() || !file.open(QIODevice::ReadOnly) || !hash.addData(&file)) {
+        return QByteArray(ItemCacheHashSize, '\0');
+    }
+    return hash.result();
+}
+
+QString itemCachePath(const QString& otbPath, const QString& xmlPath) {
+    // One cache per pair of source files, so switching client versions does not thrash it.
+    const QByteArray key = QCryptographicHash::hash(QFileInfo(otbPath).absoluteFilePath().toUtf8() + '\n' +
+                                                    (xmlPath.isEmpty() ? QByteArray() : QFileInfo(xmlPath).absoluteFilePath().toUtf8()),
+                                                    QCryptographicHash::Sha1);
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+           QLatin1String("/items-") + QString::fromLatin1(key.toHex().left(16)) + QLatin1String(".cache");
+}
+
+void appendCacheString(QByteArray& out, const QString& value) {
+    const QByteArray utf8 = value.toUtf8().left(0xFFFF);
+    uchar length[2];
+    qToLittleEndian<quint16>(static_cast<quint16>(utf8.size()), length);
+    out.append(reinterpret_cast<const char*>(length), 2);
+    out.append(utf8);
+}
+
+bool readCacheString(QByteArrayView data, qsizetype& pos, QString& value) {
+    if (data.size() - pos < 2) return false;
+    const quint16 length = qFromLittleEndian<quint16>(data.data() + pos);
+    pos += 2;
+    if (data.size() - pos < length) return false;
+    value = QString::fromUtf8(data.sliced(pos, length));
+    pos += length;
+    return true;
+}
+} // namespace
+
 // Singleton Implementation
 ItemManager* ItemManager::instance() {
     if (!s_instance) {
@@ -98,7 +163,7 @@ ItemManager* ItemManager::instance() {
 }
 
 ItemManager::ItemManager(QObject *parent) : QObject(parent) {
-    defaultProperties_.name = "Unknown Item Type"; // Provide a default name
+    defaultText_.name = "Unknown Item Type"; // Provide a default name
     defaultProperties_.isBlocking = true; // Default unknown items to blocking
 }
 
@@ -108,9 +173,14 @@ ItemManager::~ItemManager() {
 }
 
 void ItemManager::clearDefinitions() {
-    itemPropertiesMap_.clear();
+    properties_.clear();
+    texts_.clear();
+    serverIdByClientId_.clear();
+    typeCount_ = 0;
     loaded_ = false;
     maxServerId_ = 0;
+    otbHash_.clear();
+    xmlHash_.clear();
     emit definitionsCleared();
     qDebug() << "Item definitions cleared.";
 }
@@ -125,6 +195,25 @@ quint16 ItemManager::getMaxServerId() const {
 
 bool ItemManager::loadDefinitions(const QString& otbPath, const QString& xmlPath) {
     clearDefinitions();
+
+    QElapsedTimer timer;
+    timer.start();
+    const QString cachePath = itemCachePath(otbPath, xmlPath);
+    const QByteArray otbHash = hashItemSource(otbPath);
+    const QByteArray xmlHash = hashItemSource(xmlPath);
+    if (loadCache(cachePath, otbHash, xmlHash)) {
+        finishTables();
+        otbHash_ = otbHash;
+        xmlHash_ = xmlHash;
+        loaded_ = true;
+        emit definitionsLoaded();
+        qDebug() << "Item definitions loaded from cache in" << timer.elapsed() << "ms. Max Server ID:" << maxServerId_ << "Total items:" << typeCount_;
+        return true;
+    }
+    if (!properties_.isEmpty()) {
+        clearDefinitions(); // Whatever a rejected cache left behind
+    }
+
     qDebug() << "Loading item definitions from OTB:" << otbPath;
 
     if (!parseOtb(otbPath)) {
@@ -143,12 +232,148 @@ bool ItemManager::loadDefinitions(const QString& otbPath, const QString& xmlPath
         }
     }
 
+    finishTables();
+    saveCache(cachePath, otbHash, xmlHash);
+    otbHash_ = otbHash;
+    xmlHash_ = xmlHash;
     loaded_ = true;
     emit definitionsLoaded();
-    qDebug() << "Item definitions loaded. Max Server ID:" << maxServerId_ << "Total items:" << itemPropertiesMap_.size();
+    qDebug() << "Item definitions loaded in" << timer.elapsed() << "ms. Max Server ID:" << maxServerId_ << "Total items:" << typeCount_;
     return true;
 }
 
+bool ItemManager::loadCache(const QString& cachePath, const QByteArray& otbHash, const QByteArray& xmlHash) {
+    QFile file(cachePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const qint64 fileSize = file.size();
+    uchar* mapped = fileSize >= ItemCacheHeaderSize ? file.map(0, fileSize) : nullptr;
+    if (!mapped) {
+        return false;
+    }
+    const QByteArrayView data(reinterpret_cast<const char*>(mapped), fileSize);
+
+    const quint32 version = qFromLittleEndian<quint32>(mapped + 8);
+    const quint32 recordSize = qFromLittleEndian<quint32>(mapped + 12);
+    const quint32 recordCount = qFromLittleEndian<quint32>(mapped + 16);
+    if (memcmp(mapped, ItemCacheMagic, sizeof(ItemCacheMagic)) != 0 || version != ItemCacheVersion ||
+        recordSize != sizeof(ItemProperties) || recordCount > 0x10000 ||
+        qint64(recordCount) * recordSize > fileSize - ItemCacheHeaderSize) {
+        qDebug() << "ItemManager::loadCache - Ignoring incompatible item cache" << cachePath;
+        return false;
+    }
+    if (memcmp(mapped + 24, otbHash.constData(), ItemCacheHashSize) != 0 ||
+        memcmp(mapped + 24 + ItemCacheHashSize, xmlHash.constData(), ItemCacheHashSize) != 0) {
+        qDebug() << "ItemManager::loadCache - Item files changed since" << cachePath << "was written.";
+        return false;
+    }
+
+    properties_.resize(recordCount);
+    texts_.resize(recordCount);
+    memcpy(static_cast<void*>(properties_.data()), mapped + ItemCacheHeaderSize, qsizetype(recordCount) * recordSize);
+    for (ItemProperties& props : properties_) {
+        props.brush = nullptr; // Brushes register themselves after loading
+        if (props.serverId != 0) {
+            ++typeCount_;
+            maxServerId_ = qMax(maxServerId_, props.serverId);
+        }
+    }
+
+    qsizetype pos = ItemCacheHeaderSize + qsizetype(recordCount) * recordSize;
+    while (pos < data.size()) {
+        if (data.size() - pos < 2) return false;
+        const quint16 serverId = qFromLittleEndian<quint16>(mapped + pos);
+        pos += 2;
+        if (serverId >= recordCount) return false;
+        ItemTypeText& text = texts_[serverId];
+        if (!readCacheString(data, pos, text.name) || !readCacheString(data, pos, text.description) ||
+            !readCacheString(data, pos, text.editorSuffix)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ItemManager::saveCache(const QString& cachePath, const QByteArray& otbHash, const QByteArray& xmlHash) const {
+    QDir().mkpath(QFileInfo(cachePath).absolutePath());
+    QSaveFile file(cachePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "ItemManager::saveCache - Could not open" << cachePath << file.errorString();
+        return;
+    }
+
+    QByteArray header(ItemCacheHeaderSize, '\0');
+    uchar* out = reinterpret_cast<uchar*>(header.data());
+    memcpy(out, ItemCacheMagic, sizeof(ItemCacheMagic));
+    qToLittleEndian<quint32>(ItemCacheVersion, out + 8);
+    qToLittleEndian<quint32>(sizeof(ItemProperties), out + 12);
+    qToLittleEndian<quint32>(properties_.size(), out + 16);
+    memcpy(out + 24, otbHash.constData(), ItemCacheHashSize);
+    memcpy(out + 24 + ItemCacheHashSize, xmlHash.constData(), ItemCacheHashSize);
+
+    QByteArray texts;
+    for (int serverId = 0; serverId < properties_.size(); ++serverId) {
+        if (properties_.at(serverId).serverId == 0) {
+            continue;
+        }
+        const ItemTypeText& text = texts_.at(serverId);
+        uchar id[2];
+        qToLittleEndian<quint16>(static_cast<quint16>(serverId), id);
+        texts.append(reinterpret_cast<const char*>(id), 2);
+        appendCacheString(texts, text.name);
+        appendCacheString(texts, text.description);
+        appendCacheString(texts, text.editorSuffix);
+    }
+
+    const qint64 recordBytes = qint64(properties_.size()) * sizeof(ItemProperties);
+    if (file.write(header) != header.size() ||
+        file.write(reinterpret_cast<const char*>(properties_.constData()), recordBytes) != recordBytes ||
+        file.write(texts) != texts.size() || !file.commit()) {
+        qWarning() << "ItemManager::saveCache - Could not write" << cachePath << file.errorString();
+    }
+}
+
+ItemProperties& ItemManager::defineType(quint16 serverId) {
+    if (serverId >= properties_.size()) {
+        // Grow geometrically; finishTables() trims the slack once parsing is done.
+        const int size = qMax(int(serverId) + 1, int(properties_.size()) * 2);
+        properties_.resize(size);
+        texts_.resize(size);
+    }
+    ItemProperties& props = properties_[serverId];
+    if (props.serverId != serverId) {
+        props.serverId = serverId;
+        ++typeCount_;
+        if (serverId > maxServerId_) {
+            maxServerId_ = serverId;
+        }
+    }
+    return props;
+}
+
+void ItemManager::finishTables() {
+    const int size = properties_.isEmpty() ? 0 : maxServerId_ + 1;
+    properties_.resize(size);
+    properties_.squeeze();
+    texts_.resize(size);
+    texts_.squeeze();
+
+    // Reverse index; where several types share a sprite the lowest server id wins.
+    quint16 maxClientId = 0;
+    for (const ItemProperties& props : std::as_const(properties_)) {
+        if (props.serverId != 0) {
+            maxClientId = qMax(maxClientId, props.clientId);
+        }
+    }
+    serverIdByClientId_.fill(0, maxClientId + 1);
+    for (const ItemProperties& props : std::as_const(properties_)) {
+        if (props.serverId != 0 && props.clientId != 0 && serverIdByClientId_.at(props.clientId) == 0) {
+            serverIdByClientId_[props.clientId] = props.serverId;
+        }
+    }
+}
+
 bool ItemManager::parseOtb(const QString& filePath) {
     QFile file(filePath);
     if (!file.open(QIODevice::ReadOnly)) {
@@ -313,13 +538,10 @@ bool ItemManager::parseOtb(const QString& filePath) {
             }
         }
         if (props.serverId > 0) {
-            if (itemPropertiesMap_.contains(props.serverId)) {
+            if (itemTypeExists(props.serverId)) {
                 qWarning() << "Duplicate server ID in OTB:" << props.serverId << ". Overwriting.";
             }
-            itemPropertiesMap_.insert(props.serverId, props);
-            if (props.serverId > maxServerId_) {
-                maxServerId_ = props.serverId;
-            }
+            defineType(props.serverId) = props;
         } else {
             // This can happen if the OTB is structured with item nodes (0xFE, 0xFD, data, 0xFC, 0xFF)
             // and the loop isn't correctly consuming those markers.
@@ -363,19 +585,15 @@ bool ItemManager::parseXml(const QString& filePath) {
                 currentItemDebugName = xml.attributes().value("name").toString();
 
                 for (quint16 idToProcess = currentServerId; idToProcess <= (isRange ? rangeToId : currentServerId); ++idToProcess) {
-                    if (!itemPropertiesMap_.contains(idToProcess)) {
-                        // This means XML has an item that OTB didn't. Create a new entry.
-                        // qDebug() << "XML defines new item ID" << idToProcess << " (" << currentItemDebugName << ").";
-                        itemPropertiesMap_[idToProcess].serverId = idToProcess; // Initialize with serverId
-                        if (idToProcess > maxServerId_) maxServerId_ = idToProcess;
-                    }
-                    ItemProperties& props = itemPropertiesMap_[idToProcess];
+                    // Creates the entry if XML has an item that OTB didn't.
+                    ItemProperties& props = defineType(idToProcess);
+                    ItemTypeText& text = texts_[idToProcess];
                     
                     if(xml.attributes().hasAttribute("name")) {
-                        props.name = xml.attributes().value("name").toString();
+                        text.name = xml.attributes().value("name").toString();
                     }
                      if(xml.attributes().hasAttribute("editorsuffix")) { // RME specific for display name
-                        props.editorSuffix = xml.attributes().value("editorsuffix").toString();
+                        text.editorSuffix = xml.attributes().value("editorsuffix").toString();
                     }
                     // ClientID might also be in XML, overriding OTB or setting if new
                     if(xml.attributes().hasAttribute("clientid")) {
@@ -413,7 +631,7 @@ bool ItemManager::parseXml(const QString& filePath) {
                                 else if (valueStr == "container") props.group = ITEM_GROUP_CONTAINER;
                                 // ... etc for ItemGroup_t
                             } else if (key == "description") {
-                                props.description = valueStr;
+                                text.description = valueStr;
                             } else if (key == "weight") {
                                 props.weight = valueStr.toFloat(&ok) / 100.0f; if (!ok) props.weight = 0.0f;
                             } else if (key == "armor") {
@@ -481,96 +699,20 @@ bool ItemManager::parseXml(const QString& filePath) {
 }
 
 
-const ItemProperties& ItemManager::getItemProperties(quint16 serverId) const {
-    auto it = itemPropertiesMap_.constFind(serverId);
-    if (it != itemPropertiesMap_.constEnd()) {
-        return it.value();
-    }
-    // qWarning() << "Request for unknown item ID:" << serverId << "; returning default properties for" << defaultProperties_.name;
-    return defaultProperties_;
-}
-
-bool ItemManager::itemTypeExists(quint16 serverId) const {
-    return itemPropertiesMap_.contains(serverId);
+const ItemTypeText& ItemManager::getItemText(quint16 serverId) const {
+    return itemTypeExists(serverId) ? texts_.at(serverId) : defaultText_;
 }
 
-Item* ItemManager::createItem(quint16 serverId, QObject* parent) const {
+Item* ItemManager::createItem(quint16 serverId) const {
     if (!itemTypeExists(serverId)) {
         qWarning() << "Attempted to create item with unknown server ID:" << serverId;
-        // Optionally, create a default "unknown" item:
-        // Item* unknownItem = new Item(0, parent); // Use ID 0 for unknown
-        // unknownItem->setName("Unknown Item");
-        // unknownItem->setClientId(defaultProperties_.clientId); // Some default sprite
-        // return unknownItem;
         return nullptr;
     }
-    const ItemProperties& props = getItemProperties(serverId);
 
-    Item* newItem = new Item(props.serverId, parent); 
-    
-    newItem->setClientId(props.clientId);
-    newItem->setName(props.name); 
-    // newItem->setTypeName(); // Item::setTypeName could be used if props had a typeName field.
-
-    // Set new dedicated members using their setters
-    newItem->setDescriptionText(props.description);
-    newItem->setEditorSuffix(props.editorSuffix);
-    newItem->setItemGroup(props.group);
-    newItem->setItemType(props.type); // This might override group-based type setting if XML is more specific
-    newItem->setWeight(props.weight);
-    newItem->setAttack(props.attack);
-    newItem->setDefense(props.defense);
-    newItem->setArmor(props.armor);
-    newItem->setCharges(props.charges); // Uses direct member now
-    newItem->setMaxTextLen(props.maxTextLen); // Uses direct member now
-    newItem->setRotateTo(props.rotateTo);     // Uses direct member now
-    newItem->setVolume(props.volume);
-    newItem->setSlotPosition(props.slotPosition);
-    newItem->setWeaponType(props.weaponType);
-    newItem->setLightLevel(props.lightLevel); // Uses direct member now
-    newItem->setLightColor(props.lightColor); // Uses direct member now
-    newItem->setClassification(props.classification);
-
-    // Set boolean flags from ItemProperties
-    newItem->setMoveable(props.isMoveable);
-    newItem->setBlocking(props.isBlocking);
-    newItem->setBlocksMissiles(props.blockMissiles);
-    newItem->setBlocksPathfind(props.blockPathfind);
-    newItem->setStackable(props.isStackable);
-    newItem->setGroundTile(props.isGroundTile);
-    newItem->setAlwaysOnTop(props.alwaysOnBottom); // Note: OTB ALWAYSONTOP means "draw first" (bottom layer of stack)
-                                                 // Item::isAlwaysOnTop should mean "draw last" (top layer of stack)
-                                                 // This needs careful mapping. If ItemProperties::alwaysOnBottom means draw first,
-                                                 // then Item::isAlwaysOnTop (if it means draw last) should be !props.alwaysOnBottom (potentially)
-                                                 // For now, direct mapping.
-    newItem->setTopOrder(props.topOrder);
-    newItem->setIsTeleport(props.type == ITEM_TYPE_TELEPORT); 
-    newItem->setIsContainer(props.type == ITEM_TYPE_CONTAINER); 
-    newItem->setReadable(props.isReadable);
-    newItem->setCanWriteText(props.canWriteText); // Assuming ItemProperties::canWriteText exists
-    newItem->setPickupable(props.isPickupable);
-    newItem->setRotatable(props.isRotatable);
-    newItem->setHangable(props.isHangable);
-    newItem->setHasHookSouth(props.hasHookSouth);
-    newItem->setHasHookEast(props.hasHookEast);
-    newItem->setHasHeight(props.hasElevation);
-    
-    // Set attributes that are commonly instance-specific but might have type defaults
-    if (props.isStackable) {
-        newItem->setCount(1); // Default count for a newly created stackable item
-    }
-    // Charges are now handled by newItem->setCharges(props.charges) above.
-    // maxTextLen is now handled by newItem->setMaxTextLen(props.maxTextLen) above.
-    // rotateTo is now handled by newItem->setRotateTo(props.rotateTo) above.
-    // lightLevel and lightColor are now handled by their dedicated setters above.
-
-    // Example of a property that might still use generic attributes if not dedicated:
-    // if (props.someCustomAttributeValue != 0) {
-    //     newItem->setAttribute(QStringLiteral("someCustomAttribute"), props.someCustomAttributeValue);
-    // }
-    
-    // ActionID and UniqueID are typically instance-specific and not set from ItemProperties directly,
-    // unless ItemProperties were to store default action/unique IDs for certain types.
+    // Items are flyweights: everything type-level is read from properties_
+    // through Item::type(), so nothing is copied into the new instance here.
+    // Stackable items report a count of 1 until setCount() stores one.
+    Item* newItem = new Item(serverId);
 
     return newItem;
 }
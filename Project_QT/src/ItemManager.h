@@ -4,6 +4,7 @@
 #include <QObject>
 #include <QString>
 #include <QMap>
+#include <QVector>
 #include <QVariant> // For potential future use in ItemProperties if some attributes are generic
 #include <QtGlobal> // For quint16, qint8, etc.
 
@@ -49,14 +50,13 @@ enum ItemTypes_t : quint8 { // Explicitly type to quint8
 };
 
 
-// Corresponds to wxwidgets ItemType and OTB item attributes
+// Corresponds to wxwidgets ItemType and OTB item attributes. Holds only the fields that are
+// read while loading, drawing and editing; the strings are in ItemTypeText. Must stay
+// trivially copyable: the item cache stores these records as raw bytes (see ItemManager.cpp).
 struct ItemProperties {
-    // Core IDs & Name
-    quint16 serverId = 0;
+    // Core IDs
+    quint16 serverId = 0; // 0 for ids without a type
     quint16 clientId = 0; // Sprite ID
-    QString name;
-    QString description; // Often empty, can be derived or from XML
-    QString editorSuffix; 
 
     // Flags (mirroring ItemPropertyFlag concepts and wxItemType booleans)
     bool isBlocking = true;       
@@ -70,6 +70,7 @@ struct ItemProperties {
     bool isGroundTile = false;    // Is this a "ground" item like terrain
     bool alwaysOnBottom = false;  // If true, rendered first (like ground tiles)
     bool isReadable = false;      
+    bool canWriteText = false;    // writeable / writeonceitemid in items.xml
     bool isRotatable = false;     
     bool isHangable = false;      
     bool hasHookEast = false;     
@@ -120,6 +121,14 @@ struct ItemProperties {
     ItemProperties() = default; 
 };
 
+// Rarely read per-type strings, kept apart from ItemProperties so the records looked up
+// for every item stay small and densely packed.
+struct ItemTypeText {
+    QString name;
+    QString description; // Often empty, can be derived or from XML
+    QString editorSuffix;
+};
+
 
 class ItemManager : public QObject {
     Q_OBJECT
@@ -128,12 +137,26 @@ public:
     static ItemManager* instance(); 
 
     bool loadDefinitions(const QString& otbPath, const QString& xmlPath = QString());
-    const ItemProperties& getItemProperties(quint16 serverId) const;
-    bool itemTypeExists(quint16 serverId) const;
-    Item* createItem(quint16 serverId, QObject* parent = nullptr); // Returns Item pointer, parent for Qt ownership
+    // Type lookups are plain array reads indexed by server id; unknown ids get a default record.
+    const ItemProperties& getItemProperties(quint16 serverId) const {
+        return serverId < properties_.size() ? properties_.at(serverId) : defaultProperties_;
+    }
+    const ItemTypeText& getItemText(quint16 serverId) const;
+    bool itemTypeExists(quint16 serverId) const {
+        return serverId != 0 && serverId < properties_.size() && properties_.at(serverId).serverId == serverId;
+    }
+    // Server id of the first type drawn with clientId, or 0 if there is none.
+    quint16 getServerIdForClientId(quint16 clientId) const {
+        return clientId < serverIdByClientId_.size() ? serverIdByClientId_.at(clientId) : 0;
+    }
+    Item* createItem(quint16 serverId) const; // Caller (usually a Tile) owns the returned item
     void clearDefinitions();
     bool isLoaded() const;
     quint16 getMaxServerId() const;
+    // SHA-1 of the items.otb and items.xml the definitions were loaded from (zeros for a missing
+    // items.xml); empty while nothing is loaded. Map snapshots record them (see MapSnapshot).
+    QByteArray otbHash() const { return otbHash_; }
+    QByteArray xmlHash() const { return xmlHash_; }
 
 
 signals:
@@ -149,12 +172,27 @@ private:
     bool parseOtb(const QString& filePath);
     bool parseXml(const QString& filePath); 
 
-    QMap<quint16, ItemProperties> itemPropertiesMap_;
+    // Precompiled item database (see ItemManager.cpp), keyed by the hashes of the source files.
+    bool loadCache(const QString& cachePath, const QByteArray& otbHash, const QByteArray& xmlHash);
+    void saveCache(const QString& cachePath, const QByteArray& otbHash, const QByteArray& xmlHash) const;
+
+    // Record for serverId while parsing, creating it (and growing the tables) if needed.
+    ItemProperties& defineType(quint16 serverId);
+    void finishTables(); // Trims the tables and builds serverIdByClientId_
+
+    // Indexed by server id; slots without a type have serverId == 0. texts_ runs parallel to properties_.
+    QVector<ItemProperties> properties_;
+    QVector<ItemTypeText> texts_;
+    QVector<quint16> serverIdByClientId_; // Indexed by client id
+    int typeCount_ = 0;
     bool loaded_ = false;
     quint16 maxServerId_ = 0;
+    QByteArray otbHash_;
+    QByteArray xmlHash_;
 
     static ItemManager* s_instance;
     static ItemProperties defaultProperties_; // For returning on unknown ID, or if ID 0 is requested
+    static ItemTypeText defaultText_;
 };
 
 #endif // ITEMMANAGER_H
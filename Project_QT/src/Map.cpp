@@ -5,7 +5,16 @@
 #include "Spawn.h"
 #include "Waypoint.h"
 #include "io/OtbmReader.h" // For OTBM reading logic
+#include <QtEndian>        // For qFromLittleEndian on attribute views
+#include <QThread>         // For QThread::idealThreadCount
+#include <QThreadPool>     // Parallel tile area decoding and encoding
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QScopedArrayPointer>
+#include <QBuffer>         // Snapshot skeleton
 #include "io/OtbmWriter.h" // For OTBM writing logic
+#include "io/MapCompression.h" // For *.otbm.gz maps
+#include "io/MapSnapshot.h"    // Native snapshots for fast reopening
 #include "OtbmTypes.h"     // For OTBM node and attribute types
 #include "ItemManager.h"   // For ItemManager::getInstancePtr()
 #include "Town.h"
@@ -13,7 +22,9 @@
 #include <QDebug>
 #include <QSet>
 #include <QVector3D>
-// #include <algorithm>
+#include <QMap>
+#include <algorithm>
+#include <utility> // For std::as_const
 
 // Note: MapPos struct is assumed to be defined in Map.h as per previous step.
 // If it were not, it would need to be defined here or included.
@@ -48,7 +59,7 @@ Map::Map(int width, int height, int floors, const QString& description, QObject
 
 Map::~Map() {
     // It's generally safer to delete objects that might depend on the map (like selection_)
-    // *before* clearing the map's core data (like tiles_).
+    // *before* clearing the map's core data (like chunks_).
     delete selection_;
     selection_ = nullptr;
     clear();
@@ -62,10 +73,7 @@ void Map::initialize(int width, int height, int floors, const QString& descripti
     floors_ = floors;
     description_ = description;
 
-    if (width_ > 0 && height_ > 0 && floors_ > 0) {
-        tiles_.resize(width_ * height_ * floors_);
-        tiles_.fill(nullptr); // Initialize all tile pointers to nullptr
-    }
+    // No tile storage is allocated up front; chunks are created on demand by createTile/setTile.
     qDebug() << "Map initialized with dimensions:" << width_ << "x" << height_ << "x" << floors_;
 
     m_modified = false;
@@ -79,13 +87,20 @@ void Map::initialize(int width, int height, int floors, const QString& descripti
 }
 
 void Map::clear() {
-    qDebug() << "Clearing map. Deleting" << tiles_.count() << "tile slots.";
-    for (Tile* tile : tiles_) {
-        if (tile) {
-            delete tile;
-        }
-    }
-    tiles_.clear();
+    qDebug() << "Clearing map. Dropping" << tileCount_ << "tiles in" << chunks_.size() << "chunks.";
+    // Tiles and items are not deleted one by one: they go with arena_ below. Only the chunk
+    // shells (and with them the zone id tables) are freed here.
+    qDeleteAll(chunks_);
+    chunks_.clear();
+    tileCount_ = 0;
+    tileAreaCache_.clear();
+    dirtyTileAreas_.clear();
+    pendingTileAreas_.clear();
+    releasePendingSource();
+    snapshotCurrent_ = false;
+    snapshotChunkCache_.clear();
+    dirtySnapshotChunks_.clear();
+    arena_.drop(); // Finalizes the few tiles/items owning other memory, then frees all blocks in one sweep
 
     // For Spawns, Houses, Waypoints: If Map owns them, they should be deleted.
     // Consider using qDeleteAll for QList<T*> if ownership is established.
@@ -163,19 +178,44 @@ bool Map::isCoordValid(int x, int y, int z) const {
            z >= 0 && z < floors_;
 }
 
-int Map::getTileIndex(int x, int y, int z) const {
-    if (!isCoordValid(x, y, z)) {
-        return -1;
+MapChunk* Map::findChunk(int x, int y, int z) const {
+    if (!pendingTileAreas_.isEmpty()) {
+        // Decoding an area on first touch is not a logical change to the map.
+        const_cast<Map*>(this)->loadPendingTileArea(tileAreaKey(x, y, z));
+    }
+    return chunks_.value(chunkKey(x, y, z), nullptr);
+}
+
+MapChunk* Map::getOrCreateChunk(int x, int y, int z) {
+    if (!pendingTileAreas_.isEmpty()) {
+        loadPendingTileArea(tileAreaKey(x, y, z)); // Otherwise the area's tiles would later replace this one
+    }
+    MapChunk*& chunk = chunks_[chunkKey(x, y, z)];
+    if (!chunk) {
+        chunk = new MapChunk();
+        chunk->map = this;
+        chunk->baseX = x & ~MapChunk::Mask;
+        chunk->baseY = y & ~MapChunk::Mask;
+        chunk->z = z;
+    }
+    return chunk;
+}
+
+void Map::releaseChunkIfEmpty(int x, int y, int z) {
+    const quint64 key = chunkKey(x, y, z);
+    auto it = chunks_.find(key);
+    if (it != chunks_.end() && it.value()->tileCount == 0) {
+        delete it.value();
+        chunks_.erase(it);
     }
-    return (z * height_ + y) * width_ + x;
 }
 
 Tile* Map::getTile(int x, int y, int z) const {
-    int index = getTileIndex(x, y, z);
-    if (index != -1 && index < tiles_.size()) { // Check index < tiles_.size() for safety
-        return tiles_.value(index); // QVector::value is safe for out-of-bounds
+    if (!isCoordValid(x, y, z)) {
+        return nullptr;
     }
-    return nullptr;
+    const MapChunk* chunk = findChunk(x, y, z);
+    return chunk ? chunk->tiles[chunkSlot(x, y)] : nullptr;
 }
 
 Tile* Map::getTile(const MapPos& pos) const {
@@ -183,8 +223,7 @@ Tile* Map::getTile(const MapPos& pos) const {
 }
 
 bool Map::setTile(int x, int y, int z, Tile* tile) {
-    int index = getTileIndex(x, y, z);
-    if (index == -1) {
+    if (!isCoordValid(x, y, z)) {
         qWarning() << "setTile: Invalid coordinates (" << x << "," << y << "," << z << ")";
         if (tile) { // If a tile was passed but coords are invalid, caller might leak it.
             qWarning() << "setTile: Tile provided for invalid coordinates will not be managed by map.";
@@ -192,20 +231,38 @@ bool Map::setTile(int x, int y, int z, Tile* tile) {
         return false;
     }
 
-    if (index >= tiles_.size()) { // Should not happen if getTileIndex uses isCoordValid properly
-         qWarning() << "setTile: Index out of bounds (" << index << ")";
-         return false;
+    // clear() drops tiles with arena_ without deleting them, so a tile from anywhere else
+    // would never be freed.
+    if (tile && MapArena::arenaOf(tile) != &arena_) {
+        qWarning() << "setTile: Tile was not allocated in this map's arena (use MapArena::Scope(map.arena())); not managed by map.";
+        return false;
     }
 
-    if (tiles_[index] != nullptr && tiles_[index] != tile) {
-        delete tiles_[index]; // Delete existing tile if different
+    // Clearing a slot that was never allocated must not create a chunk for it.
+    MapChunk* chunk = tile ? getOrCreateChunk(x, y, z) : findChunk(x, y, z);
+    if (chunk) {
+        Tile*& slot = chunk->tiles[chunkSlot(x, y)];
+        if (slot != tile) {
+            if (slot) {
+                delete slot; // Delete existing tile if different
+                --chunk->tileCount;
+                --tileCount_;
+            }
+            slot = tile;
+            if (tile) {
+                ++chunk->tileCount;
+                ++tileCount_;
+            }
+            markTileAreaDirty(x, y, z);
+        }
+        if (!tile) {
+            releaseChunkIfEmpty(x, y, z);
+        }
     }
-    tiles_[index] = tile; 
+    markTileAreaDirty(x, y, z);
 
-    if (tile) { // Update tile's own coordinates if it stores them
-        tile->x = x;
-        tile->y = y;
-        tile->z = z;
+    if (tile) { // Tile derives its coordinates from the chunk slot it now occupies
+        tile->attach(chunk, chunkSlot(x, y));
     }
     setModified(true);
     emit mapChanged();
@@ -219,25 +276,38 @@ Tile* Map::createTile(int x, int y, int z) {
         return nullptr;
     }
 
-    int index = getTileIndex(x, y, z);
-    if (index >= tiles_.size()) { // Should not happen
-         qWarning() << "createTile: Index out of bounds (" << index << ")";
-         return nullptr;
-    }
-
-    if (tiles_.value(index) != nullptr) { // Use .value for safety, though index should be valid
-        delete tiles_[index];
-        tiles_[index] = nullptr;
+    MapChunk* chunk = getOrCreateChunk(x, y, z);
+    Tile*& slot = chunk->tiles[chunkSlot(x, y)];
+    if (slot != nullptr) {
+        delete slot;
+    } else {
+        ++chunk->tileCount;
+        ++tileCount_;
     }
 
-    Tile* newTile = new Tile(x, y, z, this); // Pass coordinates and parent
-    tiles_[index] = newTile;
+    MapArena::Scope arenaScope(arena_);
+    Tile* newTile = new Tile(chunk, chunkSlot(x, y)); // Position is implied by the chunk slot
+    slot = newTile;
+    markTileAreaDirty(x, y, z);
     setModified(true);
     emit mapChanged();
     emit tileChanged(x, y, z);
     return newTile;
 }
 
+void Map::notifyTileChanged(int x, int y, int z, bool visual) {
+    emit tileChanged(x, y, z);
+    if (visual) {
+        emit tileVisualChanged(x, y, z);
+    }
+}
+
+void Map::markModified(const Tile* tile) {
+    setModified(true);
+    if (tile) {
+        markTileAreaDirty(tile->x(), tile->y(), tile->z());
+    }
+}
 
 // --- New methods for commands and brushes ---
 
@@ -257,7 +327,7 @@ Tile* Map::getOrCreateTile(int x, int y, int z) {
     }
     Tile* tile = getTile(x, y, z);
     if (!tile) {
-        // createTile handles adding to tiles_ vector, setting tile coordinates, and emitting signals.
+        // createTile handles allocating the chunk slot, setting tile coordinates, and emitting signals.
         tile = createTile(x, y, z);
     }
     return tile;
@@ -272,16 +342,24 @@ void Map::removeTile(int x, int y, int z) {
         qWarning() << "Map::removeTile: Invalid coordinates (" << x << "," << y << "," << z << ")";
         return;
     }
-    int index = getTileIndex(x,y,z);
-    if (index != -1 && index < tiles_.size() && tiles_[index] != nullptr) {
-        // Full removal logic depends on whether the tile must be empty first.
-        // For now, this is a placeholder for what PlaceWallCommand might call in its undo.
-        // A robust version would check tile->isEmpty() or similar.
-        // delete tiles_[index]; // If map owns tiles and this means full deletion
-        // tiles_[index] = nullptr;
-        // emit tileChanged(x,y,z);
-        // emit mapChanged();
-        qDebug() << "Map::removeTile stub called for" << x << "," << y << "," << z << ". Actual removal logic (checking if empty, etc.) deferred.";
+    MapChunk* chunk = findChunk(x, y, z);
+    Tile** slot = chunk ? &chunk->tiles[chunkSlot(x, y)] : nullptr;
+    if (slot && *slot != nullptr) {
+        // Commands (e.g. PlaceWallCommand/PlaceDecorationCommand undo) call this once they
+        // have taken their own items back off the tile; a tile that still holds content stays.
+        if (!(*slot)->isEmpty()) {
+            qDebug() << "Map::removeTile: Tile at" << x << "," << y << "," << z << "is not empty. Keeping it.";
+            return;
+        }
+        delete *slot;
+        *slot = nullptr;
+        --chunk->tileCount;
+        --tileCount_;
+        releaseChunkIfEmpty(x, y, z); // Give the chunk back once its last tile is gone
+        markTileAreaDirty(x, y, z);
+        setModified(true);
+        emit tileChanged(x, y, z);
+        emit mapChanged();
     } else {
          qDebug() << "Map::removeTile: No tile to remove at" << x << "," << y << "," << z << "or index invalid.";
     }
@@ -435,53 +513,434 @@ const QList<Waypoint*>& Map::getWaypoints() const {
 
 #include <QFile>
 #include <QFileInfo>
-// QDataStream is already included for loadFromOTBM/saveToOTBM
+#include <QSaveFile>
+#include <QScopedPointer>
 
 // Load/Save Stubs
-bool Map::load(const QString& path) {
-    QFile file(path);
-    if (!file.open(QIODevice::ReadOnly)) {
-        qWarning() << "Map::load - Could not open file for reading:" << path << "Error:" << file.errorString();
+bool Map::load(const QString& path, MapLoadProgress* progress, MapLoadMode mode) {
+    // A current snapshot spares parsing the file (and inflating it, if compressed). Its
+    // records are adopted in full whatever the mode; that is about as quick as indexing.
+    if (loadSnapshot(path, progress)) {
+        return true;
+    }
+    if (progress && progress->isCanceled()) {
+        return false;
+    }
+
+    // Heap-allocated so an on-demand load can keep the file (and its mapping) open afterwards.
+    QScopedPointer<QFile> file(new QFile(path));
+    if (!file->open(QIODevice::ReadOnly)) {
+        qWarning() << "Map::load - Could not open file for reading:" << path << "Error:" << file->errorString();
         return false;
     }
 
-    QDataStream stream(&file);
-    stream.setByteOrder(QDataStream::LittleEndian); // Ensure consistent byte order for initial checks if any, or for reader
+    // Parse straight out of a read-only mapping of the file; only fall back to reading
+    // it into memory where mapping is not possible.
+    const qint64 fileSize = file->size();
+    uchar* mapped = fileSize > 0 ? file->map(0, fileSize) : nullptr;
+    QByteArray fileData;
+    QByteArrayView data;
+    if (mapped) {
+        data = QByteArrayView(reinterpret_cast<const char*>(mapped), fileSize);
+    } else {
+        qDebug() << "Map::load - Could not map file, reading it instead:" << file->errorString();
+        fileData = file->readAll();
+        data = fileData;
+    }
+
+    // Compressed maps are inflated in full up front; the mapping is not needed after that.
+    // Progress follows the compressed bytes read until the parse below takes over.
+    if (MapCompression::isGzip(data)) {
+        QElapsedTimer timer;
+        timer.start();
+        if (progress) {
+            progress->bytesTotal.storeRelaxed(data.size());
+        }
+        auto inflateProgress = [progress](qint64 bytesConsumed) {
+            if (progress) {
+                progress->bytesConsumed.storeRelaxed(bytesConsumed);
+            }
+            return !(progress && progress->isCanceled());
+        };
+        QByteArray inflated;
+        if (!MapCompression::decompress(data, inflated, inflateProgress)) {
+            if (progress && progress->isCanceled()) {
+                qDebug() << "Map::load - Canceled while decompressing" << path;
+            } else {
+                qWarning() << "Map::load - Could not decompress" << path;
+            }
+            return false;
+        }
+        if (progress) {
+            progress->bytesConsumed.storeRelaxed(0); // Counts the inflated stream from here on
+        }
+        if (mapped) {
+            file->unmap(mapped);
+            mapped = nullptr;
+        }
+        fileData = inflated;
+        data = fileData;
+        qDebug() << "Map::load - Decompressed" << fileSize << "bytes to" << fileData.size() << "in" << timer.elapsed() << "ms.";
+    }
 
     qDebug() << "Map::load - Attempting to load from OTBM file:" << path;
-    bool success = loadFromOTBM(stream); // Delegate to the new method
+    bool success = loadFromOTBM(data, progress, mode);
 
     if (success) {
         qDebug() << "Map::load - Successfully loaded from OTBM file:" << path;
     } else {
-        qWarning() << "Map::load - Failed to load from OTBM file:" << path << "Stream status:" << stream.status();
+        qWarning() << "Map::load - Failed to load from OTBM file:" << path;
     }
 
-    file.close();
-    return success;
+    if (success && !pendingTileAreas_.isEmpty()) {
+        // The pending areas are views into data; keep it alive until they are all decoded.
+        file->setParent(this); // Moves with the map to another thread (see MapLoader)
+        pendingSource_ = file.take();
+        pendingSourceData_ = fileData; // Shares, does not copy, so the views stay valid
+    }
+    return success; // A file still held by file is closed and unmapped here
+}
+
+bool Map::loadSnapshot(const QString& sourcePath, MapLoadProgress* progress) {
+    QFile file(MapSnapshot::pathFor(sourcePath));
+    if (!file.exists() || !file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const qint64 fileSize = file.size();
+    uchar* mapped = fileSize > 0 ? file.map(0, fileSize) : nullptr;
+    QByteArray fileData;
+    QByteArrayView data;
+    if (mapped) {
+        data = QByteArrayView(reinterpret_cast<const char*>(mapped), fileSize);
+    } else {
+        fileData = file.readAll();
+        data = fileData;
+    }
+
+    MapSnapshot::Header header;
+    if (!MapSnapshot::decodeHeader(data, header)) {
+        return false;
+    }
+    const ItemManager* itemManager = ItemManager::instance();
+    if (!MapSnapshot::matchesItems(header, itemManager->otbHash(), itemManager->xmlHash())) {
+        qDebug() << "Map::loadSnapshot - Snapshot of" << sourcePath << "was taken with other item definitions; parsing the map instead.";
+        return false;
+    }
+    if (!MapSnapshot::matchesSource(header, sourcePath)) {
+        qDebug() << "Map::loadSnapshot - Snapshot of" << sourcePath << "is out of date; parsing the map instead.";
+        return false;
+    }
+
+    // Everything but the tiles is read from the skeleton, a regular (small) OTBM stream.
+    if (!loadFromOTBM(data.sliced(MapSnapshot::HeaderSize, header.skeletonSize), nullptr, MapLoadMode::Full)) {
+        qWarning() << "Map::loadSnapshot - Could not read the map header from the snapshot of" << sourcePath;
+        clear();
+        return false;
+    }
+
+    QVector<QByteArrayView> records(header.chunkCount);
+    QVector<quint64> recordKeys(header.chunkCount);
+    const QByteArrayView recordData = data.sliced(header.recordsOffset, header.recordsSize);
+    for (quint32 chunk = 0; chunk < header.chunkCount; ++chunk) {
+        MapSnapshot::IndexEntry entry;
+        if (!MapSnapshot::indexEntry(data, header, chunk, entry)) {
+            qWarning() << "Map::loadSnapshot - Corrupt chunk index in the snapshot of" << sourcePath;
+            clear();
+            return false;
+        }
+        records[chunk] = recordData.sliced(entry.offset, entry.size);
+        recordKeys[chunk] = entry.chunkKey;
+    }
+    if (progress) {
+        progress->bytesTotal.storeRelaxed(header.recordsSize);
+        progress->areaCount.storeRelaxed(records.size());
+    }
+
+    // Chunks are independent, so they are built on a thread pool like the tile areas of a
+    // parse (see decodeTileAreas), each worker allocating from its own arena.
+    MapArena::Scope arenaScope(arena_);
+    const int chunkCount = records.size();
+    const int workerCount = qBound(1, QThread::idealThreadCount(), qMax(1, chunkCount / 64));
+    QVector<ChunkTable> workerChunks(workerCount);
+    QScopedArrayPointer<MapArena> workerArenas(new MapArena[workerCount]);
+    QAtomicInt nextChunk(0);
+    QAtomicInt failedChunks(0);
+
+    auto decodeChunks = [&](int worker) {
+        MapArena::Scope workerScope(workerArenas[worker]);
+        for (int chunk = nextChunk.fetchAndAddRelaxed(1); chunk < chunkCount; chunk = nextChunk.fetchAndAddRelaxed(1)) {
+            if (progress && progress->isCanceled()) {
+                break;
+            }
+            if (!decodeSnapshotChunk(records.at(chunk), workerChunks[worker])) {
+                failedChunks.ref();
+            }
+            if (progress) {
+                progress->bytesConsumed.fetchAndAddRelaxed(records.at(chunk).size());
+                progress->areasDecoded.fetchAndAddRelaxed(1);
+            }
+        }
+    };
+    if (workerCount == 1) {
+        decodeChunks(0);
+    } else {
+        QThreadPool pool;
+        pool.setMaxThreadCount(workerCount);
+        for (int worker = 0; worker < workerCount; ++worker) {
+            pool.start([&decodeChunks, worker]() { decodeChunks(worker); });
+        }
+        pool.waitForDone();
+    }
+
+    // Adopted even after a failure, so everything built so far is owned (and freed) by the map.
+    for (ChunkTable& chunks : workerChunks) {
+        adoptChunks(chunks);
+    }
+    for (int worker = 0; worker < workerCount; ++worker) {
+        arena_.adopt(workerArenas[worker]);
+    }
+    if ((progress && progress->isCanceled()) || failedChunks.loadRelaxed() > 0) {
+        if (failedChunks.loadRelaxed() > 0) {
+            qWarning() << "Map::loadSnapshot -" << failedChunks.loadRelaxed() << "chunk records in the snapshot of"
+                       << sourcePath << "are corrupt; parsing the map instead.";
+        }
+        clear();
+        return false;
+    }
+
+    // Nothing is cached for the OTBM save, so every area counts as changed (and is encoded once).
+    dirtyTileAreas_.clear();
+    tileAreaCache_.clear();
+    for (const MapChunk* chunk : std::as_const(chunks_)) {
+        dirtyTileAreas_.insert(tileAreaKey(chunk->baseX, chunk->baseY, chunk->z));
+    }
+    // The records read are those of the next snapshot too, until their chunks change.
+    dirtySnapshotChunks_.clear();
+    snapshotChunkCache_.clear();
+    snapshotChunkCache_.reserve(chunkCount);
+    for (int chunk = 0; chunk < chunkCount; ++chunk) {
+        snapshotChunkCache_.insert(recordKeys.at(chunk), records.at(chunk).toByteArray()); // Copied; the file is unmapped below
+    }
+    snapshotCurrent_ = true;
+    setModified(false);
+    emit mapChanged();
+
+    qDebug() << "Map::loadSnapshot - Opened" << sourcePath << "from its snapshot (" << chunkCount << "chunks," << tileCount_
+             << "tiles) on" << workerCount << "threads in" << timer.elapsed() << "ms.";
+    return true; // file is unmapped and closed here; nothing refers to it any more
+}
+
+void Map::saveSnapshotInBackground(const QString& sourcePath) {
+    if (snapshotCurrent_ || !pendingTileAreas_.isEmpty()) {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    MapSnapshot::Header header;
+    if (!MapSnapshot::statSource(sourcePath, header)) {
+        return;
+    }
+
+    QBuffer skeleton;
+    skeleton.open(QIODevice::WriteOnly);
+    if (!writeOtbm(skeleton, false)) {
+        return;
+    }
+
+    const ItemManager* itemManager = ItemManager::instance();
+    header.itemsOtbHash = itemManager->otbHash();
+    header.itemsXmlHash = itemManager->xmlHash();
+
+    // Sorted, so the same map always gives the same file. Records of chunks untouched since
+    // the last snapshot come from snapshotChunkCache_ (shared, not copied); only the rest are
+    // encoded here. Chunks released since then drop out of the cache.
+    QList<quint64> keys = chunks_.keys();
+    std::sort(keys.begin(), keys.end());
+    QVector<MapSnapshot::ChunkRecord> records;
+    records.reserve(keys.size());
+    QHash<quint64, QByteArray> cache;
+    cache.reserve(keys.size());
+    int encoded = 0;
+    for (quint64 key : std::as_const(keys)) {
+        const MapChunk* chunk = chunks_.value(key);
+        if (chunk->tileCount == 0) {
+            continue;
+        }
+        QByteArray record = snapshotChunkCache_.value(key);
+        if (record.isEmpty() || dirtySnapshotChunks_.contains(key)) {
+            record.clear();
+            encodeSnapshotChunk(chunk, record);
+            ++encoded;
+        }
+        cache.insert(key, record);
+        records.append({key, record});
+    }
+    snapshotChunkCache_.swap(cache);
+    dirtySnapshotChunks_.clear();
+    snapshotCurrent_ = true;
+    qDebug() << "Map::saveSnapshotInBackground - Took" << records.size() << "chunk records of" << sourcePath
+             << "(" << encoded << "encoded) in" << timer.elapsed() << "ms.";
+
+    const QByteArray skeletonData = skeleton.data();
+    QThreadPool::globalInstance()->start([sourcePath, header, skeletonData, records]() {
+        MapSnapshot::write(sourcePath, header, skeletonData, records);
+    });
+}
+
+void Map::encodeSnapshotChunk(const MapChunk* chunk, QByteArray& records) const {
+    QVector<SnapshotTileRecord> tiles;
+    QVector<SnapshotItemRecord> items;
+    QVector<quint16_le> zoneIds;
+    QByteArray extras;
+    tiles.reserve(chunk->tileCount);
+
+    for (int slot = 0; slot < MapChunk::Size * MapChunk::Size; ++slot) {
+        const Tile* tile = chunk->tiles[slot];
+        if (!tile) {
+            continue;
+        }
+        const qsizetype firstItem = items.size();
+        if (const Item* ground = tile->getGround()) {
+            ground->writeSnapshotRecord(items.emplace_back(), extras);
+        }
+        for (const Item* item : tile->getItems()) {
+            if (item) {
+                item->writeSnapshotRecord(items.emplace_back(), extras);
+            }
+        }
+        const QVector<quint16> zones = chunk->zoneIds.value(static_cast<quint16>(slot));
+        for (quint16 zone : zones) {
+            zoneIds.append(quint16_le(zone));
+        }
+
+        SnapshotTileRecord& record = tiles.emplace_back();
+        record.slot = static_cast<quint16>(slot);
+        record.mapFlags = static_cast<quint16>(tile->getMapFlags());
+        record.houseId = tile->getHouseId();
+        record.itemCount = static_cast<quint16>(items.size() - firstItem);
+        record.zoneCount = static_cast<quint16>(zones.size());
+    }
+
+    SnapshotChunkRecord header;
+    header.baseX = static_cast<quint16>(chunk->baseX);
+    header.baseY = static_cast<quint16>(chunk->baseY);
+    header.z = static_cast<quint8>(chunk->z);
+    header.reserved = 0;
+    header.tileCount = static_cast<quint16>(tiles.size());
+    header.itemCount = static_cast<quint32>(items.size());
+    header.zoneIdCount = static_cast<quint32>(zoneIds.size());
+
+    records.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    records.append(reinterpret_cast<const char*>(tiles.constData()), tiles.size() * sizeof(SnapshotTileRecord));
+    records.append(reinterpret_cast<const char*>(items.constData()), items.size() * sizeof(SnapshotItemRecord));
+    records.append(reinterpret_cast<const char*>(zoneIds.constData()), zoneIds.size() * sizeof(quint16_le));
+    records.append(extras);
+}
+
+bool Map::decodeSnapshotChunk(QByteArrayView record, ChunkTable& chunks) const {
+    // The record is read in place; MapSnapshot::indexEntry() has checked it starts 8-aligned.
+    const auto* header = reinterpret_cast<const SnapshotChunkRecord*>(record.data());
+    const qint64 tileCount = header->tileCount;
+    const qint64 itemCount = header->itemCount;
+    const qint64 fixedSize = qint64(sizeof(SnapshotChunkRecord)) + tileCount * qint64(sizeof(SnapshotTileRecord)) +
+                             itemCount * qint64(sizeof(SnapshotItemRecord)) + qint64(header->zoneIdCount) * qint64(sizeof(quint16_le));
+    const int baseX = header->baseX;
+    const int baseY = header->baseY;
+    const int z = header->z;
+    if (fixedSize > record.size() || tileCount > MapChunk::Size * MapChunk::Size ||
+        (baseX & MapChunk::Mask) != 0 || (baseY & MapChunk::Mask) != 0 || !isCoordValid(baseX, baseY, z)) {
+        qWarning() << "Map::decodeSnapshotChunk - Corrupt chunk record.";
+        return false;
+    }
+    const auto* tiles = reinterpret_cast<const SnapshotTileRecord*>(header + 1);
+    const auto* items = reinterpret_cast<const SnapshotItemRecord*>(tiles + tileCount);
+    const auto* zoneIds = reinterpret_cast<const quint16_le*>(items + itemCount);
+    QByteArrayView extras = record.sliced(fixedSize);
+    qint64 zonesLeft = header->zoneIdCount;
+    qint64 itemsLeft = itemCount;
+
+    MapChunk*& chunk = chunks[chunkKey(baseX, baseY, z)];
+    if (!chunk) {
+        chunk = new MapChunk(); // Detached (map == nullptr) until adoptChunks()
+        chunk->baseX = baseX;
+        chunk->baseY = baseY;
+        chunk->z = z;
+    }
+    for (qint64 i = 0; i < tileCount; ++i) {
+        const SnapshotTileRecord& tileRecord = tiles[i];
+        const int slot = tileRecord.slot;
+        if (slot >= MapChunk::Size * MapChunk::Size || chunk->tiles[slot] ||
+            tileRecord.itemCount > itemsLeft || tileRecord.zoneCount > zonesLeft) {
+            qWarning() << "Map::decodeSnapshotChunk - Corrupt tile record in chunk" << baseX << baseY << z;
+            return false;
+        }
+        Tile* tile = new Tile(chunk, slot);
+        chunk->tiles[slot] = tile;
+        ++chunk->tileCount;
+        tile->mapFlags_ = Tile::TileMapFlags::fromInt(tileRecord.mapFlags);
+        tile->houseId_ = tileRecord.houseId;
+
+        for (int n = 0; n < tileRecord.itemCount; ++n, ++items, --itemsLeft) {
+            if (items->extraSize > quint32(extras.size())) {
+                qWarning() << "Map::decodeSnapshotChunk - Corrupt item record in chunk" << baseX << baseY << z;
+                return false;
+            }
+            tile->addItem(Item::fromSnapshotRecord(*items, extras.first(items->extraSize)));
+            extras = extras.sliced(items->extraSize);
+        }
+        if (tileRecord.zoneCount > 0) {
+            QVector<quint16>& zones = chunk->zoneIds[static_cast<quint16>(slot)];
+            for (int n = 0; n < tileRecord.zoneCount; ++n, --zonesLeft) {
+                zones.append(*zoneIds++);
+            }
+        }
+        tile->setModified(false);
+    }
+    return true;
 }
 
 bool Map::save(const QString& path) const {
-    QFile file(path);
+    // Everything still waiting in the source file is decoded (and cached) before it is replaced.
+    const_cast<Map*>(this)->loadAllTileAreas();
+
+    // Write to a temporary file next to the target and rename it over the original only once
+    // everything is on disk, so a failed or interrupted save never leaves a truncated map.
+    QSaveFile file(path);
     if (!file.open(QIODevice::WriteOnly)) {
         qWarning() << "Map::save - Could not open file for writing:" << path << "Error:" << file.errorString();
         return false;
     }
 
-    QDataStream stream(&file);
-    stream.setByteOrder(QDataStream::LittleEndian); // Ensure consistent byte order
-
     qDebug() << "Map::save - Attempting to save to OTBM file:" << path;
-    bool success = saveToOTBM(stream); // Delegate to the new method
-
-    if (success) {
-        qDebug() << "Map::save - Successfully saved to OTBM file:" << path;
+    bool success;
+    if (MapCompression::hasCompressedSuffix(path)) {
+        CompressedMapWriter compressed(&file);
+        compressed.open(QIODevice::WriteOnly);
+        success = saveToOTBM(compressed);
+        success = compressed.finish() && success;
     } else {
-        qWarning() << "Map::save - Failed to save to OTBM file:" << path << "Stream status:" << stream.status();
+        success = saveToOTBM(file);
+    }
+    if (!success) {
+        qWarning() << "Map::save - Failed to save to OTBM file:" << path;
+        file.cancelWriting();
+        return false;
+    }
+    if (!file.commit()) {
+        qWarning() << "Map::save - Could not replace" << path << "Error:" << file.errorString();
+        return false;
     }
 
-    file.close();
-    return success;
+    Map* self = const_cast<Map*>(this);
+    self->setModified(false);
+    qDebug() << "Map::save - Successfully saved to OTBM file:" << path << "Map set to unmodified.";
+    self->snapshotCurrent_ = false; // The old one describes the file as it was
+    self->saveSnapshotInBackground(path);
+    return true;
 }
 
 // Selection method implementations
@@ -504,11 +963,20 @@ void Map::updateSelection(const QSet<MapPos>& newSelection) {
 }
 
 
-bool Map::loadFromOTBM(QDataStream& stream) {
+bool Map::loadFromOTBM(QByteArrayView data, MapLoadProgress* progress, MapLoadMode mode) {
     clear(); // Clear existing map data
+    MapArena::Scope arenaScope(arena_); // Tiles and items read below are bump-allocated from arena_
 
-    OtbmReader reader(stream);
-    ItemManager* itemManager = ItemManager::getInstancePtr(); // Get instance for item creation
+    // Files written by other editors start with a 4 byte identifier ("OTBM" or zeros) before the root node.
+    if (data.size() >= 4 && static_cast<quint8>(data.at(0)) != OTBM_NODE_START) {
+        data = data.sliced(4);
+    }
+    if (progress) {
+        progress->bytesTotal.storeRelaxed(data.size());
+    }
+
+    OtbmReader reader(data);
+    ItemManager* itemManager = ItemManager::instance(); // For item creation
 
     quint8 rootNodeType;
     if (!reader.enterNode(rootNodeType)) {
@@ -518,7 +986,6 @@ bool Map::loadFromOTBM(QDataStream& stream) {
 
     if (rootNodeType != OTBM_ROOTV1) {
         qWarning() << "Map::loadFromOTBM - Root node type is not OTBM_ROOTV1. Got:" << rootNodeType;
-        reader.leaveNode();
         return false;
     }
     qDebug() << "Map::loadFromOTBM - Entered OTBM_ROOTV1 node.";
@@ -526,33 +993,25 @@ bool Map::loadFromOTBM(QDataStream& stream) {
     // Read attributes of ROOTV1 node
     quint8 rootAttrId;
     while(reader.nextAttributeId(rootAttrId)) {
-        quint16 rootAttrDataLen;
-        if (!(reader.stream() >> rootAttrDataLen)) {
-            qWarning() << "Map::loadFromOTBM - Failed to read data length for ROOTV1 attribute" << rootAttrId;
-            reader.leaveNode(); return false;
-        }
-        QByteArray rootAttrData = reader.readData(rootAttrDataLen);
-        if (reader.stream().status() != QDataStream::Ok && rootAttrDataLen > 0) {
+        QByteArrayView rootAttrData;
+        if (!reader.readAttributeData(rootAttrData)) {
             qWarning() << "Map::loadFromOTBM - Failed to read data for ROOTV1 attribute" << rootAttrId;
-            reader.leaveNode(); return false;
+            return false;
         }
 
-        QDataStream valueStream(rootAttrData);
-        valueStream.setByteOrder(QDataStream::LittleEndian);
-
        switch (static_cast<OTBM_RootAttribute>(rootAttrId)) { // Cast to new enum
            case OTBM_RootAttribute::OTBM_ROOT_ATTR_VERSION_MAJOR:
-               if (rootAttrDataLen == sizeof(quint32)) valueStream >> m_otbmMajorVersion;
+               if (rootAttrData.size() == sizeof(quint32)) m_otbmMajorVersion = qFromLittleEndian<quint32>(rootAttrData.data());
                else qWarning() << "Map::loadFromOTBM - Incorrect data length for OTBM_ROOT_ATTR_VERSION_MAJOR";
                qDebug() << "OTBM Major Version:" << m_otbmMajorVersion;
                break;
            case OTBM_RootAttribute::OTBM_ROOT_ATTR_VERSION_MINOR:
-               if (rootAttrDataLen == sizeof(quint32)) valueStream >> m_otbmMinorVersion;
+               if (rootAttrData.size() == sizeof(quint32)) m_otbmMinorVersion = qFromLittleEndian<quint32>(rootAttrData.data());
                else qWarning() << "Map::loadFromOTBM - Incorrect data length for OTBM_ROOT_ATTR_VERSION_MINOR";
                qDebug() << "OTBM Minor Version:" << m_otbmMinorVersion;
                break;
            case OTBM_RootAttribute::OTBM_ROOT_ATTR_VERSION_BUILD:
-               if (rootAttrDataLen == sizeof(quint32)) valueStream >> m_otbmBuildVersion; // Assuming build is also quint32
+               if (rootAttrData.size() == sizeof(quint32)) m_otbmBuildVersion = qFromLittleEndian<quint32>(rootAttrData.data()); // Assuming build is also quint32
                else qWarning() << "Map::loadFromOTBM - Incorrect data length for OTBM_ROOT_ATTR_VERSION_BUILD";
                qDebug() << "OTBM Build Version:" << m_otbmBuildVersion;
                break;
@@ -566,7 +1025,6 @@ bool Map::loadFromOTBM(QDataStream& stream) {
                break;
            default:
                qDebug() << "Map::loadFromOTBM - Skipped unknown attribute" << rootAttrId << "in ROOTV1 node.";
-               // reader.skipBytes(rootAttrDataLen); // Already consumed by readData
                break;
        }
     }
@@ -574,42 +1032,24 @@ bool Map::loadFromOTBM(QDataStream& stream) {
     qDebug() << "Map::loadFromOTBM - Finished reading ROOTV1 attributes. Attempting to read map dimensions and OTB item versions.";
 
     quint16 loadedMapWidth, loadedMapHeight;
-    if (!(reader.stream() >> loadedMapWidth)) {
-        qWarning() << "Map::loadFromOTBM - Failed to read map width from root node stream.";
-        reader.leaveNode(); // Leave ROOTV1
-        return false;
-    }
-    this->width_ = loadedMapWidth; // Set map width directly
-
-    if (!(reader.stream() >> loadedMapHeight)) {
-        qWarning() << "Map::loadFromOTBM - Failed to read map height from root node stream.";
-        reader.leaveNode(); // Leave ROOTV1
+    if (!reader.readU16(loadedMapWidth) || !reader.readU16(loadedMapHeight)) {
+        qWarning() << "Map::loadFromOTBM - Failed to read map dimensions from root node.";
         return false;
     }
-    this->height_ = loadedMapHeight; // Set map height directly
+    this->width_ = loadedMapWidth; // Set map dimensions directly
+    this->height_ = loadedMapHeight;
 
-    if (!(reader.stream() >> m_otbItemsMajorVersion)) {
-        qWarning() << "Map::loadFromOTBM - Failed to read OTB items major version from root node stream.";
-        reader.leaveNode(); // Leave ROOTV1
+    if (!reader.readU32(m_otbItemsMajorVersion) || !reader.readU32(m_otbItemsMinorVersion)) {
+        qWarning() << "Map::loadFromOTBM - Failed to read OTB items version from root node.";
         return false;
     }
-    qDebug() << "Map::loadFromOTBM - Read OTB Items Major Version:" << m_otbItemsMajorVersion;
+    qDebug() << "Map::loadFromOTBM - Read OTB Items Version: Major" << m_otbItemsMajorVersion << "Minor" << m_otbItemsMinorVersion;
+    itemAttributeDecoders_ = &Item::otbmAttributeDecoders(m_otbmMajorVersion, m_otbItemsMajorVersion, m_otbItemsMinorVersion);
 
-    if (!(reader.stream() >> m_otbItemsMinorVersion)) {
-        qWarning() << "Map::loadFromOTBM - Failed to read OTB items minor version from root node stream.";
-        reader.leaveNode(); // Leave ROOTV1
-        return false;
-    }
-    qDebug() << "Map::loadFromOTBM - Read OTB Items Minor Version:" << m_otbItemsMinorVersion;
-
-    // Note: Map floors are not read here; they are determined by TILE_AREA nodes.
-    // The tiles_ vector in Map needs to be able to accommodate tiles from any floor.
-    // A common approach is to resize tiles_ dynamically as new floors are encountered
-    // or pre-allocate to a max number of floors (e.g. 16) and then trim if necessary.
-    // The current Map::initialize (called by constructors) sets up tiles_ with initial dimensions.
-    // Since clear() is called at the start of loadFromOTBM, width_ and height_ are reset.
-    // We've now set width_ and height_. The floors_ member and tiles_ resizing needs to be handled
-    // correctly before or during TILE_AREA processing. For now, we assume this is handled.
+    // Note: Map floors are not stored in OTBM; tiles on any floor may appear in TILE_AREA nodes.
+    // With sparse chunk storage an unused floor costs nothing, so the map simply spans
+    // the full floor range and chunks are allocated as tiles are read.
+    this->floors_ = MAP_MAX_FLOORS;
 
     // TODO (Task51-MapVer): If there were fundamental changes to OTBM_MAP_DATA,
     // OTBM_TILE_AREA, or OTBM_TILE node structures in different OTBM versions,
@@ -620,37 +1060,24 @@ bool Map::loadFromOTBM(QDataStream& stream) {
     quint8 mapDataNodeType;
     if (!reader.enterNode(mapDataNodeType)) {
         qWarning() << "Map::loadFromOTBM - Could not enter MAP_DATA node.";
-        reader.leaveNode(); // Leave ROOTV1
         return false;
     }
 
     if (mapDataNodeType != OTBM_MAP_DATA) {
         qWarning() << "Map::loadFromOTBM - Expected OTBM_MAP_DATA node, got:" << mapDataNodeType;
-        reader.leaveNode(); // Leave MAP_DATA (or whatever it was)
-        reader.leaveNode(); // Leave ROOTV1
         return false;
     }
     qDebug() << "Map::loadFromOTBM - Entered OTBM_MAP_DATA node.";
 
     QString mapDescription;
-    // These are not typically set at map level in OTBM but rather discovered
-    // For now, we'll use them if present, otherwise derive from tile areas.
-    quint16 initialMapWidth = 0, initialMapHeight = 0, initialMapFloors = 0;
 
     quint8 mapAttrId;
     while(reader.nextAttributeId(mapAttrId)) {
-        quint16 mapAttrDataLen;
-        if (!(reader.stream() >> mapAttrDataLen)) {
-             qWarning() << "Map::loadFromOTBM - Failed to read data length for MAP_DATA attribute" << mapAttrId;
-             break;
-        }
-        QByteArray mapAttrData = reader.readData(mapAttrDataLen);
-        if (reader.stream().status() != QDataStream::Ok && mapAttrDataLen > 0) {
+        QByteArrayView mapAttrData;
+        if (!reader.readAttributeData(mapAttrData)) {
             qWarning() << "Map::loadFromOTBM - Failed to read data for MAP_DATA attribute" << mapAttrId;
-            break;
+            return false;
         }
-        QDataStream mapValueStream(mapAttrData);
-        mapValueStream.setByteOrder(QDataStream::LittleEndian);
 
         switch (mapAttrId) {
             case OTBM_ATTR_DESCRIPTION:
@@ -674,131 +1101,21 @@ bool Map::loadFromOTBM(QDataStream& stream) {
     }
     setDescription(mapDescription); // Set map description if read
 
-    // The map dimensions will be determined by the extent of TILE_AREA nodes.
-    // We might need to do a first pass to find all TILE_AREAs and determine bounds,
-    // then initialize the map, then do a second pass to populate tiles.
-    // For simplicity in this step, we'll initialize/expand the map as we find areas.
-    // This is not ideal for performance or correctness if areas are not ordered.
-    // A better approach is to collect all area data first or use min/max extents.
-    // For now, we'll assume initialize(0,0,0) was called and expand as needed.
-    // This part is complex and will be simplified for this initial implementation.
-    // Actual robust dimension handling needs pre-scan or dynamic resizing.
-    // Let's assume for now the map is pre-sized or we handle it very simply.
-    // If map is not pre-sized, initialize with some default or first area's size.
-    // The current `initialize` clears the map, so it should be called once with final dimensions.
-    // This will be a placeholder: actual dimensions will be determined by TILE_AREAs.
-    // For now, let's assume the map is large enough or will be resized later.
-
+    // First pass: index the tile areas (a plain scan for their end markers) and read the
+    // small town/waypoint lists directly. The areas are decoded afterwards, in parallel.
+    QVector<QByteArrayView> tileAreas;
     quint8 nodeType;
+    qsizetype nodeStart = reader.position();
     while (reader.enterNode(nodeType)) {
         if (nodeType == OTBM_TILE_AREA) {
-            quint16 areaBaseX, areaBaseY;
-            quint8 areaBaseZ;
-            reader.stream() >> areaBaseX >> areaBaseY >> areaBaseZ;
-            if (reader.stream().status() != QDataStream::Ok) {
-                qWarning() << "Map::loadFromOTBM - Failed to read TILE_AREA coordinates.";
-                reader.leaveNode(); break;
-            }
-            qDebug() << "Map::loadFromOTBM - Reading TILE_AREA at" << areaBaseX << areaBaseY << areaBaseZ;
-
-            // Placeholder: Ensure map is large enough. This is where dynamic resizing or pre-scan would be needed.
-            // For example: updateMapDimensions(areaBaseX + 255, areaBaseY + 255, areaBaseZ);
-            if (!isCoordValid(areaBaseX, areaBaseY, areaBaseZ) ||
-                !isCoordValid(areaBaseX + 255, areaBaseY + 255, areaBaseZ)) { // Rough check
-                // If map has not been initialized with proper dimensions yet.
-                // This is where a pre-scan to determine overall map dimensions would be crucial.
-                // For this step, we'll assume initialize() was called or we are just logging.
-                qWarning() << "Map::loadFromOTBM - TILE_AREA exceeds current map bounds or map not initialized. Area:" << areaBaseX << areaBaseY << areaBaseZ;
-                // To continue robustly, we'd need to skip this entire area's content.
-                // This requires skipping all its child tiles and their items.
-                // For now, we might fail or try to process if in bounds.
-                // Let's assume the map was initialized to a default or from header if those attributes existed.
-                // If not, this will likely try to access out of bounds.
-                // The provided Map::initialize clears everything, so it must be called once with final dimensions.
-            }
-
-
-            quint8 tileNodeType;
-            while(reader.enterNode(tileNodeType)) {
-                if (tileNodeType == OTBM_TILE || tileNodeType == OTBM_HOUSETILE) {
-                    quint8 relX, relY;
-                    reader.stream() >> relX >> relY; // Tile relative coordinates
-                    if (reader.stream().status() != QDataStream::Ok) {
-                        qWarning() << "Map::loadFromOTBM - Failed to read TILE relative coordinates.";
-                        reader.leaveNode(); break;
-                    }
-
-                    MapPos currentTilePos(areaBaseX + relX, areaBaseY + relY, areaBaseZ);
-                    // Ensure map is large enough before calling getOrCreateTile.
-                    // This is a critical part that needs robust dimension handling.
-                    // For now, if map wasn't pre-initialized to full size, getOrCreateTile might fail or try to access out of bounds.
-                    if (!isCoordValid(currentTilePos.x, currentTilePos.y, currentTilePos.z)) {
-                         qWarning() << "Map::loadFromOTBM - Tile coordinates" << currentTilePos.x << currentTilePos.y << currentTilePos.z << "are out of map bounds. Skipping tile.";
-                         // We need to skip this tile's attributes and items. This is complex.
-                         // For now, we'll just leave the node and continue, which might lead to errors.
-                         // A robust skip involves parsing until OTBM_NODE_END.
-                         reader.leaveNode(); // Attempt to leave this tile node
-                         continue; // Skip to next tile node in area
-                    }
-
-                    Tile* tile = getOrCreateTile(currentTilePos.x, currentTilePos.y, currentTilePos.z);
-                    if (!tile) {
-                        qWarning() << "Map::loadFromOTBM - Failed to get/create tile at" << currentTilePos.x << currentTilePos.y << currentTilePos.z;
-                        reader.leaveNode(); break;
-                    }
-                    if (tileNodeType == OTBM_HOUSETILE) tile->setHouseTile(true);
-                    // tile->setModified(false); // Tile reflects persistent state - This needs to be after attributes/items
-
-
-                    quint8 tileAttrId;
-                    while(reader.nextAttributeId(tileAttrId)) {
-                        quint16 tileAttrDataLen;
-                        if (!(reader.stream() >> tileAttrDataLen)) { /* error */ break; }
-                        QByteArray tileAttrData = reader.readData(tileAttrDataLen);
-                        QDataStream tileValueStream(tileAttrData);
-                        tileValueStream.setByteOrder(QDataStream::LittleEndian);
-
-                        if (tileAttrId == OTBM_ATTR_TILE_FLAGS) {
-                            quint32 flags = 0;
-                            if (tileAttrDataLen == sizeof(quint32)) tileValueStream >> flags; else qWarning("Incorrect TILE_FLAGS length");
-                            tile->setMapFlagsValue(flags);
-                        } else if (tileAttrId == OTBM_ATTR_HOUSEDOORID && tileNodeType == OTBM_HOUSETILE) {
-                            quint8 houseDoorId = 0;
-                            if (tileAttrDataLen == sizeof(quint8)) tileValueStream >> houseDoorId; else qWarning("Incorrect HOUSEDOORID length");
-                            tile->setHouseDoorId(houseDoorId);
-                        } else {
-                             qDebug() << "Map::loadFromOTBM - Skipping TILE/HOUSETILE attribute" << tileAttrId;
-                        }
-                    }
-
-                    quint8 itemNodeType;
-                    while(reader.enterNode(itemNodeType)) {
-                         if (itemNodeType == OTBM_ITEM) {
-                            // Pass client version to item reading if ItemManager or Item needs it
-                            Item* item = reader.readItem(itemManager, this->m_otbmMajorVersion, m_otbItemsMajorVersion, m_otbItemsMinorVersion); // NEW (passing map OTBM version)
-                            // TODO (Task51): If item deserialization is version-dependent, OtbmReader::readItem
-                            // might need to accept version parameters, or Item::unserializeOtbmAttributes
-                            // might need to access the map's version via its parent or a global accessor.
-                            if (item) {
-                                tile->addItem(item);
-                            } else {
-                                qDebug() << "Map::loadFromOTBM - Failed to read item on tile" << currentTilePos.x << currentTilePos.y << currentTilePos.z;
-                            }
-                        } else {
-                            qWarning() << "Map::loadFromOTBM - Unexpected node type" << itemNodeType << "inside TILE, expected OTBM_ITEM. Skipping node.";
-                            // reader.skipNode(); // Placeholder for skipping unknown child nodes
-                        }
-                        if (!reader.leaveNode()) { qWarning() << "Map::loadFromOTBM - Failed to leave item node."; return false; }
-                    }
-                    if (tile) { // After all attributes and items for the tile have been read
-                        tile->setModified(false);
-                    }
-                } else {
-                     qWarning() << "Map::loadFromOTBM - Unexpected node type" << tileNodeType << "inside TILE_AREA, expected OTBM_TILE or OTBM_HOUSETILE. Skipping node.";
-                     // reader.skipNode();
-                }
-                if (!reader.leaveNode()) { qWarning() << "Map::loadFromOTBM - Failed to leave tile node."; return false; }
+            if (!reader.leaveNode()) { qWarning() << "Map::loadFromOTBM - Failed to skip TILE_AREA node."; return false; }
+            tileAreas.append(data.sliced(nodeStart, reader.position() - nodeStart));
+            nodeStart = reader.position();
+            if (progress && progress->isCanceled()) {
+                qDebug() << "Map::loadFromOTBM - Canceled while indexing tile areas.";
+                return false;
             }
+            continue;
         } else if (nodeType == OTBM_TOWNS) {
             qDebug() << "Map::loadFromOTBM - Reading OTBM_TOWNS.";
             quint8 townNodeType;
@@ -806,36 +1123,22 @@ bool Map::loadFromOTBM(QDataStream& stream) {
                 if (townNodeType == OTBM_TOWN) {
                     quint32 townId;
                     QString townName;
-                    MapPos templePos;
                     quint16 tempX, tempY;
                     quint8 tempZ;
 
-                    if (!(reader.stream() >> townId)) {
-                        qWarning() << "Map::loadFromOTBM - Failed to read town ID.";
-                        reader.leaveNode(); break;
-                    }
-
-                    townName = reader.readString(); // Assuming this method exists or is implemented.
-                    if (reader.stream().status() != QDataStream::Ok) {
-                        qWarning() << "Map::loadFromOTBM - Failed to read town name string.";
-                        reader.leaveNode(); break;
-                    }
-
-                    if (!(reader.stream() >> tempX >> tempY >> tempZ)) {
-                        qWarning() << "Map::loadFromOTBM - Failed to read town temple position.";
-                        reader.leaveNode(); break;
+                    if (!reader.readU32(townId) || !reader.readString(townName) ||
+                        !reader.readU16(tempX) || !reader.readU16(tempY) || !reader.readByte(tempZ)) {
+                        qWarning() << "Map::loadFromOTBM - Failed to read town.";
+                        return false;
                     }
-                    templePos.x = tempX;
-                    templePos.y = tempY;
-                    templePos.z = tempZ;
+                    MapPos templePos(tempX, tempY, tempZ);
 
                     Town* newTown = new Town(townId, townName, templePos);
                     m_towns.append(newTown);
                     qDebug() << "Loaded Town:" << newTown->getName() << "ID:" << newTown->getId() << "Pos:" << templePos.x << templePos.y << templePos.z;
 
                 } else {
-                    qWarning() << "Map::loadFromOTBM - Unexpected node type" << townNodeType << "inside OTBM_TOWNS.";
-                    // reader.skipNode(); // Placeholder
+                    qWarning() << "Map::loadFromOTBM - Unexpected node type" << townNodeType << "inside OTBM_TOWNS. Skipping node.";
                 }
                 if (!reader.leaveNode()) { qWarning() << "Map::loadFromOTBM - Failed to leave TOWN node."; return false; }
             }
@@ -845,60 +1148,392 @@ bool Map::loadFromOTBM(QDataStream& stream) {
             while(reader.enterNode(waypointNodeType)) {
                 if (waypointNodeType == OTBM_WAYPOINT) {
                     QString waypointName;
-                    MapPos waypointPos;
                     quint16 tempX, tempY;
                     quint8 tempZ;
 
-                    waypointName = reader.readString(); // Assuming this method exists or is implemented.
-                    if (reader.stream().status() != QDataStream::Ok) {
-                        qWarning() << "Map::loadFromOTBM - Failed to read waypoint name string.";
-                        reader.leaveNode(); break;
+                    if (!reader.readString(waypointName) ||
+                        !reader.readU16(tempX) || !reader.readU16(tempY) || !reader.readByte(tempZ)) {
+                        qWarning() << "Map::loadFromOTBM - Failed to read waypoint.";
+                        return false;
                     }
-
-                    if (!(reader.stream() >> tempX >> tempY >> tempZ)) {
-                        qWarning() << "Map::loadFromOTBM - Failed to read waypoint position.";
-                        reader.leaveNode(); break;
-                    }
-                    waypointPos.x = tempX;
-                    waypointPos.y = tempY;
-                    waypointPos.z = tempZ;
+                    MapPos waypointPos(tempX, tempY, tempZ);
 
                     Waypoint* newWaypoint = new Waypoint(waypointName, waypointPos);
                     m_waypoints.append(newWaypoint);
                     qDebug() << "Loaded Waypoint:" << newWaypoint->getName() << "Pos:" << waypointPos.x << waypointPos.y << waypointPos.z;
 
                 } else {
-                    qWarning() << "Map::loadFromOTBM - Unexpected node type" << waypointNodeType << "inside OTBM_WAYPOINTS.";
-                    // reader.skipNode(); // Placeholder
+                    qWarning() << "Map::loadFromOTBM - Unexpected node type" << waypointNodeType << "inside OTBM_WAYPOINTS. Skipping node.";
                 }
                 if (!reader.leaveNode()) { qWarning() << "Map::loadFromOTBM - Failed to leave WAYPOINT node."; return false; }
             }
         }
         else {
             qWarning() << "Map::loadFromOTBM - Unexpected node type" << nodeType << "inside MAP_DATA. Skipping node.";
-            // reader.skipNode();
         }
         if (!reader.leaveNode()) {
             qWarning() << "Map::loadFromOTBM - Failed to leave node type" << nodeType << "in MAP_DATA.";
             return false;
         }
+        nodeStart = reader.position();
     }
 
     if (!reader.leaveNode()) { qWarning() << "Map::loadFromOTBM - Failed to leave MAP_DATA node."; return false; }
     if (!reader.leaveNode()) { qWarning() << "Map::loadFromOTBM - Failed to leave ROOTV1 node."; return false; }
 
-    // Here, the map dimensions should be finalized based on read data if not fixed.
-    // If map was initialized with 0,0,0, it needs proper sizing now.
-    // For this step, proper dimension handling is deferred.
+    if (progress) {
+        // Everything but the areas themselves has been consumed by the first pass.
+        qint64 areaBytes = 0;
+        for (QByteArrayView area : std::as_const(tileAreas)) {
+            areaBytes += area.size();
+        }
+        progress->bytesConsumed.storeRelaxed(data.size() - areaBytes);
+        progress->areaCount.storeRelaxed(tileAreas.size());
+    }
+
+    if (mode == MapLoadMode::OnDemand) {
+        // Only index the areas; each is decoded the first time something touches it (see
+        // loadPendingTileArea). Nodes that do not map one-to-one onto a 256x256 area (misaligned
+        // or repeated, only found in files from other editors) are decoded right away.
+        QVector<QByteArrayView> eagerAreas;
+        for (QByteArrayView areaNode : std::as_const(tileAreas)) {
+            OtbmReader areaReader(areaNode);
+            quint8 areaNodeType;
+            quint16 areaX, areaY;
+            quint8 areaZ;
+            if (areaReader.enterNode(areaNodeType) && areaReader.readU16(areaX) && areaReader.readU16(areaY) &&
+                areaReader.readByte(areaZ) && areaX % OTBM_TILE_AREA_SIZE == 0 && areaY % OTBM_TILE_AREA_SIZE == 0 &&
+                !pendingTileAreas_.contains(tileAreaKey(areaX, areaY, areaZ))) {
+                pendingTileAreas_.insert(tileAreaKey(areaX, areaY, areaZ), areaNode);
+            } else {
+                eagerAreas.append(areaNode);
+            }
+        }
+        qDebug() << "Map::loadFromOTBM - Indexed" << pendingTileAreas_.size() << "tile areas for on-demand loading.";
+        tileAreas = eagerAreas;
+    }
+
+    if (!decodeTileAreas(tileAreas, progress)) {
+        pendingTileAreas_.clear();
+        return false;
+    }
+
     setModified(false); // Map is now in a clean state reflecting the loaded file.
     qDebug() << "Map::loadFromOTBM - Successfully parsed OTBM data. Map set to unmodified.";
     emit mapChanged();
     return true;
 }
 
+bool Map::decodeTileAreas(const QVector<QByteArrayView>& tileAreas, MapLoadProgress* progress) {
+    MapArena::Scope arenaScope(arena_);
+
+    // Decode the areas on a thread pool. Each worker allocates from its own arena into
+    // per-area chunk tables; nothing shared is written until the merge below.
+    const int areaCount = tileAreas.size();
+    const int workerCount = qBound(1, QThread::idealThreadCount(), qMax(1, areaCount));
+    QVector<ChunkTable> areaChunks(areaCount);
+    QScopedArrayPointer<MapArena> workerArenas(new MapArena[workerCount]);
+    QAtomicInt nextArea(0);
+    QAtomicInt failedAreas(0);
+
+    auto decodeAreas = [&](int worker) {
+        MapArena::Scope workerScope(workerArenas[worker]);
+        for (int area = nextArea.fetchAndAddRelaxed(1); area < areaCount; area = nextArea.fetchAndAddRelaxed(1)) {
+            if (progress && progress->isCanceled()) {
+                break;
+            }
+            if (!decodeTileArea(tileAreas.at(area), areaChunks[area])) {
+                failedAreas.ref();
+            }
+            if (progress) {
+                progress->bytesConsumed.fetchAndAddRelaxed(tileAreas.at(area).size());
+                progress->areasDecoded.fetchAndAddRelaxed(1);
+            }
+        }
+    };
+
+    QElapsedTimer decodeTimer;
+    decodeTimer.start();
+    if (workerCount == 1) {
+        decodeAreas(0);
+    } else {
+        QThreadPool pool;
+        pool.setMaxThreadCount(workerCount);
+        for (int worker = 0; worker < workerCount; ++worker) {
+            pool.start([&decodeAreas, worker]() { decodeAreas(worker); });
+        }
+        pool.waitForDone();
+    }
+
+    // Merge in file order so duplicate tiles resolve the same way as a sequential load.
+    // Runs even after a cancel, so the tiles decoded so far are owned (and freed) by the map.
+    for (ChunkTable& chunks : areaChunks) {
+        adoptChunks(chunks);
+    }
+    for (int worker = 0; worker < workerCount; ++worker) {
+        arena_.adopt(workerArenas[worker]);
+    }
+    if (areaCount > 1) {
+        qDebug() << "Map::decodeTileAreas - Decoded" << areaCount << "tile areas on" << workerCount << "threads in"
+                 << decodeTimer.elapsed() << "ms," << tileCount_ << "tiles.";
+    }
+
+    if (progress && progress->isCanceled()) {
+        qDebug() << "Map::decodeTileAreas - Canceled after decoding" << progress->areasDecoded.loadRelaxed()
+                 << "of" << areaCount << "tile areas.";
+        return false;
+    }
+
+    cacheLoadedTileAreas(tileAreas);
+
+    if (failedAreas.loadRelaxed() > 0) {
+        qWarning() << "Map::decodeTileAreas -" << failedAreas.loadRelaxed() << "tile areas could not be read.";
+        return false;
+    }
+    return true;
+}
+
+void Map::loadPendingTileArea(quint64 key) {
+    auto pending = pendingTileAreas_.find(key);
+    if (pending == pendingTileAreas_.end()) {
+        return;
+    }
+    const QByteArrayView areaNode = pending.value();
+    pendingTileAreas_.erase(pending); // Before decoding, so a failed area is not retried on every lookup
+    if (!decodeTileAreas({areaNode}, nullptr)) {
+        qWarning() << "Map::loadPendingTileArea - Could not decode tile area" << Qt::hex << key;
+    }
+    if (pendingTileAreas_.isEmpty()) {
+        releasePendingSource();
+    }
+}
+
+void Map::loadTileAreas(const QRect& region, int z) {
+    if (pendingTileAreas_.isEmpty() || region.isEmpty() || z < 0 || z >= MAP_MAX_FLOORS) {
+        return;
+    }
+    const int left = qMax(0, region.left()) & ~(OTBM_TILE_AREA_SIZE - 1);
+    const int top = qMax(0, region.top()) & ~(OTBM_TILE_AREA_SIZE - 1);
+    const int right = qMin(region.right(), 0xFFFF);
+    const int bottom = qMin(region.bottom(), 0xFFFF);
+
+    QVector<quint64> keys;
+    QVector<QByteArrayView> areaNodes;
+    for (int y = top; y <= bottom; y += OTBM_TILE_AREA_SIZE) {
+        for (int x = left; x <= right; x += OTBM_TILE_AREA_SIZE) {
+            auto pending = pendingTileAreas_.find(tileAreaKey(x, y, z));
+            if (pending != pendingTileAreas_.end()) {
+                areaNodes.append(pending.value());
+                pendingTileAreas_.erase(pending);
+            }
+        }
+    }
+    if (areaNodes.isEmpty()) {
+        return;
+    }
+    if (!decodeTileAreas(areaNodes, nullptr)) {
+        qWarning() << "Map::loadTileAreas - Could not decode all tile areas in" << region << "on floor" << z;
+    }
+    if (pendingTileAreas_.isEmpty()) {
+        releasePendingSource();
+    }
+}
+
+void Map::loadAllTileAreas() {
+    if (pendingTileAreas_.isEmpty()) {
+        return;
+    }
+    const QVector<QByteArrayView> areaNodes = pendingTileAreas_.values().toVector();
+    pendingTileAreas_.clear();
+    if (!decodeTileAreas(areaNodes, nullptr)) {
+        qWarning() << "Map::loadAllTileAreas - Some tile areas could not be decoded.";
+    }
+    releasePendingSource();
+}
+
+void Map::releasePendingSource() {
+    delete pendingSource_; // Also unmaps the file
+    pendingSource_ = nullptr;
+    pendingSourceData_.clear();
+}
+
+bool Map::decodeTileArea(QByteArrayView areaNode, ChunkTable& chunks) const {
+    OtbmReader reader(areaNode);
+    ItemManager* itemManager = ItemManager::instance(); // Read-only while loading
+    const ItemAttributeDecoders& itemDecoders = *itemAttributeDecoders_;
+
+    quint8 nodeType;
+    if (!reader.enterNode(nodeType) || nodeType != OTBM_TILE_AREA) {
+        qWarning() << "Map::decodeTileArea - Not a TILE_AREA node.";
+        return false;
+    }
+
+    quint16 areaBaseX, areaBaseY;
+    quint8 areaBaseZ;
+    if (!reader.readU16(areaBaseX) || !reader.readU16(areaBaseY) || !reader.readByte(areaBaseZ)) {
+        qWarning() << "Map::decodeTileArea - Failed to read TILE_AREA coordinates.";
+        return false;
+    }
+
+    quint8 tileNodeType;
+    while(reader.enterNode(tileNodeType)) {
+        if (tileNodeType == OTBM_TILE || tileNodeType == OTBM_HOUSETILE) {
+            quint8 relX, relY;
+            if (!reader.readByte(relX) || !reader.readByte(relY)) { // Tile relative coordinates
+                qWarning() << "Map::decodeTileArea - Failed to read TILE relative coordinates.";
+                return false;
+            }
+
+            const int x = areaBaseX + relX;
+            const int y = areaBaseY + relY;
+            const int z = areaBaseZ;
+            if (!isCoordValid(x, y, z)) {
+                 qWarning() << "Map::decodeTileArea - Tile coordinates" << x << y << z << "are out of map bounds. Skipping tile.";
+                 if (!reader.leaveNode()) return false; // Skips the tile's attributes and items
+                 continue; // Skip to next tile node in area
+            }
+
+            MapChunk*& chunk = chunks[chunkKey(x, y, z)];
+            if (!chunk) {
+                chunk = new MapChunk(); // Detached (map == nullptr) until adoptChunks()
+                chunk->baseX = x & ~MapChunk::Mask;
+                chunk->baseY = y & ~MapChunk::Mask;
+                chunk->z = z;
+            }
+            Tile*& tile = chunk->tiles[chunkSlot(x, y)];
+            if (!tile) {
+                tile = new Tile(chunk, chunkSlot(x, y));
+                ++chunk->tileCount;
+            }
+            if (tileNodeType == OTBM_HOUSETILE) tile->setHouseTile(true);
+
+            quint8 tileAttrId;
+            while(reader.nextAttributeId(tileAttrId)) {
+                QByteArrayView tileAttrData;
+                if (!reader.readAttributeData(tileAttrData)) {
+                    qWarning() << "Map::decodeTileArea - Failed to read TILE attribute" << tileAttrId;
+                    return false;
+                }
+
+                if (tileAttrId == OTBM_ATTR_TILE_FLAGS) {
+                    quint32 flags = 0;
+                    if (tileAttrData.size() == sizeof(quint32)) flags = qFromLittleEndian<quint32>(tileAttrData.data()); else qWarning("Incorrect TILE_FLAGS length");
+                    tile->setMapFlagsValue(flags);
+                } else if (tileAttrId == OTBM_ATTR_HOUSEDOORID && tileNodeType == OTBM_HOUSETILE) {
+                    quint8 houseDoorId = 0;
+                    if (tileAttrData.size() == sizeof(quint8)) houseDoorId = static_cast<quint8>(tileAttrData.at(0)); else qWarning("Incorrect HOUSEDOORID length");
+                    tile->setHouseDoorId(houseDoorId);
+                } else {
+                     qDebug() << "Map::decodeTileArea - Skipping TILE/HOUSETILE attribute" << tileAttrId;
+                }
+            }
+
+            quint8 itemNodeType;
+            while(reader.enterNode(itemNodeType)) {
+                 if (itemNodeType == OTBM_ITEM) {
+                    Item* item = reader.readItem(itemManager, itemDecoders);
+                    if (item) {
+                        tile->addItem(item);
+                    } else if (reader.hasError()) {
+                        return false;
+                    } else {
+                        qDebug() << "Map::decodeTileArea - Failed to read item on tile" << x << y << z;
+                    }
+                } else {
+                    qWarning() << "Map::decodeTileArea - Unexpected node type" << itemNodeType << "inside TILE, expected OTBM_ITEM. Skipping node.";
+                }
+                if (!reader.leaveNode()) { qWarning() << "Map::decodeTileArea - Failed to leave item node."; return false; }
+            }
+            tile->setModified(false); // After all attributes and items for the tile have been read
+        } else {
+             qWarning() << "Map::decodeTileArea - Unexpected node type" << tileNodeType << "inside TILE_AREA, expected OTBM_TILE or OTBM_HOUSETILE. Skipping node.";
+        }
+        if (!reader.leaveNode()) { qWarning() << "Map::decodeTileArea - Failed to leave tile node."; return false; }
+    }
+
+    return reader.leaveNode();
+}
+
+void Map::adoptChunks(ChunkTable& chunks) {
+    for (MapChunk* chunk : std::as_const(chunks)) {
+        MapChunk*& existing = chunks_[chunkKey(chunk->baseX, chunk->baseY, chunk->z)];
+        if (!existing) {
+            chunk->map = this;
+            existing = chunk;
+            tileCount_ += chunk->tileCount;
+            continue;
+        }
+
+        // Another area already produced tiles in this chunk; move ours over slot by slot.
+        for (int slot = 0; slot < MapChunk::Size * MapChunk::Size; ++slot) {
+            Tile* tile = chunk->tiles[slot];
+            if (!tile) continue;
+            Tile*& target = existing->tiles[slot];
+            if (target) {
+                qWarning() << "Map::adoptChunks - Duplicate tile at" << tile->x() << tile->y() << tile->z() << "; keeping the later one.";
+                delete target;
+                --existing->tileCount;
+                --tileCount_;
+            }
+            target = tile;
+            tile->attach(existing, slot);
+            ++existing->tileCount;
+            ++tileCount_;
+            auto zones = chunk->zoneIds.find(static_cast<quint16>(slot));
+            if (zones != chunk->zoneIds.end()) {
+                existing->zoneIds.insert(static_cast<quint16>(slot), zones.value());
+            }
+        }
+        delete chunk; // Only the shell; its tiles now belong to existing
+    }
+    chunks.clear();
+}
+
+void Map::cacheLoadedTileAreas(const QVector<QByteArrayView>& areaNodes) {
+    // The file's area nodes can be reused as they are as long as each one covers exactly one
+    // of the 256x256 areas saveToOTBM() writes. Nodes at other offsets, or several nodes for
+    // the same area (possible in files from other editors), mark the areas involved dirty
+    // instead, so they are re-encoded from the decoded tiles on the next save.
+    for (QByteArrayView areaNode : areaNodes) {
+        OtbmReader reader(areaNode);
+        quint8 nodeType;
+        quint16 areaX, areaY;
+        quint8 areaZ;
+        if (!reader.enterNode(nodeType) || !reader.readU16(areaX) || !reader.readU16(areaY) || !reader.readByte(areaZ)) {
+            continue; // decodeTileArea() has already reported it
+        }
+
+        const quint64 key = tileAreaKey(areaX, areaY, areaZ);
+        const bool aligned = (areaX % OTBM_TILE_AREA_SIZE) == 0 && (areaY % OTBM_TILE_AREA_SIZE) == 0;
+        if (aligned && !tileAreaCache_.contains(key)) {
+            tileAreaCache_.insert(key, areaNode.toByteArray()); // Copied; the file's mapping goes away after load
+            continue;
+        }
+        // A misaligned node spans up to four areas; its first and last rows/columns name them.
+        for (int dy = 0; dy < OTBM_TILE_AREA_SIZE; dy += aligned ? OTBM_TILE_AREA_SIZE : OTBM_TILE_AREA_SIZE - 1) {
+            for (int dx = 0; dx < OTBM_TILE_AREA_SIZE; dx += aligned ? OTBM_TILE_AREA_SIZE : OTBM_TILE_AREA_SIZE - 1) {
+                dirtyTileAreas_.insert(tileAreaKey(areaX + dx, areaY + dy, areaZ));
+            }
+        }
+    }
+    for (quint64 key : std::as_const(dirtyTileAreas_)) {
+        tileAreaCache_.remove(key);
+    }
+}
+
+
+bool Map::writeOtbm(QIODevice& device, bool withTileAreas) const {
+    OtbmWriter writer;
+
+    // Writes whatever the writer has buffered so far and starts it afresh.
+    auto flush = [&device](OtbmWriter& buffered) {
+        const bool ok = device.write(buffered.data()) == buffered.size();
+        buffered.clear();
+        return ok;
+    };
 
-bool Map::saveToOTBM(QDataStream& stream) const {
-    OtbmWriter writer(stream);
+    // File identifier; the reader accepts four zero bytes (or none) before the root node.
+    writer.writeEncoded(QByteArrayView("\0\0\0\0", 4));
 
     // Start Root Node
     writer.beginNode(OTBM_ROOTV1);
@@ -953,75 +1588,74 @@ bool Map::saveToOTBM(QDataStream& stream) const {
     // based on a target client version (if that's a feature), do it here.
     // For now, we save using the map's loaded/current version.
 
-    // Iterate through the map to write TileArea nodes
-    // OTBM typically stores tiles in 256x256 areas per floor.
-    // We need to determine the actual extents of the map to avoid writing empty areas if possible,
-    // but the format expects areas to cover the declared map width/height.
-    // For simplicity, iterate based on current map dimensions, grouped into areas.
-
-    qDebug() << "Map::saveToOTBM - Map dimensions:" << width_ << "x" << height_ << "x" << floors_;
-
-    for (int z = 0; z < floors_; ++z) {
-        for (int areaY = 0; areaY < height_; areaY += 256) {
-            for (int areaX = 0; areaX < width_; areaX += 256) {
-                // Check if this area actually contains any tiles that need saving
-                bool areaHasTiles = false;
-                for (int relY = 0; relY < 256; ++relY) {
-                    if (areaY + relY >= height_) break; // Past map boundary
-                    for (int relX = 0; relX < 256; ++relX) {
-                        if (areaX + relX >= width_) break; // Past map boundary
-                        if (getTile(areaX + relX, areaY + relY, z) != nullptr) {
-                            areaHasTiles = true;
-                            break;
-                        }
-                    }
-                    if (areaHasTiles) break;
-                }
+    if (!flush(writer)) {
+        qWarning() << "Map::saveToOTBM - Failed to write map header:" << device.errorString();
+        return false;
+    }
 
-                if (areaHasTiles) {
-                    writer.beginNode(OTBM_TILE_AREA);
-                    writer.writeU16(areaX); // Area base X
-                    writer.writeU16(areaY); // Area base Y
-                    writer.writeByte(z);    // Area base Z (floor)
-
-                    // Iterate tiles within this area
-                    for (int relY = 0; relY < 256; ++relY) {
-                        if (areaY + relY >= height_) break;
-                        for (int relX = 0; relX < 256; ++relX) {
-                            if (areaX + relX >= width_) break;
-
-                            Tile* tile = getTile(areaX + relX, areaY + relY, z);
-                            if (tile) {
-                                // Begin Tile Node (OTBM_TILE or OTBM_HOUSETILE)
-                                writer.beginNode(tile->isHouseTile() ? OTBM_HOUSETILE : OTBM_TILE);
-                                writer.writeByte(static_cast<quint8>(relX)); // Relative X
-                                writer.writeByte(static_cast<quint8>(relY)); // Relative Y
-
-                                // Write Tile Attributes
-                                if (tile->getMapFlags() != 0) { // Only write if not default
-                                    writer.writeAttributeU32(OTBM_ATTR_TILE_FLAGS, static_cast<quint32>(tile->getMapFlags()));
-                                }
-                                if (tile->isHouseTile() && tile->getHouseDoorId() != 0) { // Example for house door ID
-                                     writer.writeAttributeByte(OTBM_ATTR_HOUSEDOORID, tile->getHouseDoorId());
-                                }
-                                // TODO: Other tile-specific attributes (e.g. from a QMap on Tile)
-
-                                // Write Items on Tile
-                                const QList<Item*>& items = tile->getItems();
-                                for (const Item* item : items) {
-                                    if (item) {
-                                       writer.writeItemNode(item, this->m_otbmMajorVersion, m_otbItemsMajorVersion, m_otbItemsMinorVersion); // UPDATED
-                                       // TODO (Task51): If item serialization is version-dependent, OtbmWriter::writeItemNode
-                                       // or Item::serializeOtbmAttributes might need version parameters.
-                                    }
-                                }
-                                writer.endNode(); // End Tile Node
-                            }
-                        }
-                    }
-                    writer.endNode(); // End TileArea Node
-                }
-            }
+    // Tile areas. Only areas holding at least one occupied chunk are written, so empty regions
+    // are skipped without looking at their cells. Areas untouched since the last load or save
+    // are copied from tileAreaCache_; the dirty ones are encoded into their own buffers on a
+    // thread pool. The buffers are then written in area order so the output is the same as a
+    // full sequential save. Encoding only reads tiles and items, and the map cannot change
+    // while this (GUI thread) call blocks.
+    const QVector<TileAreaChunks> areas = withTileAreas ? collectTileAreas() : QVector<TileAreaChunks>();
+    QVector<QByteArray> areaData(areas.size());
+    QVector<int> dirtyAreas;
+    for (int area = 0; area < areas.size(); ++area) {
+        const TileAreaChunks& chunks = areas.at(area);
+        const quint64 key = tileAreaKey(chunks.x, chunks.y, chunks.z);
+        auto cached = tileAreaCache_.constFind(key);
+        if (cached != tileAreaCache_.constEnd() && !dirtyTileAreas_.contains(key)) {
+            areaData[area] = cached.value();
+        } else {
+            dirtyAreas.append(area);
+        }
+    }
+
+    const int areaCount = dirtyAreas.size();
+    const int workerCount = qBound(1, QThread::idealThreadCount(), qMax(1, areaCount));
+    QAtomicInt nextArea(0);
+
+    auto encodeAreas = [&]() {
+        for (int next = nextArea.fetchAndAddRelaxed(1); next < areaCount; next = nextArea.fetchAndAddRelaxed(1)) {
+            const int area = dirtyAreas.at(next);
+            OtbmWriter areaWriter;
+            encodeTileArea(areas.at(area), areaWriter);
+            areaData[area] = areaWriter.data();
+        }
+    };
+
+    QElapsedTimer encodeTimer;
+    encodeTimer.start();
+    if (workerCount == 1) {
+        encodeAreas();
+    } else {
+        QThreadPool pool;
+        pool.setMaxThreadCount(workerCount);
+        for (int worker = 0; worker < workerCount; ++worker) {
+            pool.start(encodeAreas);
+        }
+        pool.waitForDone();
+    }
+    qDebug() << "Map::saveToOTBM - Encoded" << areaCount << "of" << areas.size() << "tile areas on"
+             << workerCount << "threads in" << encodeTimer.elapsed() << "ms.";
+
+    // The buffers now match the map's current state whether or not the write below succeeds,
+    // so they become the cache (areas that no longer hold tiles drop out of it).
+    if (withTileAreas) {
+        tileAreaCache_.clear();
+        for (int area = 0; area < areas.size(); ++area) {
+            const TileAreaChunks& chunks = areas.at(area);
+            tileAreaCache_.insert(tileAreaKey(chunks.x, chunks.y, chunks.z), areaData.at(area));
+        }
+        dirtyTileAreas_.clear();
+    }
+
+    for (const QByteArray& data : std::as_const(areaData)) {
+        if (device.write(data) != data.size()) {
+            qWarning() << "Map::saveToOTBM - Failed to write tile area:" << device.errorString();
+            return false;
         }
     }
 
@@ -1077,10 +1711,79 @@ bool Map::saveToOTBM(QDataStream& stream) const {
     writer.endNode(); // End Map Data Node
     writer.endNode(); // End Root Node
 
-    if (stream.status() == QDataStream::Ok) {
-        Map* nonConstThis = const_cast<Map*>(this);
-        nonConstThis->setModified(false);
-        qDebug() << "Map::saveToOTBM - Successfully saved OTBM data. Map set to unmodified.";
+    if (!flush(writer)) {
+        qWarning() << "Map::saveToOTBM - Failed to write map trailer:" << device.errorString();
+        return false;
+    }
+    qDebug() << "Map::saveToOTBM - Successfully wrote OTBM data.";
+    return true;
+}
+
+QVector<Map::TileAreaChunks> Map::collectTileAreas() const {
+    // tileAreaKey() orders by floor, then y, then x, so areas come out in the order of a row-by-row scan.
+    QMap<quint64, TileAreaChunks> areas;
+    for (const MapChunk* chunk : chunks_) {
+        if (chunk->tileCount == 0) {
+            continue;
+        }
+        TileAreaChunks& area = areas[tileAreaKey(chunk->baseX, chunk->baseY, chunk->z)];
+        area.x = chunk->baseX & ~(OTBM_TILE_AREA_SIZE - 1);
+        area.y = chunk->baseY & ~(OTBM_TILE_AREA_SIZE - 1);
+        area.z = chunk->z;
+        area.chunks.append(chunk);
+    }
+
+    QVector<TileAreaChunks> result;
+    result.reserve(areas.size());
+    for (TileAreaChunks& area : areas) {
+        std::sort(area.chunks.begin(), area.chunks.end(), [](const MapChunk* a, const MapChunk* b) {
+            return a->baseY != b->baseY ? a->baseY < b->baseY : a->baseX < b->baseX;
+        });
+        result.append(std::move(area));
+    }
+    return result;
+}
+
+void Map::encodeTileArea(const TileAreaChunks& area, OtbmWriter& writer) const {
+    writer.beginNode(OTBM_TILE_AREA);
+    writer.writeU16(static_cast<quint16>(area.x)); // Area base X
+    writer.writeU16(static_cast<quint16>(area.y)); // Area base Y
+    writer.writeByte(static_cast<quint8>(area.z)); // Area base Z (floor)
+
+    for (const MapChunk* chunk : area.chunks) {
+        for (int slot = 0; slot < MapChunk::Size * MapChunk::Size; ++slot) {
+            const Tile* tile = chunk->tiles[slot];
+            if (!tile) {
+                continue;
+            }
+            const int relX = chunk->baseX - area.x + (slot & MapChunk::Mask);
+            const int relY = chunk->baseY - area.y + (slot >> MapChunk::SizeShift);
+
+            // Begin Tile Node (OTBM_TILE or OTBM_HOUSETILE)
+            writer.beginNode(tile->isHouseTile() ? OTBM_HOUSETILE : OTBM_TILE);
+            writer.writeByte(static_cast<quint8>(relX)); // Relative X
+            writer.writeByte(static_cast<quint8>(relY)); // Relative Y
+
+            // Write Tile Attributes
+            if (tile->getMapFlags() != 0) { // Only write if not default
+                writer.writeAttributeU32(OTBM_ATTR_TILE_FLAGS, static_cast<quint32>(tile->getMapFlags()));
+            }
+            if (tile->isHouseTile() && tile->getHouseDoorId() != 0) { // Example for house door ID
+                writer.writeAttributeByte(OTBM_ATTR_HOUSEDOORID, tile->getHouseDoorId());
+            }
+            // TODO: Other tile-specific attributes (e.g. from a QMap on Tile)
+
+            // Write Items on Tile; the ground is kept apart from getItems() and goes first
+            if (const Item* ground = tile->getGround()) {
+                writer.writeItemNode(ground, m_otbmMajorVersion, m_otbItemsMajorVersion, m_otbItemsMinorVersion);
+            }
+            for (const Item* item : tile->getItems()) {
+                if (item) {
+                    writer.writeItemNode(item, m_otbmMajorVersion, m_otbItemsMajorVersion, m_otbItemsMinorVersion);
+                }
+            }
+            writer.endNode(); // End Tile Node
+        }
     }
-    return stream.status() == QDataStream::Ok;
+    writer.endNode(); // End TileArea Node
 }
@@ -25,7 +25,11 @@
 // or is a type alias for something like QVector3D for the purpose of this skeleton.
 // For a typical Qt Widgets application, QVector3D from QtGui could be an option.
 // Given the context, I will use a simple struct for now.
-#include <QDataStream> // For loadFromOTBM
+#include <QIODevice> // For saveToOTBM
+#include <QByteArrayView> // For loadFromOTBM
+#include <QSet> // For dirtyTileAreas_
+#include <QAtomicInt> // For MapLoadProgress
+#include <QRect> // For loadTileAreas
 
 struct MapPos {
     int x = 0;
@@ -39,6 +43,9 @@ struct MapPos {
 };
 
 #include <QtGlobal> // For qHash
+#include <QHash>    // For sparse chunk storage
+#include <QVarLengthArray> // For forEachTileIn
+#include "MapArena.h" // Tile/Item storage
 
 // qHash function for MapPos
 inline uint qHash(const MapPos& pos, uint seed = 0) {
@@ -49,6 +56,7 @@ inline uint qHash(const MapPos& pos, uint seed = 0) {
 
 
 // Forward declarations
+class Map;
 class Tile;
 class Item;
 class Creature;
@@ -57,8 +65,54 @@ class House;
 class Town; // Forward-declare Town
 class Waypoint;
 class Selection; // Forward-declare Selection
+class OtbmWriter;
+struct ItemAttributeDecoders;
+class QFile;
 // Add any other classes that Map might store by pointer and need forward declaration
 
+// Number of Z-layers in a Tibia map (0 = highest floor, 7 = ground level, 15 = deepest).
+const int MAP_MAX_FLOORS = 16;
+
+// Fixed-size block of tile slots on a single floor. The map only allocates a chunk
+// once a tile is placed inside it, so empty regions (open ocean, unused floors)
+// cost nothing regardless of the declared map dimensions.
+struct MapChunk {
+    static constexpr int SizeShift = 5;
+    static constexpr int Size = 1 << SizeShift; // 32x32 tiles per chunk
+    static constexpr int Mask = Size - 1;
+
+    Map* map = nullptr;   // Owning map, receives tile change notifications
+    int baseX = 0;        // World position of slot 0; tiles derive their coordinates from it
+    int baseY = 0;
+    int z = 0;
+
+    Tile* tiles[Size * Size] = {}; // Row-major, indexed by (y & Mask) * Size + (x & Mask)
+    int tileCount = 0;             // Number of non-null slots; chunk is released when it drops to 0
+
+    // Zone ids are rare, so they live in a side table keyed by slot instead of on every Tile.
+    QHash<quint16, QVector<quint16>> zoneIds;
+};
+
+// Progress of a running Map::load, shared with an observer on another thread (see MapLoader).
+// The loader updates the counters as it goes and gives up as soon as canceled is set.
+struct MapLoadProgress {
+    QAtomicInteger<qint64> bytesTotal;
+    QAtomicInteger<qint64> bytesConsumed;
+    QAtomicInt areaCount;    // Tile areas in the file, known once the first pass is done
+    QAtomicInt areasDecoded;
+    QAtomicInt canceled;
+
+    bool isCanceled() const { return canceled.loadRelaxed() != 0; }
+};
+
+// Full decodes every tile area while loading. OnDemand only reads the header, towns,
+// waypoints and an index of the tile areas; each area is decoded the first time something
+// touches it (see Map::loadTileAreas), so opening a huge map costs the same as a small one.
+enum class MapLoadMode {
+    Full,
+    OnDemand
+};
+
 class Map : public QObject {
     Q_OBJECT
 
@@ -94,7 +148,7 @@ public:
     Tile* getTile(int x, int y, int z) const;
     Tile* getTile(const MapPos& pos) const; // Convenience overload using custom MapPos struct
     // Tile* getTile(const QVector3D& pos) const; // Alternative using QVector3D
-    bool setTile(int x, int y, int z, Tile* tile); // Map takes ownership if successful. Returns false if coords are invalid.
+    bool setTile(int x, int y, int z, Tile* tile); // Map takes ownership if successful. Returns false if coords are invalid or tile is not from arena().
     Tile* createTile(int x, int y, int z); // Creates a new tile, Map owns it. Returns nullptr if coords invalid or tile alloc fails.
 
     // Stubs for map-wide entities
@@ -148,6 +202,35 @@ public:
     void removeTile(const QPointF& pos); // If it becomes empty
     void removeTile(int x, int y, int z);   // Overload
 
+    // Called by Tile in place of per-tile signals. Selection and other state changes come
+    // through here too, so it leaves the tile's area alone; content changes go through
+    // Tile::setModified or markModified(tile).
+    void notifyTileChanged(int x, int y, int z, bool visual);
+    // Called by Tile::setModified; the tile's OTBM area is re-serialized on the next save, and
+    // its chunk's record on the next snapshot.
+    void markTileAreaDirty(int x, int y, int z) {
+        dirtyTileAreas_.insert(tileAreaKey(x, y, z));
+        dirtySnapshotChunks_.insert(chunkKey(x, y, z));
+    }
+    // For brushes that change a tile's items: flags the map as modified and the tile's area
+    // for re-serialization.
+    void markModified(const Tile* tile);
+
+    // Sparse storage statistics
+    int tileCount() const { return tileCount_; }
+    int chunkCount() const { return chunks_.size(); }
+
+    // Calls visit(Tile*, x, y) for every tile inside region (tile coordinates) on floor z,
+    // row by row from the top-left, so overlapping tiles stack as they would on screen.
+    // Only the chunks overlapping region are looked up, so the cost follows the size of the
+    // region and not of the map. Pending tile areas are not decoded; call loadTileAreas first.
+    template <typename Visitor>
+    void forEachTileIn(const QRect& region, int z, Visitor&& visit) const;
+
+    // Block storage for this map's tiles and items; make it current (MapArena::Scope)
+    // around code that creates many of them for this map.
+    MapArena& arena() { return arena_; }
+
     // Ground operations taking item ID
     void setGround(const QPointF& pos, quint16 groundItemId);
     void removeGround(const QPointF& pos);
@@ -156,26 +239,122 @@ public:
     void requestBorderUpdate(const QPointF& tilePos);
     void requestWallUpdate(const QPointF& tilePos);
 
-    // Stubs for loading/saving
-    bool load(const QString& path);
+    // Stubs for loading/saving. Paths ending in .gz are saved compressed (see MapCompression);
+    // load() recognises compressed files by content, whatever their name.
+    bool load(const QString& path, MapLoadProgress* progress = nullptr, MapLoadMode mode = MapLoadMode::Full);
     bool save(const QString& path) const;
-    bool loadFromOTBM(QDataStream& stream); // Added
-    bool saveToOTBM(QDataStream& stream) const; // Added
+    // data must stay valid while loading; in OnDemand mode also for as long as
+    // hasPendingTileAreas() (load() keeps the file mapped for that).
+    bool loadFromOTBM(QByteArrayView data, MapLoadProgress* progress = nullptr, MapLoadMode mode = MapLoadMode::Full);
+
+    // On-demand loading. Tile lookups and edits (getTile, createTile, ...) decode the area they
+    // touch on their own; views, searches and other whole-region operations should request
+    // their region up front so it is decoded in one go. save() decodes everything left.
+    bool hasPendingTileAreas() const { return !pendingTileAreas_.isEmpty(); }
+    void loadTileAreas(const QRect& region, int z); // region in tile coordinates
+    void loadAllTileAreas();
+    bool saveToOTBM(QIODevice& device) const { return writeOtbm(device, true); } // Writes the complete file; save() wraps it in an atomic QSaveFile
+
+    // Writes the editor-native snapshot of this map next to sourcePath (see MapSnapshot), which
+    // must be the file the map was just loaded from or saved to. Only the chunk records are
+    // taken here, on the map's thread, and only those of chunks changed since the last snapshot
+    // are encoded again; hashing the source and writing the file happen on the global thread
+    // pool. save() calls it on its own, MapLoader once a full load has been handed over. Does
+    // nothing while tile areas are still pending or the snapshot is current.
+    void saveSnapshotInBackground(const QString& sourcePath);
+    bool hasCurrentSnapshot() const { return snapshotCurrent_; } // Loaded from, or already queued a snapshot
 
 signals:
     void mapChanged(); // Example signal
     void dimensionsChanged(int newWidth, int newHeight, int newFloors);
     void tileChanged(int x, int y, int z); // Example for more granular updates
+    void tileVisualChanged(int x, int y, int z); // Tile content changed in a way that needs a repaint
 
 private:
-    int getTileIndex(int x, int y, int z) const;
     bool isCoordValid(int x, int y, int z) const; // Helper for coordinate validation
 
+    // Chunk helpers. Coordinates must already be validated with isCoordValid().
+    static quint64 chunkKey(int x, int y, int z) {
+        return (quint64(quint32(z)) << 48) |
+               (quint64(quint32(x) >> MapChunk::SizeShift) << 24) |
+               quint64(quint32(y) >> MapChunk::SizeShift);
+    }
+    static int chunkSlot(int x, int y) {
+        return ((y & MapChunk::Mask) << MapChunk::SizeShift) | (x & MapChunk::Mask);
+    }
+    MapChunk* findChunk(int x, int y, int z) const;
+    MapChunk* getOrCreateChunk(int x, int y, int z);
+    void releaseChunkIfEmpty(int x, int y, int z);
+
+    // OTBM loading helpers (see loadFromOTBM). decodeTileArea() turns one OTBM_TILE_AREA
+    // node into detached chunks (chunk->map == nullptr, so tiles send no notifications);
+    // it only reads immutable map state and runs on loader threads. adoptChunks() moves
+    // decoded chunks into chunks_ on the map's own thread.
+    using ChunkTable = QHash<quint64, MapChunk*>;
+    bool decodeTileArea(QByteArrayView areaNode, ChunkTable& chunks) const;
+    void adoptChunks(ChunkTable& chunks);
+    void cacheLoadedTileAreas(const QVector<QByteArrayView>& areaNodes); // Seeds tileAreaCache_
+    // Decodes and adopts a set of area nodes (in parallel when there are several).
+    bool decodeTileAreas(const QVector<QByteArrayView>& tileAreas, MapLoadProgress* progress);
+    void loadPendingTileArea(quint64 key);
+    void releasePendingSource();
+
+    // OTBM saving helpers (see saveToOTBM). collectTileAreas() groups the occupied chunks
+    // into the file's 256x256 tile areas in file order; encodeTileArea() serializes one
+    // area and runs on saver threads.
+    static constexpr int OTBM_TILE_AREA_SIZE = 256;
+    static quint64 tileAreaKey(int x, int y, int z) { // Orders areas by floor, then row, then column
+        return (quint64(quint32(z)) << 32) |
+               (quint64(quint32(y) & ~quint32(OTBM_TILE_AREA_SIZE - 1)) << 16) |
+               quint64(quint32(x) & ~quint32(OTBM_TILE_AREA_SIZE - 1));
+    }
+    struct TileAreaChunks {
+        int x = 0;
+        int y = 0;
+        int z = 0;
+        QVector<const MapChunk*> chunks; // Sorted by row, then column
+    };
+    QVector<TileAreaChunks> collectTileAreas() const;
+    void encodeTileArea(const TileAreaChunks& area, OtbmWriter& writer) const;
+
+    // withTileAreas false leaves the tile areas out; the rest is the snapshot's skeleton.
+    bool writeOtbm(QIODevice& device, bool withTileAreas) const;
+
+    // Snapshot helpers. encodeSnapshotChunk() appends one chunk record (see MapSnapshot) to
+    // records; decodeSnapshotChunk() builds the chunk it describes into chunks, allocating from
+    // the current arena. Like decodeTileArea() it only reads immutable map state.
+    void encodeSnapshotChunk(const MapChunk* chunk, QByteArray& records) const;
+    bool decodeSnapshotChunk(QByteArrayView record, ChunkTable& chunks) const;
+    // Loads from the snapshot next to sourcePath; false (quietly) if there is none or it is stale.
+    bool loadSnapshot(const QString& sourcePath, MapLoadProgress* progress);
+
     QString description_;
     int width_ = 0;
     int height_ = 0;
     int floors_ = 0;
-    QVector<Tile*> tiles_; // Flat list of all tiles, Map owns these Tile objects
+    QHash<quint64, MapChunk*> chunks_; // Sparse tile storage keyed by chunkKey(); Map owns chunks and tiles
+    int tileCount_ = 0;
+    MapArena arena_; // Backs the tiles and items created for this map; see clear()
+
+    // Encoded OTBM_TILE_AREA nodes from the last load or save, keyed by tileAreaKey(). Areas
+    // touched since then are listed in dirtyTileAreas_; saveToOTBM() re-encodes only those
+    // and splices in the cached bytes of the rest. The encoding also depends on the OTBM and
+    // items versions, which only change on load (which starts a fresh cache).
+    mutable QHash<quint64, QByteArray> tileAreaCache_;
+    mutable QSet<quint64> dirtyTileAreas_;
+
+    // Undecoded OTBM_TILE_AREA nodes of an on-demand load, keyed by tileAreaKey(). They are
+    // views into the source file, which stays mapped (or read into memory) until all are decoded.
+    QHash<quint64, QByteArrayView> pendingTileAreas_;
+    const ItemAttributeDecoders* itemAttributeDecoders_ = nullptr; // For the versions of the file being read
+    QFile* pendingSource_ = nullptr;  // Child of the map
+    QByteArray pendingSourceData_;
+    bool snapshotCurrent_ = false; // See hasCurrentSnapshot()
+    // Encoded chunk records of the last snapshot taken or loaded, keyed by chunkKey(); like
+    // tileAreaCache_, but for saveSnapshotInBackground(). Chunks touched since are listed in
+    // dirtySnapshotChunks_.
+    QHash<quint64, QByteArray> snapshotChunkCache_;
+    QSet<quint64> dirtySnapshotChunks_;
 
     // Placeholder containers for map-wide entities
     // Ownership: If these are created *by* the Map (e.g. map.createNewHouse()), Map owns.
@@ -203,4 +382,41 @@ private:
     mutable bool m_modified = false; // Add modified flag, default to false
 };
 
+template <typename Visitor>
+void Map::forEachTileIn(const QRect& region, int z, Visitor&& visit) const {
+    const QRect tiles = region & QRect(0, 0, width_, height_);
+    if (tiles.isEmpty() || z < 0 || z >= floors_ || chunks_.isEmpty()) {
+        return;
+    }
+    const int firstChunkX = tiles.left() >> MapChunk::SizeShift;
+    const int lastChunkX = tiles.right() >> MapChunk::SizeShift;
+    QVarLengthArray<const MapChunk*, 64> rowChunks(lastChunkX - firstChunkX + 1);
+
+    for (int bandTop = tiles.top(); bandTop <= tiles.bottom();) {
+        const int bandBottom = qMin(tiles.bottom(), bandTop | MapChunk::Mask);
+        // One lookup per chunk in this band of rows; empty regions have no chunk to visit.
+        bool anyChunk = false;
+        for (int i = 0; i < rowChunks.size(); ++i) {
+            rowChunks[i] = chunks_.value(chunkKey((firstChunkX + i) << MapChunk::SizeShift, bandTop, z), nullptr);
+            anyChunk = anyChunk || rowChunks[i];
+        }
+        for (int y = bandTop; anyChunk && y <= bandBottom; ++y) {
+            for (int i = 0; i < rowChunks.size(); ++i) {
+                const MapChunk* chunk = rowChunks[i];
+                if (!chunk) {
+                    continue;
+                }
+                const int chunkLeft = (firstChunkX + i) << MapChunk::SizeShift;
+                const int xEnd = qMin(tiles.right(), chunkLeft + MapChunk::Mask);
+                for (int x = qMax(tiles.left(), chunkLeft); x <= xEnd; ++x) {
+                    if (Tile* tile = chunk->tiles[chunkSlot(x, y)]) {
+                        visit(tile, x, y);
+                    }
+                }
+            }
+        }
+        bandTop = bandBottom + 1;
+    }
+}
+
 #endif // MAP_H
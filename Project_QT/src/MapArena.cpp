@@ -0,0 +1,220 @@
+#include "MapArena.h"
+
+#include <QtGlobal> // For Q_ASSERT, Q_OS_WIN
+#include <cstdlib>  // For std::aligned_alloc, std::free
+#include <new>      // For std::bad_alloc
+#ifdef Q_OS_WIN
+#include <malloc.h> // For _aligned_malloc, _aligned_free
+#endif
+
+namespace {
+thread_local MapArena* t_currentArena = nullptr;
+
+// Blocks are aligned to their own size so headerOf() can find them by masking a pointer.
+// (qMallocAligned would over-allocate by a whole block to achieve that.)
+void* allocateBlock() {
+#ifdef Q_OS_WIN
+    return _aligned_malloc(MapArena::BlockSize, MapArena::BlockSize);
+#else
+    return std::aligned_alloc(MapArena::BlockSize, MapArena::BlockSize);
+#endif
+}
+
+void freeBlock(void* block) {
+#ifdef Q_OS_WIN
+    _aligned_free(block);
+#else
+    std::free(block);
+#endif
+}
+
+// Offset of the first object in a block; keeps objects aligned to Granularity.
+constexpr size_t headerSpace(size_t headerSize) {
+    return (headerSize + MapArena::Granularity - 1) & ~(MapArena::Granularity - 1);
+}
+} // namespace
+
+MapArena::~MapArena() {
+    release();
+}
+
+void MapArena::addBlock() {
+    void* memory = allocateBlock();
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+    BlockHeader* header = static_cast<BlockHeader*>(memory);
+    header->arena = this;
+    header->next = blocks_;
+    header->liveCount = 0;
+    header->pinCount = 0;
+    blocks_ = header;
+    ++blockCount_;
+
+    bump_ = static_cast<char*>(memory) + headerSpace(sizeof(BlockHeader));
+    bumpEnd_ = static_cast<char*>(memory) + BlockSize;
+}
+
+void* MapArena::allocate(size_t size) {
+    if (size == 0 || size > MaxObjectSize) {
+        return ::operator new(size);
+    }
+
+    const size_t cls = sizeClass(size);
+    if (FreeNode* node = freeLists_[cls]) {
+        freeLists_[cls] = node->next;
+        ++headerOf(node)->liveCount;
+        return node;
+    }
+
+    const size_t rounded = (cls + 1) * Granularity;
+    if (bump_ == nullptr || bump_ + rounded > bumpEnd_) {
+        addBlock(); // The tail of the previous block is simply left unused
+    }
+    void* p = bump_;
+    bump_ += rounded;
+    ++blocks_->liveCount;
+    return p;
+}
+
+void MapArena::deallocate(void* p, size_t size) {
+    if (!p) {
+        return;
+    }
+    if (size == 0 || size > MaxObjectSize) {
+        ::operator delete(p);
+        return;
+    }
+
+    BlockHeader* header = headerOf(p);
+    Q_ASSERT(header->liveCount > 0);
+    --header->liveCount;
+
+    if (MapArena* arena = header->arena) {
+        FreeNode* node = static_cast<FreeNode*>(p);
+        const size_t cls = sizeClass(size);
+        node->next = arena->freeLists_[cls];
+        arena->freeLists_[cls] = node;
+    } else if (header->liveCount == 0) {
+        freeBlock(header); // Last survivor of an orphaned block
+    }
+}
+
+void MapArena::release() {
+    BlockHeader* block = blocks_;
+    while (block) {
+        BlockHeader* next = block->next;
+        if (block->liveCount == 0) {
+            freeBlock(block);
+        } else {
+            block->arena = nullptr; // Orphaned; freed by its last deallocate()
+            block->next = nullptr;
+        }
+        block = next;
+    }
+    resetState(); // Objects that stay alive unregister from nothing once their block is orphaned
+}
+
+void MapArena::drop() {
+    // A finalizer may delete other registered objects (a tile its items), which then remove
+    // their own entries, so entries are taken out one at a time.
+    while (!finalizers_.isEmpty()) {
+        const auto entry = finalizers_.begin();
+        void* object = entry.key();
+        const Finalizer finalize = entry.value();
+        finalizers_.erase(entry);
+        finalize(object);
+    }
+
+    BlockHeader* block = blocks_;
+    while (block) {
+        BlockHeader* next = block->next;
+        if (block->pinCount == 0) {
+            freeBlock(block);
+        } else {
+            // Only the pinned objects are still meaningful; the block goes with the last of them.
+            block->arena = nullptr;
+            block->next = nullptr;
+            block->liveCount = block->pinCount;
+        }
+        block = next;
+    }
+    resetState();
+}
+
+void MapArena::unpin(const void* object) {
+    BlockHeader* header = headerOf(object);
+    Q_ASSERT(header->pinCount > 0);
+    --header->pinCount;
+}
+
+void MapArena::resetState() {
+    blocks_ = nullptr;
+    bump_ = nullptr;
+    bumpEnd_ = nullptr;
+    for (FreeNode*& list : freeLists_) {
+        list = nullptr;
+    }
+    blockCount_ = 0;
+    finalizers_.clear();
+}
+
+void MapArena::adopt(MapArena& other) {
+    if (&other == this || !other.blocks_) {
+        return;
+    }
+
+    BlockHeader* last = other.blocks_;
+    for (BlockHeader* block = other.blocks_; block; block = block->next) {
+        block->arena = this;
+        last = block;
+    }
+    // Keep our newest block first so bump allocation continues where it was.
+    if (blocks_) {
+        last->next = blocks_->next;
+        blocks_->next = other.blocks_;
+    } else {
+        blocks_ = other.blocks_;
+        bump_ = other.bump_;
+        bumpEnd_ = other.bumpEnd_;
+    }
+    blockCount_ += other.blockCount_;
+
+    for (size_t cls = 0; cls < SizeClassCount; ++cls) {
+        FreeNode* list = other.freeLists_[cls];
+        if (!list) continue;
+        FreeNode* tail = list;
+        while (tail->next) tail = tail->next;
+        tail->next = freeLists_[cls];
+        freeLists_[cls] = list;
+    }
+
+    finalizers_.insert(other.finalizers_);
+    other.resetState();
+}
+
+MapArena* MapArena::current() {
+    if (t_currentArena) {
+        return t_currentArena;
+    }
+    thread_local MapArena threadDefaultArena;
+    return &threadDefaultArena;
+}
+
+MapArena::Scope::Scope(MapArena& arena) :
+    previous_(t_currentArena)
+{
+    t_currentArena = &arena;
+}
+
+MapArena::Scope::Scope(MapArena* arena) :
+    previous_(t_currentArena)
+{
+    if (arena) {
+        t_currentArena = arena;
+    }
+}
+
+MapArena::Scope::~Scope() {
+    t_currentArena = previous_;
+}
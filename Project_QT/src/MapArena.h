@@ -0,0 +1,115 @@
+#ifndef MAPARENA_H
+#define MAPARENA_H
+
+#include <QtGlobal> // For quint32, quintptr
+#include <QHash>    // For the finalizer table
+#include <cstddef>  // For size_t
+
+// Block allocator for the small, numerous objects that make up a map (Tiles and Items).
+//
+// Objects are bump-allocated from large aligned blocks; freed objects go onto a per-size
+// free list and are reused by later allocations of the same size. Every block starts with
+// a header naming its arena and counting its live objects, so an object can be freed
+// without knowing which arena it came from.
+//
+// release() drops all blocks in one sweep instead of returning objects one by one to the
+// system allocator. Blocks that still hold live objects (e.g. items moved into an undo
+// command or the clipboard) are orphaned rather than freed and go away with their last
+// object, so release() never invalidates a live pointer.
+//
+// drop() goes further and discards the objects themselves without running their
+// destructors, which is how a Map frees its tiles and items. Objects that own memory outside
+// the arena (a heap buffer, a QObject, shared attributes) or that live in another arena
+// register a finalizer while they do, and drop() runs only those. Objects that leave the
+// map while staying alive are pinned; their blocks are orphaned instead of freed.
+//
+// Arenas are not thread-safe: an arena and the objects in it must only be allocated and
+// freed on one thread at a time.
+class MapArena {
+public:
+    static constexpr size_t BlockSize = 64 * 1024;
+    static constexpr size_t Granularity = 16;     // Allocation sizes are rounded up to this
+    static constexpr size_t MaxObjectSize = 256;  // Larger requests go to the global heap
+
+    MapArena() = default;
+    ~MapArena();
+
+    MapArena(const MapArena&) = delete;
+    MapArena& operator=(const MapArena&) = delete;
+
+    void* allocate(size_t size);
+    static void deallocate(void* p, size_t size);
+
+    // Frees every block without live objects at once and forgets the rest (see above).
+    void release();
+
+    // Runs the registered finalizers, then frees every block without pinned objects at once,
+    // whether or not it still holds live objects (see above). Orphans the rest.
+    void drop();
+
+    using Finalizer = void (*)(void* object);
+    // At most one finalizer per object; registering again replaces it.
+    void addFinalizer(void* object, Finalizer finalize) { finalizers_.insert(object, finalize); }
+    void removeFinalizer(void* object) { finalizers_.remove(object); }
+    int finalizerCount() const { return finalizers_.size(); }
+
+    // Arena that allocated object, or null if its block has been orphaned. object must come
+    // from allocate() and be no larger than MaxObjectSize.
+    static MapArena* arenaOf(const void* object) { return headerOf(object)->arena; }
+
+    // A pinned object survives drop() (see above). Pins are counted; object as for arenaOf().
+    static void pin(const void* object) { ++headerOf(object)->pinCount; }
+    static void unpin(const void* object);
+
+    // Takes over all blocks and finalizers of another arena (and thereby the objects in
+    // them), leaving it empty. Used to hand storage filled on a loader thread to the map that keeps the objects.
+    void adopt(MapArena& other);
+
+    int blockCount() const { return blockCount_; }
+
+    // The arena that Tile/Item operator new allocates from on this thread: the innermost
+    // active Scope's arena, or a per-thread default arena for objects not tied to a map.
+    static MapArena* current();
+
+    // Makes an arena current for the calling thread for the lifetime of the scope.
+    class Scope {
+    public:
+        explicit Scope(MapArena& arena);
+        explicit Scope(MapArena* arena); // A null arena leaves the current one in place
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        MapArena* previous_;
+    };
+
+private:
+    struct BlockHeader {
+        MapArena* arena;     // Null once the block has been orphaned by release()
+        BlockHeader* next;   // Next block of the same arena
+        quint32 liveCount;   // Objects allocated from this block and not yet freed
+        quint32 pinCount;    // Live objects that must survive drop()
+    };
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    static constexpr size_t SizeClassCount = MaxObjectSize / Granularity;
+
+    static BlockHeader* headerOf(const void* p) {
+        return reinterpret_cast<BlockHeader*>(reinterpret_cast<quintptr>(p) & ~(quintptr(BlockSize) - 1));
+    }
+    static size_t sizeClass(size_t size) { return (size + Granularity - 1) / Granularity - 1; }
+
+    void addBlock();
+    void resetState(); // Forgets all blocks, free lists and finalizers
+
+    BlockHeader* blocks_ = nullptr;
+    char* bump_ = nullptr;     // Next free byte in the newest block
+    char* bumpEnd_ = nullptr;  // End of the newest block
+    FreeNode* freeLists_[SizeClassCount] = {};
+    int blockCount_ = 0;
+    QHash<void*, Finalizer> finalizers_;
+};
+
+#endif // MAPARENA_H
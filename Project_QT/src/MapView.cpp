@@ -3,6 +3,10 @@
 #include "Brush.h" // Include Brush.h for Brush type
 #include "BrushManager.h" // Added
 #include "Map.h"          // Added
+#include "Tile.h"         // For Tile::draw
+#include "SpriteManager.h"
+#include "SpriteAtlas.h"     // Item frames of the visible tiles
+#include "OutfitCompositor.h" // Creature outfits for the tiles drawn
 #include "QUndoStack.h"   // Added
 #include <QGraphicsScene>
 #include <QScrollBar>
@@ -67,6 +71,9 @@ MapView::MapView(BrushManager* brushManager, Map* map, QUndoStack* undoStack, QW
     setResizeAnchor(QGraphicsView::AnchorViewCenter);
     setFocusPolicy(Qt::StrongFocus); // To receive key events
 
+    drawingOptions_.currentFloor = currentFloor_;
+    setMap(map);
+
     // Instantiate the new input handler
     inputHandler_ = new MapViewInputHandler(this, brushManager, map, undoStack, this);
 
@@ -78,9 +85,52 @@ MapView::MapView(BrushManager* brushManager, Map* map, QUndoStack* undoStack, QW
 MapView::~MapView() {
     delete inputHandler_; // MapView owns inputHandler_
     inputHandler_ = nullptr;
+    delete outfits_;
+    outfits_ = nullptr;
     // currentBrush_ is not owned by MapView.
 }
 
+void MapView::setMap(Map* map) {
+    if (map == map_ && map) {
+        return;
+    }
+    if (map_) {
+        disconnect(map_, nullptr, this, nullptr);
+    }
+    map_ = map;
+    if (map_) {
+        connect(map_, &Map::tileVisualChanged, this, &MapView::onTileVisualChanged);
+        connect(map_, &Map::dimensionsChanged, this, &MapView::updateSceneRect);
+        if (inputHandler_) {
+            inputHandler_->setMap(map_);
+        }
+    }
+    currentSelectionArea_ = QRectF(); // In the previous map's coordinates
+    updateSceneRect();
+    viewport()->update();
+}
+
+void MapView::setSpriteManager(SpriteManager* sprites) {
+    if (sprites == sprites_) {
+        return;
+    }
+    if (sprites_) {
+        disconnect(sprites_, &SpriteManager::assetsChanged, this, nullptr);
+    }
+    delete outfits_; // Its cached looks come from the previous sprites
+    outfits_ = sprites ? new OutfitCompositor(sprites) : nullptr;
+    sprites_ = sprites;
+    if (sprites_) {
+        // Looks recolored from the old sprites would otherwise be drawn until they age out.
+        connect(sprites_, &SpriteManager::assetsChanged, this, [this]() {
+            outfits_->clear();
+            viewport()->update();
+        });
+    }
+    drawingOptions_.outfits = outfits_;
+    viewport()->update();
+}
+
 // --- Interface methods for MapViewInputHandler ---
 void MapView::pan(int dx, int dy) {
     horizontalScrollBar()->setValue(horizontalScrollBar()->value() - dx);
@@ -189,6 +239,7 @@ void MapView::changeFloor(int newFloor) {
     int oldFloor = currentFloor_;
     currentFloor_ = qBound(0, newFloor, MAP_MAX_LAYERS - 1);
     if (currentFloor_ != oldFloor) {
+        drawingOptions_.currentFloor = currentFloor_;
         updateFloorStatus();
         updateAndRefreshMapCoordinates(lastMousePos_);
         scene()->invalidate(sceneRect(), QGraphicsScene::AllLayers);
@@ -359,9 +410,77 @@ void MapView::keyReleaseEvent(QKeyEvent *event) {
     }
 }
 
+void MapView::setDrawingOptions(const DrawingOptions& options) {
+    drawingOptions_ = options;
+    drawingOptions_.currentFloor = currentFloor_;
+    drawingOptions_.outfits = outfits_;
+    viewport()->update();
+}
+
+QRect MapView::visibleTileRect(const QRectF& sceneRect) const {
+    // Same scene-to-tile conversion as screenToMap().
+    const qreal floorOffset = (GROUND_LAYER - currentFloor_) * TILE_SIZE;
+    return QRect(QPoint(qFloor((sceneRect.left() + floorOffset) / TILE_SIZE), qFloor((sceneRect.top() + floorOffset) / TILE_SIZE)),
+                 QPoint(qFloor((sceneRect.right() + floorOffset) / TILE_SIZE), qFloor((sceneRect.bottom() + floorOffset) / TILE_SIZE)));
+}
+
+QRectF MapView::tileSceneRect(int x, int y) const {
+    const int floorOffset = (GROUND_LAYER - currentFloor_) * TILE_SIZE;
+    return QRectF(x * TILE_SIZE - floorOffset, y * TILE_SIZE - floorOffset, TILE_SIZE, TILE_SIZE);
+}
+
+void MapView::loadVisibleTileAreas(const QRectF& sceneRect) {
+    if (!map_ || !map_->hasPendingTileAreas()) {
+        return;
+    }
+    map_->loadTileAreas(visibleTileRect(sceneRect), currentFloor_);
+}
+
+void MapView::drawVisibleTiles(QPainter* painter, const QRectF& sceneRect) {
+    if (!map_) {
+        return;
+    }
+    // Tiles draw up and to the left of their square (tall items), so the row and column just
+    // past the exposed rect can reach into it.
+    const QRect tiles = visibleTileRect(sceneRect).adjusted(0, 0, 1, 1);
+    // Item frames of all visible tiles go through one atlas batch, so the pass costs a
+    // drawPixmapFragments call per atlas page rather than a drawPixmap per item.
+    DrawingOptions options = drawingOptions_;
+    SpriteAtlasBatch batch(sprites_ ? &sprites_->atlas() : nullptr);
+    if (sprites_ && sprites_->hasAssets()) {
+        options.sprites = sprites_;
+        options.spriteBatch = &batch;
+    }
+    map_->forEachTileIn(tiles, currentFloor_, [&](Tile* tile, int x, int y) {
+        tile->draw(painter, tileSceneRect(x, y), options);
+    });
+    batch.flush(painter);
+}
+
+void MapView::updateSceneRect() {
+    // Scene coordinates shift by a tile per floor (see screenToMap), so leave room for the
+    // highest and lowest floors on either side.
+    const int width = map_ ? map_->width() : 0;
+    const int height = map_ ? map_->height() : 0;
+    const qreal before = GROUND_LAYER * TILE_SIZE;
+    const qreal after = (MAP_MAX_LAYERS - 1 - GROUND_LAYER) * TILE_SIZE;
+    scene()->setSceneRect(-before, -before, width * TILE_SIZE + before + after, height * TILE_SIZE + before + after);
+}
+
+void MapView::onTileVisualChanged(int x, int y, int z) {
+    if (z != currentFloor_) {
+        return;
+    }
+    // Include the tile up and to the left that its items may overlap (see drawVisibleTiles).
+    const QRectF sceneRect = tileSceneRect(x, y).adjusted(-TILE_SIZE, -TILE_SIZE, 0, 0);
+    viewport()->update(mapFromScene(sceneRect).boundingRect().adjusted(-1, -1, 1, 1));
+}
+
 void MapView::drawBackground(QPainter* painter, const QRectF& rect) {
+    loadVisibleTileAreas(rect); // Decode regions of an on-demand map before anything is drawn from them
     QGraphicsView::drawBackground(painter, rect);
     painter->fillRect(rect, QColor(30, 30, 30)); // Dark gray placeholder background
+    drawVisibleTiles(painter, rect);
 }
 
 void MapView::drawForeground(QPainter *painter, const QRectF &rect) {
@@ -11,6 +11,7 @@
 #include <QEnterEvent>
 #include <QFocusEvent> // Added for focusOutEvent
 #include <QDebug>
+#include "DrawingOptions.h"
 
 // Forward declarations
 class MapViewInputHandler;
@@ -18,6 +19,8 @@ class Brush; // Added forward declaration
 class BrushManager;
 class Map;
 class QUndoStack;
+class SpriteManager;
+class OutfitCompositor;
 
 // Constants
 const int GROUND_LAYER = 7;
@@ -56,6 +59,21 @@ public:
     QPointF screenToMap(const QPoint& screenPos) const;
     QPoint mapToScreen(const QPointF& mapTilePos) const;
 
+    Map* map() const { return map_; }
+    // Shows another map (e.g. once MainWindow has loaded one). The previous map may be
+    // deleted afterwards; the view keeps no reference to it.
+    void setMap(Map* map);
+
+    // Sprites to draw the map with; without them tiles are drawn as placeholders. Not owned;
+    // items are drawn from its atlas, creature outfits through an OutfitCompositor of the view's own.
+    SpriteManager* spriteManager() const { return sprites_; }
+    void setSpriteManager(SpriteManager* sprites);
+
+    // What drawBackground renders of each visible tile (currentFloor and the sprite sources
+    // are filled in by the view).
+    const DrawingOptions& drawingOptions() const { return drawingOptions_; }
+    void setDrawingOptions(const DrawingOptions& options);
+
     // Public interface for MapViewInputHandler
     void pan(int dx, int dy);
     void zoom(qreal factor, const QPointF& centerScreenPos); // Changed center to screen pos for consistency with wheelEvent
@@ -111,6 +129,16 @@ protected:
 private:
     void changeFloor(int newFloor);
     void updateAndRefreshMapCoordinates(const QPoint& screenPos);
+    void loadVisibleTileAreas(const QRectF& sceneRect); // For maps opened with MapLoadMode::OnDemand
+
+    // The map is not made of scene items: drawBackground walks the tiles of the exposed
+    // region on the current floor (Map::forEachTileIn) and draws them directly, so a frame
+    // costs the same however large the map is.
+    QRect visibleTileRect(const QRectF& sceneRect) const; // Tiles on currentFloor_ under sceneRect, as screenToMap() sees them
+    QRectF tileSceneRect(int x, int y) const;
+    void drawVisibleTiles(QPainter* painter, const QRectF& sceneRect);
+    void updateSceneRect(); // Scroll range: the whole map on every floor
+    void onTileVisualChanged(int x, int y, int z);
 
     EditorMode currentEditorMode_ = EditorMode::Selection; // Keep private, use getter/setter
     Brush* currentBrush_ = nullptr;       // Active brush
@@ -125,8 +153,12 @@ private:
     bool switchMouseButtons_ = false;
     bool doubleClickProperties_ = true;
 
-    MapViewInputHandler* inputHandler_;
+    Map* map_ = nullptr; // Not owned
+    MapViewInputHandler* inputHandler_ = nullptr;
     QRectF currentSelectionArea_; // Added for drawing selection
+    DrawingOptions drawingOptions_;
+    SpriteManager* sprites_ = nullptr;     // Not owned
+    OutfitCompositor* outfits_ = nullptr;  // Owned; renders from sprites_
 };
 
 #endif // MAPVIEW_H
@@ -39,6 +39,16 @@ MapViewInputHandler::~MapViewInputHandler() {
     // Non-owning pointers, so no explicit deletion here
 }
 
+void MapViewInputHandler::setMap(Map* map) {
+    Q_ASSERT(map);
+    map_ = map;
+    currentMode_ = InteractionMode::Idle;
+    pressedButton_ = Qt::NoButton;
+    isDraggingDraw_ = false;
+    isReplaceDragging_ = false;
+    currentDrawingCommand_ = nullptr; // Owned by the undo stack, which goes with the old map
+}
+
 void MapViewInputHandler::updateModifierKeys(QInputEvent* event) {
     if (!event) { // Should not happen if called from an event handler
         qWarning("MapViewInputHandler::updateModifierKeys called with null event");
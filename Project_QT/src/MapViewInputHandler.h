@@ -49,6 +49,10 @@ public:
     void handleWheelEvent(QWheelEvent* event, const QPointF& mapPosition);
     void handleFocusOutEvent(QFocusEvent* event);
 
+    // Switches to another map and abandons any interaction in progress. The caller clears
+    // the undo stack, whose commands refer to the previous map.
+    void setMap(Map* map);
+
 
 private:
     void updateModifierKeys(QInputEvent* event); // Helper to update modifier states
@@ -0,0 +1,254 @@
+#include "OutfitCompositor.h"
+#include "SpriteManager.h"
+#include "Outfit.h"
+#include <QPainter>
+#include <QDebug>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OUTFITCOMPOSITOR_SSE2
+#endif
+
+namespace {
+
+// The client's outfit palette: index % 19 is the hue (0 = grey scale), index / 19 the
+// saturation/intensity step.
+QVector<QRgb> buildTemplatePalette() {
+    constexpr int HueSteps = 19;
+    constexpr int ShadeSteps = 7;
+    static const float saturation[ShadeSteps] = { 0.25f, 0.25f, 0.50f, 0.667f, 1.00f, 1.00f, 1.00f };
+    static const float intensity[ShadeSteps] = { 1.00f, 0.75f, 0.75f, 0.75f, 1.00f, 0.75f, 0.50f };
+
+    QVector<QRgb> palette(OutfitCompositor::PaletteSize);
+    for (int index = 0; index < OutfitCompositor::PaletteSize; ++index) {
+        const int hueStep = index % HueSteps;
+        if (hueStep == 0) {
+            const int grey = int((1.0f - float(index) / HueSteps / ShadeSteps) * 255);
+            palette[index] = qRgb(grey, grey, grey);
+            continue;
+        }
+        const float hue = hueStep / 18.0f;
+        const float s = saturation[index / HueSteps];
+        const float i = intensity[index / HueSteps];
+        float red = 0, green = 0, blue = 0;
+        if (hue < 1.0f / 6.0f) {
+            red = i; blue = i * (1 - s); green = blue + (i - blue) * 6 * hue;
+        } else if (hue < 2.0f / 6.0f) {
+            green = i; blue = i * (1 - s); red = green - (i - blue) * (6 * hue - 1);
+        } else if (hue < 3.0f / 6.0f) {
+            green = i; red = i * (1 - s); blue = red + (i - red) * (6 * hue - 2);
+        } else if (hue < 4.0f / 6.0f) {
+            blue = i; red = i * (1 - s); green = blue - (i - red) * (6 * hue - 3);
+        } else if (hue < 5.0f / 6.0f) {
+            blue = i; green = i * (1 - s); red = green + (i - green) * (6 * hue - 4);
+        } else {
+            red = i; green = i * (1 - s); blue = red - (i - green) * (6 * hue - 5);
+        }
+        palette[index] = qRgb(int(red * 255), int(green * 255), int(blue * 255));
+    }
+    return palette;
+}
+
+// Per channel c * m / 255, rounded to nearest; the alpha multiplier is always 255.
+inline quint32 multiplyChannels(quint32 pixel, quint32 multiplier) {
+    quint32 result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        const quint32 t = ((pixel >> shift) & 0xFF) * ((multiplier >> shift) & 0xFF) + 128;
+        result |= ((t + (t >> 8)) >> 8) << shift;
+    }
+    return result;
+}
+
+// The template color a mask pixel selects, or white (no change) for any other mask pixel.
+inline quint32 maskMultiplier(quint32 mask, const quint32 colors[4]) {
+    const bool red = mask & 0xFF0000;
+    const bool green = mask & 0x00FF00;
+    const bool blue = mask & 0x0000FF;
+    if (red && green && !blue) return colors[0];  // Yellow: head
+    if (red && !green && !blue) return colors[1]; // Body
+    if (!red && green && !blue) return colors[2]; // Legs
+    if (!red && !green && blue) return colors[3]; // Feet
+    return 0xFFFFFFFF;
+}
+
+void applyMaskScalar(quint32* base, const quint32* mask, int count, const quint32 colors[4]) {
+    for (int i = 0; i < count; ++i) {
+        const quint32 multiplier = maskMultiplier(mask[i], colors);
+        if (multiplier != 0xFFFFFFFF) {
+            base[i] = multiplyChannels(base[i], multiplier);
+        }
+    }
+}
+
+#if defined(OUTFITCOMPOSITOR_SSE2)
+// Four pixels at a time: the mask pixels are classified by which of their color bytes are
+// non-zero, the matching template colors are selected with compare masks and all four
+// channels are multiplied in 16-bit lanes.
+int applyMaskSse2(quint32* base, const quint32* mask, int count, const quint32 colors[4]) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i headPattern = _mm_set1_epi32(0x00FFFF00);
+    const __m128i bodyPattern = _mm_set1_epi32(0x00FF0000);
+    const __m128i legsPattern = _mm_set1_epi32(0x0000FF00);
+    const __m128i feetPattern = _mm_set1_epi32(0x000000FF);
+    const __m128i head = _mm_set1_epi32(int(colors[0]));
+    const __m128i body = _mm_set1_epi32(int(colors[1]));
+    const __m128i legs = _mm_set1_epi32(int(colors[2]));
+    const __m128i feet = _mm_set1_epi32(int(colors[3]));
+    const __m128i rounding = _mm_set1_epi16(128);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i m = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + i)), rgbMask);
+        const __m128i nonZero = _mm_andnot_si128(_mm_cmpeq_epi8(m, zero), rgbMask);
+        const __m128i isHead = _mm_cmpeq_epi32(nonZero, headPattern);
+        const __m128i isBody = _mm_cmpeq_epi32(nonZero, bodyPattern);
+        const __m128i isLegs = _mm_cmpeq_epi32(nonZero, legsPattern);
+        const __m128i isFeet = _mm_cmpeq_epi32(nonZero, feetPattern);
+        const __m128i selected = _mm_or_si128(_mm_or_si128(isHead, isBody), _mm_or_si128(isLegs, isFeet));
+        if (_mm_movemask_epi8(selected) == 0) {
+            continue; // No template pixels here
+        }
+        __m128i multiplier = _mm_or_si128(_mm_or_si128(_mm_and_si128(isHead, head), _mm_and_si128(isBody, body)),
+                                          _mm_or_si128(_mm_and_si128(isLegs, legs), _mm_and_si128(isFeet, feet)));
+        multiplier = _mm_or_si128(multiplier, _mm_andnot_si128(selected, _mm_set1_epi32(-1)));
+
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(base + i));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), _mm_unpacklo_epi8(multiplier, zero)), rounding);
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), _mm_unpackhi_epi8(multiplier, zero)), rounding);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(base + i), _mm_packus_epi16(lo, hi));
+    }
+    return i;
+}
+#endif
+
+} // namespace
+
+OutfitCompositor::OutfitCompositor(SpriteManager* sprites) :
+    sprites_(sprites),
+    cache_(DefaultCacheBudget)
+{
+}
+
+QRgb OutfitCompositor::templateColor(int index) {
+    static const QVector<QRgb> palette = buildTemplatePalette();
+    return palette.at(index >= 0 && index < PaletteSize ? index : 0);
+}
+
+quint64 OutfitCompositor::lookKey(const Outfit& outfit, int direction, int frame) {
+    return (quint64(outfit.lookType & 0xFFFF) << 44) |
+           (quint64(outfit.lookHead & 0xFF) << 36) |
+           (quint64(outfit.lookBody & 0xFF) << 28) |
+           (quint64(outfit.lookLegs & 0xFF) << 20) |
+           (quint64(outfit.lookFeet & 0xFF) << 12) |
+           (quint64(outfit.lookAddon & 0x3) << 10) |
+           (quint64(direction & 0x3) << 8) |
+           quint64(frame & 0xFF);
+}
+
+void OutfitCompositor::applyTemplateMask(QImage& base, const QImage& mask, QRgb head, QRgb body, QRgb legs, QRgb feet) {
+    if (base.size() != mask.size() || base.format() != QImage::Format_ARGB32_Premultiplied ||
+        mask.format() != QImage::Format_ARGB32_Premultiplied) {
+        qWarning() << "OutfitCompositor::applyTemplateMask - Base and mask differ in size or format.";
+        return;
+    }
+    // Opaque colors, so the alpha channel is multiplied by 255 and stays as it is.
+    const quint32 colors[4] = { head | 0xFF000000u, body | 0xFF000000u, legs | 0xFF000000u, feet | 0xFF000000u };
+    const int width = base.width();
+    for (int y = 0; y < base.height(); ++y) {
+        quint32* baseLine = reinterpret_cast<quint32*>(base.scanLine(y));
+        const quint32* maskLine = reinterpret_cast<const quint32*>(mask.constScanLine(y));
+        int done = 0;
+#if defined(OUTFITCOMPOSITOR_SSE2)
+        done = applyMaskSse2(baseLine, maskLine, width, colors);
+#endif
+        applyMaskScalar(baseLine + done, maskLine + done, width - done, colors);
+    }
+}
+
+QImage OutfitCompositor::outfitImage(const Outfit& outfit, int direction, int frame) {
+    if (!sprites_ || outfit.lookType <= 0) {
+        return QImage();
+    }
+    // Outfits are numbered from 1 in looks and from OutfitIdBase in the DAT table.
+    const int slot = sprites_->gameSpriteSlot(SpriteManager::OutfitIdBase + quint32(outfit.lookType - 1));
+    const GameSpriteTable& table = sprites_->gameSprites();
+    if (slot < 0 || slot >= table.size()) {
+        return QImage();
+    }
+
+    // Wrap like getFrameImage does, so equivalent requests share a cache entry.
+    const int directions = qMax<int>(table.patternX[slot], 1);
+    const int frames = qMax<int>(table.frames[slot], 1);
+    direction = ((direction % directions) + directions) % directions;
+    frame = ((frame % frames) + frames) % frames;
+
+    const quint64 key = lookKey(outfit, direction, frame);
+    if (const QImage* cached = cache_.object(key)) {
+        ++cacheHits_;
+        return *cached;
+    }
+    ++cacheMisses_;
+
+    const QImage image = renderOutfit(outfit, direction, frame);
+    if (!image.isNull()) {
+        cache_.insert(key, new QImage(image), image.sizeInBytes());
+    }
+    return image;
+}
+
+QImage OutfitCompositor::renderOutfit(const Outfit& outfit, int direction, int frame) {
+    const quint32 gameSpriteId = SpriteManager::OutfitIdBase + quint32(outfit.lookType - 1);
+    const GameSpriteTable& table = sprites_->gameSprites();
+    const int slot = sprites_->gameSpriteSlot(gameSpriteId);
+    const bool hasMask = table.layers[slot] >= 2;
+    const int addonPatterns = qMax<int>(table.patternY[slot], 1);
+    const QRgb head = templateColor(outfit.lookHead);
+    const QRgb body = templateColor(outfit.lookBody);
+    const QRgb legs = templateColor(outfit.lookLegs);
+    const QRgb feet = templateColor(outfit.lookFeet);
+
+    // patternY 0 is the base outfit and patternY n the n-th addon (lookAddon bit n - 1);
+    // mounts (patternZ) are not drawn here.
+    QImage result;
+    QPainter painter;
+    for (int addon = 0; addon < addonPatterns; ++addon) {
+        if (addon > 0 && !(outfit.lookAddon & (1 << (addon - 1)))) {
+            continue;
+        }
+        QImage part = sprites_->getFrameImage(gameSpriteId, frame, direction, addon, 0, 0);
+        if (part.isNull()) {
+            continue;
+        }
+        if (hasMask) {
+            const QImage mask = sprites_->getFrameImage(gameSpriteId, frame, direction, addon, 0, 1);
+            if (!mask.isNull()) {
+                applyTemplateMask(part, mask, head, body, legs, feet); // Detaches part from the sprite caches
+            }
+        }
+        if (result.isNull()) {
+            result = part;
+            continue;
+        }
+        if (!painter.isActive()) {
+            painter.begin(&result);
+        }
+        painter.drawImage(0, 0, part);
+    }
+    if (painter.isActive()) {
+        painter.end();
+    }
+    return result;
+}
+
+void OutfitCompositor::setCacheBudget(qint64 bytes) {
+    cache_.setMaxCost(qMax<qint64>(bytes, 0));
+}
+
+void OutfitCompositor::clear() {
+    cache_.clear();
+    cacheHits_ = 0;
+    cacheMisses_ = 0;
+}
@@ -0,0 +1,56 @@
+#ifndef OUTFITCOMPOSITOR_H
+#define OUTFITCOMPOSITOR_H
+
+#include <QImage>
+#include <QCache>
+#include <QRgb>
+
+class SpriteManager;
+struct Outfit;
+
+// Renders creature outfits from the DAT/SPR data in SpriteManager: each outfit sprite's
+// template mask (its second layer) recolors the first layer with the look's head, body, legs
+// and feet colors, and the chosen addons are drawn over the base outfit.
+//
+// Finished looks are kept in an LRU cache keyed by lookKey(), a packed integer of everything
+// that affects the image, so every creature with the same look shares one QImage and a
+// screen full of spawns is recolored once per distinct look. The cache does not notice the
+// SpriteManager loading other assets; call clear() on SpriteManager::assetsChanged (MapView
+// does for its compositor).
+class OutfitCompositor {
+public:
+    static constexpr int PaletteSize = 133; // 19 hues x 7 shades; look colors index into it
+    static constexpr qint64 DefaultCacheBudget = 16 * 1024 * 1024;
+
+    enum Direction { North = 0, East = 1, South = 2, West = 3 }; // The outfit's patternX
+
+    explicit OutfitCompositor(SpriteManager* sprites);
+
+    // Null image if the look type has no DAT entry.
+    QImage outfitImage(const Outfit& outfit, int direction = South, int frame = 0);
+
+    // lookType (16 bits), the four colors (8 bits each), addons (2), direction (2), frame (8).
+    static quint64 lookKey(const Outfit& outfit, int direction, int frame);
+    static QRgb templateColor(int index); // Out-of-range indices give color 0
+
+    // Multiplies every pixel of base whose mask pixel is yellow, red, green or blue by the
+    // head, body, legs or feet color. Both images must be ARGB32_Premultiplied and the
+    // same size; the rest of base is left as it is.
+    static void applyTemplateMask(QImage& base, const QImage& mask, QRgb head, QRgb body, QRgb legs, QRgb feet);
+
+    void setCacheBudget(qint64 bytes);
+    qint64 cacheBudget() const { return cache_.maxCost(); }
+    quint64 cacheHits() const { return cacheHits_; }
+    quint64 cacheMisses() const { return cacheMisses_; }
+    void clear();
+
+private:
+    QImage renderOutfit(const Outfit& outfit, int direction, int frame);
+
+    SpriteManager* sprites_;
+    QCache<quint64, QImage> cache_; // Rendered looks by lookKey(), cost = image bytes
+    quint64 cacheHits_ = 0;
+    quint64 cacheMisses_ = 0;
+};
+
+#endif // OUTFITCOMPOSITOR_H
@@ -0,0 +1,127 @@
+#include "SpriteAtlas.h"
+#include <QDebug>
+
+SpriteAtlas::Entry SpriteAtlas::insert(quint64 key, const QImage& image) {
+    const auto existing = entries_.constFind(key);
+    if (existing != entries_.constEnd()) {
+        return existing.value();
+    }
+    if (image.isNull()) {
+        return Entry();
+    }
+    const QSize size(image.width() + Gutter, image.height() + Gutter);
+    if (size.width() > PageWidth || size.height() > MaxPageHeight) {
+        qWarning() << "SpriteAtlas::insert - Image of" << image.size() << "does not fit an atlas page.";
+        return Entry();
+    }
+
+    // Older pages first: they may still have room on a shelf of the right height.
+    QPoint position;
+    int pageIndex = 0;
+    while (pageIndex < pages_.size() && !allocate(pages_[pageIndex], size, position)) {
+        ++pageIndex;
+    }
+    if (pageIndex == pages_.size()) {
+        Page page;
+        page.pixmap = QPixmap(PageWidth, InitialPageHeight);
+        page.pixmap.fill(Qt::transparent);
+        pages_.append(page);
+        allocate(pages_[pageIndex], size, position);
+    }
+
+    QPainter painter(&pages_[pageIndex].pixmap);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.drawImage(position, image);
+    painter.end();
+
+    Entry entry;
+    entry.page = pageIndex;
+    entry.rect = QRect(position, image.size());
+    entries_.insert(key, entry);
+    return entry;
+}
+
+bool SpriteAtlas::allocate(Page& page, const QSize& size, QPoint& position) {
+    // The shelf with the least height to spare that still has room.
+    Shelf* best = nullptr;
+    for (Shelf& shelf : page.shelves) {
+        if (shelf.height >= size.height() && PageWidth - shelf.usedWidth >= size.width() &&
+            (!best || shelf.height < best->height)) {
+            best = &shelf;
+        }
+    }
+    // A much taller shelf would waste most of its height; open a fitting one if there is space.
+    if (best && best->height > size.height() * 2 && page.usedHeight + size.height() <= MaxPageHeight) {
+        best = nullptr;
+    }
+    if (!best) {
+        if (page.usedHeight + size.height() > MaxPageHeight) {
+            return false;
+        }
+        if (page.usedHeight + size.height() > page.pixmap.height()) {
+            growPage(page, page.usedHeight + size.height());
+        }
+        Shelf shelf;
+        shelf.y = page.usedHeight;
+        shelf.height = size.height();
+        page.shelves.append(shelf);
+        page.usedHeight += size.height();
+        best = &page.shelves.last();
+    }
+    position = QPoint(best->usedWidth, best->y);
+    best->usedWidth += size.width();
+    return true;
+}
+
+void SpriteAtlas::growPage(Page& page, int minimumHeight) {
+    int height = page.pixmap.height();
+    while (height < minimumHeight) {
+        height *= 2;
+    }
+    QPixmap grown(PageWidth, qMin(height, int(MaxPageHeight)));
+    grown.fill(Qt::transparent);
+    QPainter painter(&grown);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.drawPixmap(0, 0, page.pixmap);
+    painter.end();
+    page.pixmap = grown;
+}
+
+void SpriteAtlas::clear() {
+    pages_.clear();
+    entries_.clear();
+}
+
+SpriteAtlasBatch::SpriteAtlasBatch(const SpriteAtlas* atlas) :
+    atlas_(atlas)
+{
+}
+
+void SpriteAtlasBatch::add(const SpriteAtlas::Entry& entry, const QPointF& topLeft, qreal scale, qreal opacity) {
+    if (!entry.isValid()) {
+        return;
+    }
+    if (runCount_ == 0 || runs_[runCount_ - 1].page != entry.page) {
+        if (runCount_ == runs_.size()) {
+            runs_.append(Run());
+        }
+        runs_[runCount_].page = entry.page;
+        runs_[runCount_].fragments.clear(); // Keeps its capacity
+        ++runCount_;
+    }
+    // Fragments are positioned by their center.
+    const QPointF center = topLeft + QPointF(entry.rect.width() * scale / 2, entry.rect.height() * scale / 2);
+    runs_[runCount_ - 1].fragments.append(QPainter::PixmapFragment::create(center, QRectF(entry.rect), scale, scale, 0, opacity));
+    ++fragmentCount_;
+}
+
+void SpriteAtlasBatch::flush(QPainter* painter) {
+    if (painter && atlas_) {
+        for (int run = 0; run < runCount_; ++run) {
+            const Run& batch = runs_.at(run);
+            painter->drawPixmapFragments(batch.fragments.constData(), batch.fragments.size(), atlas_->page(batch.page));
+        }
+    }
+    runCount_ = 0;
+    fragmentCount_ = 0;
+}
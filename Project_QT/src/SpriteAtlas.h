@@ -0,0 +1,89 @@
+#ifndef SPRITEATLAS_H
+#define SPRITEATLAS_H
+
+#include <QPixmap>
+#include <QImage>
+#include <QHash>
+#include <QVector>
+#include <QRect>
+#include <QPainter>
+
+// Decoded sprites packed into a few large pixmap pages, so a whole view can be drawn with
+// one QPainter::drawPixmapFragments call per run of sprites on the same page instead of one
+// drawPixmap per sprite (see SpriteAtlasBatch).
+//
+// Pages are PageWidth wide and packed in shelves: a sprite goes on the open shelf of the
+// closest height that still has room, otherwise a new shelf is opened below the last one.
+// A page starts InitialPageHeight high and doubles (copying what it holds) up to
+// MaxPageHeight before a new page is started. Sprites are never evicted; clear() drops
+// everything. Pages are QPixmaps, so the atlas belongs to the GUI thread.
+class SpriteAtlas {
+public:
+    static constexpr int PageWidth = 2048;
+    static constexpr int InitialPageHeight = 256;
+    static constexpr int MaxPageHeight = 2048;
+    static constexpr int Gutter = 1; // Transparent pixels between sprites, against bleeding when scaled
+
+    struct Entry {
+        int page = -1;
+        QRect rect; // Within the page
+        bool isValid() const { return page >= 0; }
+    };
+
+    // Invalid entry if key has not been added.
+    Entry find(quint64 key) const { return entries_.value(key); }
+    // Packs image under key and returns where it went, or the existing entry for key. Returns
+    // an invalid entry for null images and images too big for a page.
+    Entry insert(quint64 key, const QImage& image);
+
+    int pageCount() const { return pages_.size(); }
+    const QPixmap& page(int index) const { return pages_.at(index).pixmap; }
+    int entryCount() const { return entries_.size(); }
+    void clear();
+
+private:
+    struct Shelf {
+        int y = 0;
+        int height = 0;
+        int usedWidth = 0;
+    };
+    struct Page {
+        QPixmap pixmap;
+        QVector<Shelf> shelves;
+        int usedHeight = 0; // Bottom of the last shelf
+    };
+
+    static bool allocate(Page& page, const QSize& size, QPoint& position);
+    static void growPage(Page& page, int minimumHeight);
+
+    QVector<Page> pages_;
+    QHash<quint64, Entry> entries_;
+};
+
+// Collects atlas sprites to draw and issues them as drawPixmapFragments batches. Sprites
+// are drawn in the order they were added: consecutive sprites on the same page form one
+// batch, so drawing order (and thus stacking) is the same as with one drawPixmap each.
+class SpriteAtlasBatch {
+public:
+    explicit SpriteAtlasBatch(const SpriteAtlas* atlas);
+
+    void add(const SpriteAtlas::Entry& entry, const QPointF& topLeft, qreal scale = 1.0, qreal opacity = 1.0);
+    // Draws everything added since the last flush and empties the batch.
+    void flush(QPainter* painter);
+
+    int fragmentCount() const { return fragmentCount_; }
+    int batchCount() const { return runCount_; }
+
+private:
+    struct Run {
+        int page = -1;
+        QVector<QPainter::PixmapFragment> fragments;
+    };
+
+    const SpriteAtlas* atlas_;
+    QVector<Run> runs_;
+    int runCount_ = 0; // runs_ entries in use; the rest keep their capacity for the next frame
+    int fragmentCount_ = 0;
+};
+
+#endif // SPRITEATLAS_H
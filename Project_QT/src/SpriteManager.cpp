@@ -1,12 +1,16 @@
 #include "SpriteManager.h"
+#include "SpriteRleDecoder.h"
 #include <QFile>
 #include <QDataStream>
+#include <QPainter>
 #include <QDebug>
 
 // Constructor
 SpriteManager::SpriteManager(QObject* parent)
     : QObject(parent),
       assetsLoaded_(false),
+      spriteImageCache_(DefaultSpriteCacheBudget),
+      frameImageCache_(DefaultFrameCacheBudget),
       sprSignature_(0),
       sprSpriteCount_(0),
       datSignature_(0),
@@ -23,9 +27,19 @@ SpriteManager::~SpriteManager() {
 
 // Unload Assets
 void SpriteManager::unloadAssets() {
-    gameSpriteMetadataCache_.clear();
-    sprSheetRleDataCache_.clear();
+    const bool wasLoaded = assetsLoaded_;
+    gameSprites_.clear();
     sprSheetAddresses_.clear();
+    spriteImageCache_.clear();
+    frameImageCache_.clear();
+    atlas_.clear();
+    if (sprData_ && sprContents_.isEmpty()) {
+        sprFile_.unmap(const_cast<uchar*>(sprData_));
+    }
+    sprData_ = nullptr;
+    sprSize_ = 0;
+    sprContents_.clear();
+    sprFile_.close();
     assetsLoaded_ = false;
 
     sprSignature_ = 0;
@@ -37,6 +51,9 @@ void SpriteManager::unloadAssets() {
     datMissileCount_ = 0;
 
     qDebug() << "SpriteManager: Assets unloaded.";
+    if (wasLoaded) {
+        emit assetsChanged();
+    }
 }
 
 // Load Assets Shell
@@ -71,25 +88,25 @@ bool SpriteManager::loadAssets(const ClientVersionData& clientVersion, QString&
     datFile.close();
     qDebug() << "SpriteManager: DAT file parsed successfully.";
 
-    // Open and parse SPR file
-    QFile sprFile(versionData_.sprPath);
-    if (!sprFile.open(QIODevice::ReadOnly)) {
+    // Open and parse SPR file. It stays open: sprite data is read from its mapping on demand.
+    sprFile_.setFileName(versionData_.sprPath);
+    if (!sprFile_.open(QIODevice::ReadOnly)) {
         error = QString("Failed to open SPR file: %1").arg(versionData_.sprPath);
         qCritical() << "SpriteManager:" << error;
         return false;
     }
     qDebug() << "SpriteManager: SPR file opened successfully.";
-    if (!parseSprFile(sprFile, error)) {
-        sprFile.close();
-        // error string is set by parseSprFile or parseSprHeader
+    if (!parseSprFile(sprFile_, error) || !mapSprFile(error)) {
+        // error string is set by parseSprFile, parseSprHeader or mapSprFile
         qCritical() << "SpriteManager: Failed to parse SPR file:" << error;
+        unloadAssets();
         return false;
     }
-    sprFile.close();
     qDebug() << "SpriteManager: SPR file parsed successfully.";
 
     assetsLoaded_ = true;
     qInfo() << "SpriteManager: Assets loaded successfully for client version" << versionData_.clientVersionNumber;
+    emit assetsChanged();
     return true;
 }
 
@@ -117,17 +134,20 @@ bool SpriteManager::parseDatFile(QFile& file, QString& error, QStringList& warni
 bool SpriteManager::loadDatContents(QDataStream& stream, QString& error, QStringList& warnings) {
     qDebug() << "SpriteManager: Starting to load DAT contents...";
     quint32 datEntriesRead = 0;
+    const int entryCount = datItemCount_ + datOutfitCount_ + datEffectCount_ + datMissileCount_;
+    gameSprites_.clear();
+    gameSprites_.reserve(entryCount, entryCount * 2); // Most entries are a single unanimated sprite or two
 
     // Items (Client IDs typically start from 100)
     // The DAT file lists items sequentially starting from the first item (often ID 100).
     for (quint16 i = 0; i < datItemCount_; ++i) {
-        quint32 clientItemId = 100 + i;
+        quint32 clientItemId = ItemIdBase + i;
         if (stream.atEnd()) {
             error = QString("Unexpected end of DAT file while reading item %1 (Client ID: %2). Expected %3 items.")
                         .arg(i).arg(clientItemId).arg(datItemCount_);
             return false;
         }
-        if (!readDatEntry(stream, clientItemId, error, warnings)) {
+        if (!appendDatEntry(stream, clientItemId, error, warnings)) {
             // readDatEntry sets the error, but we add context
             warnings.append(QString("Error reading DAT entry for item (sequential index %1, clientID %2): %3")
                                 .arg(datEntriesRead).arg(clientItemId).arg(error));
@@ -139,33 +159,17 @@ bool SpriteManager::loadDatContents(QDataStream& stream, QString& error, QString
     qDebug() << "SpriteManager: Finished reading" << datItemCount_ << "item entries.";
 
     // Outfits (Creatures)
-    // These follow items in the .dat file. Their client-side identification might be more complex
-    // (e.g., not simple sequential IDs, or might overlap with item ID space if not careful).
-    // For RME internal representation, a distinct ID range is often used.
-    // The prompt suggested a placeholder scheme: datItemCount_ + 100 + i
-    // Let's assume a base ID for outfits for now, e.g., 20000, or just use a sequential internal one.
-    // For simplicity in this step, let's use a gameSpriteId that is just a continuation,
-    // but acknowledge this needs proper mapping for a real editor.
-    // Let's use a distinct range for cache key, e.g. outfits start after items using a large offset.
-    // For now, using the sequential approach and the cache key will be this sequential id.
-    // This means getGameSpriteData will need to know how to map game types to these ranges.
-    // This mapping is complex and outside this subtask's scope.
-    // For now, just read sequentially. The gameSpriteId passed to readDatEntry will be this sequential one.
-
-    quint32 outfitStartId = 1; // This is an internal sequential ID for outfits, not client ID
+    // These follow items in the .dat file. Their client-side identification is not a simple
+    // continuation of the item ids, so they get an id range of their own (OutfitIdBase).
     for (quint16 i = 0; i < datOutfitCount_; ++i) {
-        // The key for gameSpriteMetadataCache_ needs to be unique across types.
-        // A common way is to use a type prefix or large offset.
-        // E.g. items 100-19999, outfits 20000-29999 etc.
-        // For this generic loader, let's pass the sequential index + type offset as gameSpriteId.
-        // This ID is for caching, specific game logic will map game IDs to these.
-        quint32 cacheKeyForOutfit = 20000 + outfitStartId + i; // Example offset
+        // Each kind has its own id range (see gameSpriteSlot); game logic maps its ids to these.
+        quint32 cacheKeyForOutfit = OutfitIdBase + i;
         if (stream.atEnd()) {
             error = QString("Unexpected end of DAT file while reading outfit %1. Expected %2 outfits.")
                         .arg(i).arg(datOutfitCount_);
             return false;
         }
-        if (!readDatEntry(stream, cacheKeyForOutfit, error, warnings)) {
+        if (!appendDatEntry(stream, cacheKeyForOutfit, error, warnings)) {
             warnings.append(QString("Error reading DAT entry for outfit (sequential index %1, cache key %2): %3")
                                 .arg(datEntriesRead).arg(cacheKeyForOutfit).arg(error));
         }
@@ -174,15 +178,14 @@ bool SpriteManager::loadDatContents(QDataStream& stream, QString& error, QString
     qDebug() << "SpriteManager: Finished reading" << datOutfitCount_ << "outfit entries.";
 
     // Effects
-    quint32 effectStartId = 1;
     for (quint16 i = 0; i < datEffectCount_; ++i) {
-        quint32 cacheKeyForEffect = 30000 + effectStartId + i; // Example offset
+        quint32 cacheKeyForEffect = EffectIdBase + i;
          if (stream.atEnd()) {
             error = QString("Unexpected end of DAT file while reading effect %1. Expected %2 effects.")
                         .arg(i).arg(datEffectCount_);
             return false;
         }
-        if (!readDatEntry(stream, cacheKeyForEffect, error, warnings)) {
+        if (!appendDatEntry(stream, cacheKeyForEffect, error, warnings)) {
              warnings.append(QString("Error reading DAT entry for effect (sequential index %1, cache key %2): %3")
                                 .arg(datEntriesRead).arg(cacheKeyForEffect).arg(error));
         }
@@ -191,15 +194,14 @@ bool SpriteManager::loadDatContents(QDataStream& stream, QString& error, QString
     qDebug() << "SpriteManager: Finished reading" << datEffectCount_ << "effect entries.";
 
     // Missiles (Distances)
-    quint32 missileStartId = 1;
     for (quint16 i = 0; i < datMissileCount_; ++i) {
-        quint32 cacheKeyForMissile = 40000 + missileStartId + i; // Example offset
+        quint32 cacheKeyForMissile = MissileIdBase + i;
         if (stream.atEnd()) {
             error = QString("Unexpected end of DAT file while reading missile %1. Expected %2 missiles.")
                         .arg(i).arg(datMissileCount_);
             return false;
         }
-        if (!readDatEntry(stream, cacheKeyForMissile, error, warnings)) {
+        if (!appendDatEntry(stream, cacheKeyForMissile, error, warnings)) {
             warnings.append(QString("Error reading DAT entry for missile (sequential index %1, cache key %2): %3")
                                 .arg(datEntriesRead).arg(cacheKeyForMissile).arg(error));
         }
@@ -207,6 +209,7 @@ bool SpriteManager::loadDatContents(QDataStream& stream, QString& error, QString
     }
     qDebug() << "SpriteManager: Finished reading" << datMissileCount_ << "missile entries.";
     qDebug() << "SpriteManager: Total DAT entries processed:" << datEntriesRead;
+    gameSprites_.squeeze();
 
     return true;
 }
@@ -275,9 +278,8 @@ bool SpriteManager::parseSprHeader(QDataStream& stream, QString& error) {
         return false;
     }
 
-    sprSheetAddresses_.reserve(sprSpriteCount_); // Pre-allocate for efficiency
-    // Sprite IDs are 1-based in typical usage, but addresses are stored per sprite.
-    // The map can use 0 to N-1 or 1 to N. Let's use 1 to N for consistency with game IDs.
+    // Sprite IDs are 1-based, so the table is indexed by ID and slot 0 stays empty.
+    sprSheetAddresses_.fill(0, sprSpriteCount_ + 1);
     for (quint32 i = 1; i <= sprSpriteCount_; ++i) {
         quint32 spriteAddress;
         stream >> spriteAddress;
@@ -286,21 +288,41 @@ bool SpriteManager::parseSprHeader(QDataStream& stream, QString& error) {
             // Or, could skip and handle lookups for missing IDs as transparent.
             // For now, store as is.
         }
-        sprSheetAddresses_.insert(i, spriteAddress);
+        sprSheetAddresses_[i] = spriteAddress;
         if (stream.atEnd() && i < sprSpriteCount_) {
              error = QString("SPR file ended prematurely while reading sprite addresses. Read %1 of %2.").arg(i).arg(sprSpriteCount_);
              return false;
         }
     }
 
-    qDebug() << "SpriteManager: Read" << sprSheetAddresses_.size() << "sprite addresses from SPR header.";
-    if (sprSheetAddresses_.size() != sprSpriteCount_) {
-        // This case should be caught by stream.atEnd() above, but as a safeguard:
-        error = QString("Mismatch between sprite count and addresses read. Count: %1, Addresses: %2")
-                    .arg(sprSpriteCount_).arg(sprSheetAddresses_.size());
+    if (stream.status() != QDataStream::Ok) {
+        error = QString("Failed to read sprite addresses from SPR header.");
         return false;
     }
+    qDebug() << "SpriteManager: Read" << sprSpriteCount_ << "sprite addresses from SPR header.";
+
+    return true;
+}
 
+// Map the whole SPR file; it stays mapped until unloadAssets().
+bool SpriteManager::mapSprFile(QString& error) {
+    sprSize_ = sprFile_.size();
+    sprData_ = sprSize_ > 0 ? sprFile_.map(0, sprSize_) : nullptr;
+    if (!sprData_) {
+        // Some file systems cannot be mapped; keep the contents in memory instead.
+        qWarning() << "SpriteManager: Could not map SPR file, reading it into memory:" << sprFile_.errorString();
+        if (!sprFile_.seek(0)) {
+            error = QString("Failed to read SPR file: %1").arg(versionData_.sprPath);
+            return false;
+        }
+        sprContents_ = sprFile_.readAll();
+        if (sprContents_.size() != sprSize_) {
+            error = QString("Failed to read SPR file: %1").arg(versionData_.sprPath);
+            sprContents_.clear();
+            return false;
+        }
+        sprData_ = reinterpret_cast<const uchar*>(sprContents_.constData());
+    }
     return true;
 }
 
@@ -312,35 +334,110 @@ quint16 SpriteManager::getEffectCount() const { return datEffectCount_; }
 quint16 SpriteManager::getMissileCount() const { return datMissileCount_; }
 const ClientVersionData* SpriteManager::getCurrentVersionData() const { return &versionData_; }
 
-// Stubs for methods to be implemented in later parts
-QSharedPointer<const GameSpriteData> SpriteManager::getGameSpriteData(quint32 gameSpriteId) const {
-    Q_UNUSED(gameSpriteId);
-    // To be implemented in Part 2 (DAT content parsing)
-    // return gameSpriteMetadataCache_.value(gameSpriteId, nullptr);
-    return nullptr;
+// --- Decoded Sprite Cache ---
+void SpriteManager::setSpriteCacheBudget(qint64 bytes) {
+    spriteImageCache_.setMaxCost(qMax<qint64>(bytes, 0)); // Evicts least recently used sprites if shrunk
 }
 
-QImage SpriteManager::getSpriteImage(quint32 actualSprId) {
-    Q_UNUSED(actualSprId);
-    // To be implemented in Part 3 (SPR reading and RLE decoding)
-    return QImage();
+void SpriteManager::resetSpriteCacheCounters() {
+    spriteCacheHits_ = 0;
+    spriteCacheMisses_ = 0;
 }
 
-QImage SpriteManager::getFrameImage(quint32 gameSpriteId, int frame, int patternX, int patternY, int patternZ, int layer) {
-    Q_UNUSED(gameSpriteId);
-    Q_UNUSED(frame);
-    Q_UNUSED(patternX);
-    Q_UNUSED(patternY);
-    Q_UNUSED(patternZ);
-    Q_UNUSED(layer);
-    // To be implemented in Part 3 or 4 (Frame composition)
-    return QImage();
+void SpriteManager::setFrameCacheBudget(qint64 bytes) {
+    frameImageCache_.setMaxCost(qMax<qint64>(bytes, 0));
+}
+
+QImage SpriteManager::transparentSprite() {
+    static const QImage image = [] {
+        QImage transparent(32, 32, QImage::Format_ARGB32_Premultiplied);
+        transparent.fill(Qt::transparent);
+        return transparent;
+    }();
+    return image; // Implicitly shared
+}
+
+// --- GameSpriteTable ---
+void GameSpriteTable::append(const Entry& entry) {
+    flags.append(entry.flags.toInt());
+    width.append(entry.width);
+    height.append(entry.height);
+    layers.append(entry.layers);
+    patternX.append(entry.patternX);
+    patternY.append(entry.patternY);
+    patternZ.append(entry.patternZ);
+    frames.append(entry.frames);
+    drawOffsetX.append(entry.drawOffsetX);
+    drawOffsetY.append(entry.drawOffsetY);
+    drawHeight.append(entry.drawHeight);
+    minimapColor.append(entry.minimapColor);
+    lightIntensity.append(entry.lightIntensity);
+    lightColor.append(entry.lightColor);
+    animationLoopCount.append(entry.animationLoopCount);
+    animationStartFrame.append(entry.animationStartFrame);
+    spriteBegin.append(static_cast<quint32>(spriteIds.size()));
+    frameDurationBegin.append(static_cast<quint32>(frameDurations.size()));
+}
+
+void GameSpriteTable::discardPending() {
+    spriteIds.resize(spriteBegin.last());
+    frameDurations.resize(frameDurationBegin.last());
+}
+
+void GameSpriteTable::reserve(int entryCount, int spriteIdCount) {
+    for (QVector<quint8>* column : { &width, &height, &layers, &patternX, &patternY, &patternZ, &frames, &lightIntensity, &lightColor }) {
+        column->reserve(entryCount);
+    }
+    for (QVector<quint16>* column : { &drawHeight, &minimapColor }) {
+        column->reserve(entryCount);
+    }
+    flags.reserve(entryCount);
+    drawOffsetX.reserve(entryCount);
+    drawOffsetY.reserve(entryCount);
+    animationLoopCount.reserve(entryCount);
+    animationStartFrame.reserve(entryCount);
+    spriteBegin.reserve(entryCount + 1);
+    frameDurationBegin.reserve(entryCount + 1);
+    spriteIds.reserve(spriteIdCount);
+}
+
+void GameSpriteTable::squeeze() {
+    for (QVector<quint8>* column : { &width, &height, &layers, &patternX, &patternY, &patternZ, &frames, &lightIntensity, &lightColor }) {
+        column->squeeze();
+    }
+    for (QVector<quint16>* column : { &drawHeight, &minimapColor }) {
+        column->squeeze();
+    }
+    flags.squeeze();
+    drawOffsetX.squeeze();
+    drawOffsetY.squeeze();
+    animationLoopCount.squeeze();
+    animationStartFrame.squeeze();
+    spriteBegin.squeeze();
+    frameDurationBegin.squeeze();
+    spriteIds.squeeze();
+    frameDurations.squeeze();
+}
+
+void GameSpriteTable::clear() {
+    *this = GameSpriteTable();
+}
+
+// Read one DAT entry into the next slot of gameSprites_. A slot is added even if the entry
+// is unreadable, so slots stay in step with the DAT order.
+bool SpriteManager::appendDatEntry(QDataStream& stream, quint32 gameSpriteId, QString& error, QStringList& warnings) {
+    GameSpriteTable::Entry entry;
+    const bool ok = readDatEntry(stream, gameSpriteId, entry, error, warnings);
+    if (!ok) {
+        gameSprites_.discardPending();
+        entry = GameSpriteTable::Entry();
+    }
+    gameSprites_.append(entry);
+    return ok;
 }
 
-// Placeholder for readDatEntry, will be implemented in Part 2 (actually, implementing now)
-bool SpriteManager::readDatEntry(QDataStream& stream, quint32 gameSpriteId, QString& error, QStringList& warnings) {
-    QSharedPointer<GameSpriteData> spriteData = QSharedPointer<GameSpriteData>(new GameSpriteData());
-    spriteData->id = gameSpriteId;
+// Read one DAT entry; its sprite ids and frame durations go straight to the table's pools.
+bool SpriteManager::readDatEntry(QDataStream& stream, quint32 gameSpriteId, GameSpriteTable::Entry& entry, QString& error, QStringList& warnings) {
 
     quint8 flag_value;
     forever {
@@ -352,86 +449,86 @@ bool SpriteManager::readDatEntry(QDataStream& stream, quint32 gameSpriteId, QStr
         // This switch is based on common DAT flags. Specific client versions might vary.
         // The values (cases) are from common Tibia .dat specifications.
         switch (flag_value) {
-            case 0: spriteData->flags |= SpriteDatFlags::Ground;
+            case 0: entry.flags |= SpriteDatFlags::Ground;
                     if(versionData_.datFormat >= DatFormat::Format_755) { // Ground speed is part of ground flag in 7.55+
-                         quint16 groundSpeed; stream >> groundSpeed; /* store if needed, e.g. spriteData->groundSpeed = groundSpeed; */
+                         quint16 groundSpeed; stream >> groundSpeed; /* store if needed, e.g. entry.groundSpeed = groundSpeed; */
                          if (stream.atEnd()) { error = "Unexpected end of stream after ground speed flag for " + QString::number(gameSpriteId); return false; }
                     }
                     break;
-            case 1: spriteData->flags |= SpriteDatFlags::GroundBorder; break; // Clip / Ground Border
-            case 2: spriteData->flags |= SpriteDatFlags::OnBottom; break;     // OnBottom / DrawOnTop (depends on interpretation)
-            case 3: spriteData->flags |= SpriteDatFlags::OnTop; break;        // OnTop / DrawOnBottom
-            case 4: spriteData->flags |= SpriteDatFlags::Container; break;
-            case 5: spriteData->flags |= SpriteDatFlags::Stackable; break;
-            case 6: spriteData->flags |= SpriteDatFlags::ForceUse; break; // Corpse / ForceUse
-            case 7: spriteData->flags |= SpriteDatFlags::MultiUse; break;
+            case 1: entry.flags |= SpriteDatFlags::GroundBorder; break; // Clip / Ground Border
+            case 2: entry.flags |= SpriteDatFlags::OnBottom; break;     // OnBottom / DrawOnTop (depends on interpretation)
+            case 3: entry.flags |= SpriteDatFlags::OnTop; break;        // OnTop / DrawOnBottom
+            case 4: entry.flags |= SpriteDatFlags::Container; break;
+            case 5: entry.flags |= SpriteDatFlags::Stackable; break;
+            case 6: entry.flags |= SpriteDatFlags::ForceUse; break; // Corpse / ForceUse
+            case 7: entry.flags |= SpriteDatFlags::MultiUse; break;
             case 8: // Writable / Usable / Chargeable (context dependent)
                 if (versionData_.clientVersionNumber >= 780 && versionData_.clientVersionNumber <= 792) { // Chargeable for 7.8-7.92
-                     spriteData->flags |= SpriteDatFlags::Chargeable_780;
+                     entry.flags |= SpriteDatFlags::Chargeable_780;
                 } else { // Default to Writable
-                     spriteData->flags |= SpriteDatFlags::Writable;
+                     entry.flags |= SpriteDatFlags::Writable;
                 }
                 break;
-            case 9: spriteData->flags |= SpriteDatFlags::WritableOnce; break; // Readable
-            case 10: spriteData->flags |= SpriteDatFlags::FluidContainer; break;
-            case 11: spriteData->flags |= SpriteDatFlags::Splash; break;
-            case 12: spriteData->flags |= SpriteDatFlags::NotWalkable; break;
-            case 13: spriteData->flags |= SpriteDatFlags::NotMoveable; break;
-            case 14: spriteData->flags |= SpriteDatFlags::BlockProjectile; break;
-            case 15: spriteData->flags |= SpriteDatFlags::NotPathable; break; // NoPathArrow
+            case 9: entry.flags |= SpriteDatFlags::WritableOnce; break; // Readable
+            case 10: entry.flags |= SpriteDatFlags::FluidContainer; break;
+            case 11: entry.flags |= SpriteDatFlags::Splash; break;
+            case 12: entry.flags |= SpriteDatFlags::NotWalkable; break;
+            case 13: entry.flags |= SpriteDatFlags::NotMoveable; break;
+            case 14: entry.flags |= SpriteDatFlags::BlockProjectile; break;
+            case 15: entry.flags |= SpriteDatFlags::NotPathable; break; // NoPathArrow
             case 16: // Pickupable or NoMoveAnimation
                 if (versionData_.clientVersionNumber >= 1010) {
-                    spriteData->flags |= SpriteDatFlags::NoMoveAnimation_1010;
+                    entry.flags |= SpriteDatFlags::NoMoveAnimation_1010;
                 } else {
-                    spriteData->flags |= SpriteDatFlags::Pickupable;
+                    entry.flags |= SpriteDatFlags::Pickupable;
                 }
                 break;
-            case 17: spriteData->flags |= SpriteDatFlags::Hangable; break; // Hang / Horizontal / Vertical
-            case 18: spriteData->flags |= SpriteDatFlags::HookSouth; break;
-            case 19: spriteData->flags |= SpriteDatFlags::HookEast; break;
-            case 20: spriteData->flags |= SpriteDatFlags::Rotateable; break;
+            case 17: entry.flags |= SpriteDatFlags::Hangable; break; // Hang / Horizontal / Vertical
+            case 18: entry.flags |= SpriteDatFlags::HookSouth; break;
+            case 19: entry.flags |= SpriteDatFlags::HookEast; break;
+            case 20: entry.flags |= SpriteDatFlags::Rotateable; break;
             case 21: { // Light info
-                spriteData->flags |= SpriteDatFlags::Light;
+                entry.flags |= SpriteDatFlags::Light;
                 quint16 intensity_read, color_read; // As per wxRME, these were quint16 in file for some versions
                 stream >> intensity_read >> color_read;
                 if (stream.atEnd()) { error = "Unexpected end of stream after light flag for " + QString::number(gameSpriteId); return false; }
-                spriteData->light.intensity = static_cast<quint8>(intensity_read); // Assuming data fits quint8
-                spriteData->light.color = static_cast<quint8>(color_read);
-                spriteData->light.hasLight = true;
+                entry.lightIntensity = static_cast<quint8>(intensity_read); // Assuming data fits quint8
+                entry.lightColor = static_cast<quint8>(color_read);
                 break;
             }
-            case 22: spriteData->flags |= SpriteDatFlags::DontHide; break; // FloorChange / DontHide / IgnoreLook
-            case 23: spriteData->flags |= SpriteDatFlags::Translucent; break; // Translucent / Offset
+            case 22: entry.flags |= SpriteDatFlags::DontHide; break; // FloorChange / DontHide / IgnoreLook
+            case 23: entry.flags |= SpriteDatFlags::Translucent; break; // Translucent / Offset
             case 24: { // Displacement / Shift
-                spriteData->flags |= SpriteDatFlags::Displacement;
+                entry.flags |= SpriteDatFlags::Displacement;
                 quint16 x_offset, y_offset;
                 stream >> x_offset >> y_offset;
                 if (stream.atEnd()) { error = "Unexpected end of stream after displacement flag for " + QString::number(gameSpriteId); return false; }
-                spriteData->drawOffset = QPoint(static_cast<int>(x_offset), static_cast<int>(y_offset));
+                entry.drawOffsetX = static_cast<qint16>(x_offset);
+                entry.drawOffsetY = static_cast<qint16>(y_offset);
                 break;
             }
             case 25: { // Elevation / Height
-                spriteData->flags |= SpriteDatFlags::Elevation;
-                stream >> spriteData->drawHeight;
+                entry.flags |= SpriteDatFlags::Elevation;
+                stream >> entry.drawHeight;
                 if (stream.atEnd()) { error = "Unexpected end of stream after elevation flag for " + QString::number(gameSpriteId); return false; }
                 break;
             }
-            case 26: spriteData->flags |= SpriteDatFlags::LyingCorpse; break; // Lying Object
-            case 27: spriteData->flags |= SpriteDatFlags::AnimateAlways; break;
+            case 26: entry.flags |= SpriteDatFlags::LyingCorpse; break; // Lying Object
+            case 27: entry.flags |= SpriteDatFlags::AnimateAlways; break;
             case 28: { // Minimap Color
-                spriteData->flags |= SpriteDatFlags::MinimapColor;
-                stream >> spriteData->minimapColor;
+                entry.flags |= SpriteDatFlags::MinimapColor;
+                stream >> entry.minimapColor;
                 if (stream.atEnd()) { error = "Unexpected end of stream after minimap color flag for " + QString::number(gameSpriteId); return false; }
                 break;
             }
             case 29: { // Lens Help / Action data
-                spriteData->flags |= SpriteDatFlags::LensHelp;
-                quint16 lensHelpId; stream >> lensHelpId; /* store if needed spriteData->lensHelpId = lensHelpId; */
+                entry.flags |= SpriteDatFlags::LensHelp;
+                quint16 lensHelpId; stream >> lensHelpId; /* store if needed entry.lensHelpId = lensHelpId; */
                 if (stream.atEnd()) { error = "Unexpected end of stream after lens help flag for " + QString::number(gameSpriteId); return false; }
                 break;
             }
-            case 30: spriteData->flags |= SpriteDatFlags::FullGround; break; // Full Ground / IgnoreLook
-            case 31: spriteData->flags |= SpriteDatFlags::Look; break; // Indicates "look through" / no default action
+            case 30: entry.flags |= SpriteDatFlags::FullGround; break; // Full Ground / IgnoreLook
+            case 31: entry.flags |= SpriteDatFlags::Look; break; // Indicates "look through" / no default action
             // case 32: // Clothing (newer clients)
             // case 33: // Market (newer clients)
             // etc. Add more flags as needed based on versionData_.clientVersionNumber
@@ -445,62 +542,59 @@ bool SpriteManager::readDatEntry(QDataStream& stream, quint32 gameSpriteId, QStr
 
     // Read Dimensions and Animation Info
     if (stream.atEnd()) { error = "Unexpected end of stream before dimensions for " + QString::number(gameSpriteId); return false; }
-    stream >> spriteData->spriteWidth >> spriteData->spriteHeight;
-    if (spriteData->spriteWidth == 0) spriteData->spriteWidth = 1; // Avoid division by zero later
-    if (spriteData->spriteHeight == 0) spriteData->spriteHeight = 1;
+    stream >> entry.width >> entry.height;
+    if (entry.width == 0) entry.width = 1; // Avoid division by zero later
+    if (entry.height == 0) entry.height = 1;
 
-    if (spriteData->spriteWidth > 1 || spriteData->spriteHeight > 1) {
+    if (entry.width > 1 || entry.height > 1) {
         if (stream.atEnd()) { error = "Unexpected end of stream before exact size for " + QString::number(gameSpriteId); return false; }
         quint8 exactSize; stream >> exactSize; // Read and discard for now, could store if useful
     }
 
     if (stream.atEnd()) { error = "Unexpected end of stream before layers for " + QString::number(gameSpriteId); return false; }
-    stream >> spriteData->layers >> spriteData->patternX >> spriteData->patternY;
+    stream >> entry.layers >> entry.patternX >> entry.patternY;
 
     if (versionData_.datFormat < DatFormat::Format_780) {
-        spriteData->patternZ = 1; // Default for older versions
+        entry.patternZ = 1; // Default for older versions
     } else {
         if (stream.atEnd()) { error = "Unexpected end of stream before patternZ for " + QString::number(gameSpriteId); return false; }
-        stream >> spriteData->patternZ;
+        stream >> entry.patternZ;
     }
     if (stream.atEnd()) { error = "Unexpected end of stream before frames for " + QString::number(gameSpriteId); return false; }
-    stream >> spriteData->frames;
-    spriteData->isAnimated = spriteData->frames > 1;
-
-    if (spriteData->isAnimated) {
+    stream >> entry.frames;
+    if (entry.frames > 1) {
         if (versionData_.hasFrameDurations) { // Typically for 9.60+ or as indicated by client version data
             if (stream.atEnd()) { error = "Unexpected end of stream before animation async byte for " + QString::number(gameSpriteId); return false; }
             quint8 async; stream >> async; // Read 'is_async' byte (used as 'loop_type' in some contexts)
 
             if (stream.atEnd()) { error = "Unexpected end of stream before animation loop count for " + QString::number(gameSpriteId); return false; }
-            stream >> spriteData->animationLoopCount;
+            stream >> entry.animationLoopCount;
 
             if (stream.atEnd()) { error = "Unexpected end of stream before animation start frame for " + QString::number(gameSpriteId); return false; }
-            qint8 startFrame; stream >> startFrame; spriteData->animationStartFrame = startFrame;
+            qint8 startFrame; stream >> startFrame; entry.animationStartFrame = startFrame;
 
-            spriteData->frameDurations.reserve(spriteData->frames);
-            for (quint8 i = 0; i < spriteData->frames; ++i) {
-                if (stream.atEnd()) { error = QString("Unexpected end of stream reading frame duration %1/%2 for ").arg(i+1).arg(spriteData->frames) + QString::number(gameSpriteId); return false; }
+            for (quint8 i = 0; i < entry.frames; ++i) {
+                if (stream.atEnd()) { error = QString("Unexpected end of stream reading frame duration %1/%2 for ").arg(i+1).arg(entry.frames) + QString::number(gameSpriteId); return false; }
                 quint32 min, max; stream >> min >> max;
-                spriteData->frameDurations.append(qMakePair(min, max));
+                gameSprites_.frameDurations.append(qMakePair(min, max));
             }
         } else { // Older clients without explicit frame durations
-            spriteData->animationLoopCount = -1; // Default to continuous loop (or often 0 means continuous)
-            spriteData->animationStartFrame = 0; // Default start frame
+            entry.animationLoopCount = -1; // Default to continuous loop (or often 0 means continuous)
+            entry.animationStartFrame = 0; // Default start frame
             // Frame durations might be fixed (e.g., 100ms) or handled by an animator class.
-            // For now, leave frameDurations vector empty.
+            // For now, leave the entry's frame durations empty.
         }
     }
 
     // Read SPR Sheet IDs
-    quint32 numSprSheetsToRead = static_cast<quint32>(spriteData->spriteWidth) * spriteData->spriteHeight *
-                                spriteData->layers * spriteData->patternX *
-                                spriteData->patternZ * spriteData->frames;
+    quint32 numSprSheetsToRead = static_cast<quint32>(entry.width) * entry.height *
+                                entry.layers * entry.patternX * entry.patternY *
+                                entry.patternZ * entry.frames;
 
-    if (numSprSheetsToRead == 0 && (spriteData->spriteWidth > 0 || spriteData->spriteHeight > 0)) { // If dimensions suggest sprites but calculation is 0
+    if (numSprSheetsToRead == 0 && (entry.width > 0 || entry.height > 0)) { // If dimensions suggest sprites but calculation is 0
         warnings.append(QString("Calculated 0 SPR sheets for gameSpriteId %1 with non-zero dimensions (W:%2 H:%3 L:%4 X:%5 Y:%6 Z:%7 F:%8). Assuming 1 sheet.")
-                        .arg(gameSpriteId).arg(spriteData->spriteWidth).arg(spriteData->spriteHeight).arg(spriteData->layers)
-                        .arg(spriteData->patternX).arg(spriteData->patternY).arg(spriteData->patternZ).arg(spriteData->frames));
+                        .arg(gameSpriteId).arg(entry.width).arg(entry.height).arg(entry.layers)
+                        .arg(entry.patternX).arg(entry.patternY).arg(entry.patternZ).arg(entry.frames));
         numSprSheetsToRead = 1; // Fallback for items that are not "null" but have 0 in some pattern/layer fields
     }
 
@@ -512,7 +606,6 @@ bool SpriteManager::readDatEntry(QDataStream& stream, quint32 gameSpriteId, QStr
     }
 
     if (numSprSheetsToRead > 0) {
-        spriteData->sprSheetIDs.reserve(static_cast<int>(numSprSheetsToRead));
         for (quint32 i = 0; i < numSprSheetsToRead; ++i) {
             if (stream.atEnd()) {
                 error = QString("Unexpected end of stream reading SPR sheet ID %1/%2 for gameSpriteId %3.")
@@ -527,235 +620,118 @@ bool SpriteManager::readDatEntry(QDataStream& stream, quint32 gameSpriteId, QStr
                 stream >> sprSheetId_u16;
                 sprSheetId = sprSheetId_u16;
             }
-            spriteData->sprSheetIDs.append(sprSheetId);
+            gameSprites_.spriteIds.append(sprSheetId);
         }
     }
-
-    gameSpriteMetadataCache_.insert(gameSpriteId, spriteData);
     return true;
 }
 
-// Placeholder for decodeSpriteRleData, will be implemented in Part 3 (actually, implementing now)
-QImage SpriteManager::decodeSpriteRleData(const QByteArray& rleData, bool hasAlpha) const {
-    if (rleData.isEmpty()) {
-        return QImage(32, 32, QImage::Format_ARGB32_Premultiplied); // Return transparent image for empty RLE
-    }
-
-    QImage image(32, 32, QImage::Format_ARGB32_Premultiplied); // Use ARGB32_Premultiplied for better QPainter performance
-    image.fill(Qt::transparent); // Initialize with transparency
-
-    uchar* imageData = image.bits();
-    const uchar* rleBytes = reinterpret_cast<const uchar*>(rleData.constData());
-    int rleSize = rleData.size();
-
-    int rleIdx = 0;
-    int currentPixel = 0; // Current pixel index in the 32x32 grid (0 to 1023)
-    int bytesPerPixel = hasAlpha ? 4 : 3;
-
-    while (rleIdx < rleSize && currentPixel < 1024) {
-        if (rleIdx + 1 >= rleSize) { // Not enough data for count
-            qWarning() << "SpriteManager::decodeSpriteRleData: Unexpected end of RLE data (reading count). Offset:" << rleIdx << "Size:" << rleSize;
-            break;
-        }
-        quint16 transparentPixels = static_cast<quint16>(rleBytes[rleIdx]) | (static_cast<quint16>(rleBytes[rleIdx+1]) << 8);
-        rleIdx += 2;
-        currentPixel += transparentPixels;
-
-        if (currentPixel > 1024 && transparentPixels > 0) { // Check if transparent run overshot
-             qWarning() << "SpriteManager::decodeSpriteRleData: Transparent run overshot image buffer. currentPixel:" << currentPixel;
-             currentPixel = 1024; // Clamp to end
-        }
-        if (currentPixel >= 1024 || rleIdx >= rleSize) { // Re-check after transparent run
-            break;
-        }
-
-        if (rleIdx + 1 >= rleSize) { // Not enough data for count
-            qWarning() << "SpriteManager::decodeSpriteRleData: Unexpected end of RLE data (reading colored count). Offset:" << rleIdx << "Size:" << rleSize;
-            break;
-        }
-        quint16 coloredPixels = static_cast<quint16>(rleBytes[rleIdx]) | (static_cast<quint16>(rleBytes[rleIdx+1]) << 8);
-        rleIdx += 2;
-
-        for (quint16 i = 0; i < coloredPixels; ++i) {
-            if (currentPixel >= 1024) {
-                qWarning() << "SpriteManager::decodeSpriteRleData: Colored pixel run trying to write past image buffer. currentPixel:" << currentPixel;
-                break;
-            }
-            if (rleIdx + bytesPerPixel > rleSize) { // Check for enough data for one pixel
-                qWarning() << "SpriteManager::decodeSpriteRleData: Unexpected end of RLE data (reading pixel data). Offset:" << rleIdx << "Required:" << bytesPerPixel << "Size:" << rleSize;
-                rleIdx = rleSize; // Force break outer loop
-                break;
-            }
-
-            int imgByteIdx = currentPixel * 4; // Each pixel is 4 bytes in ARGB32_Premultiplied
-
-            // BGRA order in file for RGB or RGBA sprites
-            imageData[imgByteIdx + 2] = rleBytes[rleIdx + 0]; // Red
-            imageData[imgByteIdx + 1] = rleBytes[rleIdx + 1]; // Green
-            imageData[imgByteIdx + 0] = rleBytes[rleIdx + 2]; // Blue
-            imageData[imgByteIdx + 3] = hasAlpha ? rleBytes[rleIdx + 3] : 255; // Alpha
-
-            rleIdx += bytesPerPixel;
-            currentPixel++;
-        }
-    }
-    if (rleIdx < rleSize && currentPixel < 1024) {
-        qWarning() << "SpriteManager::decodeSpriteRleData: RLE data not fully consumed or image not fully populated. RLE Idx:" << rleIdx << "/" << rleSize << "Pixel Idx:" << currentPixel << "/1024";
+// Decode one sprite's RLE data into a 32x32 premultiplied ARGB image (see SpriteRleDecoder).
+QImage SpriteManager::decodeSpriteRleData(QByteArrayView rleData, bool hasAlpha) const {
+    QImage image(SpriteRleDecoder::SpriteSize, SpriteRleDecoder::SpriteSize, QImage::Format_ARGB32_Premultiplied);
+    // A 32x32 ARGB32 image has no row padding, so its bits are the 1024 pixels in order.
+    if (!SpriteRleDecoder::decode(rleData, hasAlpha, reinterpret_cast<quint32*>(image.bits()))) {
+        qWarning() << "SpriteManager::decodeSpriteRleData: RLE data is truncated or overruns the sprite. Size:" << rleData.size();
     }
-
     return image;
 }
 
-QByteArray SpriteManager::readRawSpriteData(quint32 actualSprId, QString& error) {
+QByteArrayView SpriteManager::rawSpriteData(quint32 actualSprId, QString& error) const {
     error.clear();
     if (!assetsLoaded_) {
         error = "Assets not loaded.";
-        return QByteArray();
+        return QByteArrayView();
     }
-    if (actualSprId == 0 || actualSprId > sprSpriteCount_) { // Sprite ID 0 is often "empty" but might not have an address.
-        // error = QString("Invalid actualSprId: %1. Max is %2.").arg(actualSprId).arg(sprSpriteCount_);
+    if (actualSprId == 0 || actualSprId > sprSpriteCount_) {
         // For ID 0, or invalid ID, return empty indicating transparency.
-        return QByteArray();
+        return QByteArrayView();
     }
 
-    if (!sprSheetAddresses_.contains(actualSprId)) {
-        // This can happen if a DAT entry references a SPR ID that was not in the header's address list
-        // or if actualSprId is 0 and we chose not to store address 0.
-        // error = QString("Sprite address not found for actualSprId: %1").arg(actualSprId);
-        return QByteArray(); // Treat as transparent
-    }
-
-    quint32 address = sprSheetAddresses_.value(actualSprId);
+    const quint32 address = sprSheetAddresses_.at(actualSprId);
     if (address == 0) { // Address 0 explicitly means an empty/transparent sprite
-        return QByteArray();
-    }
-
-    QFile file(versionData_.sprPath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        error = QString("Failed to open SPR file for reading sprite ID %1: %2").arg(actualSprId).arg(versionData_.sprPath);
-        return QByteArray();
-    }
-
-    if (!file.seek(address)) {
-        error = QString("Failed to seek to address %1 for sprite ID %2 in SPR file.").arg(address).arg(actualSprId);
-        file.close();
-        return QByteArray();
-    }
-
-    QDataStream stream(&file);
-    stream.setByteOrder(QDataStream::LittleEndian);
-
-    // Skip 3-byte color key (R, G, B) - not used when alpha channel is present
-    if (stream.skipRawData(3) != 3) {
-        error = QString("Failed to skip color key for sprite ID %1.").arg(actualSprId);
-        file.close();
-        return QByteArray();
-    }
-
-    quint16 rleDataSize;
-    stream >> rleDataSize;
-
-    if (stream.status() != QDataStream::Ok) {
-        error = QString("Failed to read RLE data size for sprite ID %1.").arg(actualSprId);
-        file.close();
-        return QByteArray();
+        return QByteArrayView();
     }
 
-    if (rleDataSize == 0) {
-        file.close();
-        return QByteArray(); // Empty sprite
+    // 3-byte color key (R, G, B), unused, then the u16 RLE data size.
+    constexpr qint64 SpriteHeaderSize = 3 + 2;
+    if (qint64(address) + SpriteHeaderSize > sprSize_) {
+        error = QString("Address %1 for sprite ID %2 lies outside the SPR file.").arg(address).arg(actualSprId);
+        return QByteArrayView();
     }
-
-    // QDataStream::readBytes reads a quint32 size first, then the bytes. We want to read exactly rleDataSize.
-    // So, better use file.read directly or stream.readRawData.
-    QByteArray rleData;
-    rleData.resize(rleDataSize); // Pre-allocate
-    int bytesRead = stream.readRawData(rleData.data(), rleDataSize);
-
-    if (bytesRead != rleDataSize) {
-        error = QString("Failed to read RLE data for sprite ID %1. Expected %2 bytes, got %3.")
-                    .arg(actualSprId).arg(rleDataSize).arg(bytesRead);
-        file.close();
-        return QByteArray(); // Return empty or partially read data
+    const uchar* sprite = sprData_ + address;
+    const quint16 rleDataSize = static_cast<quint16>(sprite[3]) | (static_cast<quint16>(sprite[4]) << 8);
+    if (qint64(address) + SpriteHeaderSize + rleDataSize > sprSize_) {
+        error = QString("RLE data for sprite ID %1 runs past the end of the SPR file (%2 bytes at %3).")
+                    .arg(actualSprId).arg(rleDataSize).arg(address);
+        return QByteArrayView();
     }
-
-    file.close();
-    return rleData;
+    return QByteArrayView(reinterpret_cast<const char*>(sprite + SpriteHeaderSize), rleDataSize);
 }
 
 
 // --- Public Accessors ---
-QSharedPointer<const GameSpriteData> SpriteManager::getGameSpriteData(quint32 gameSpriteId) const {
-    if (!assetsLoaded_) {
-        qWarning("SpriteManager::getGameSpriteData - Assets not loaded.");
-        return nullptr;
-    }
-    return gameSpriteMetadataCache_.value(gameSpriteId, nullptr);
-}
-
 QImage SpriteManager::getSpriteImage(quint32 actualSprId) {
     if (!assetsLoaded_) {
         qWarning("SpriteManager::getSpriteImage - Assets not loaded.");
         return QImage();
     }
-    if (actualSprId == 0) return QImage(32,32,QImage::Format_ARGB32_Premultiplied); // common case for empty/transparent
+    if (actualSprId == 0) return transparentSprite(); // common case for empty/transparent
 
-    if (sprSheetRleDataCache_.contains(actualSprId)) {
-        const QByteArray& rleData = sprSheetRleDataCache_.value(actualSprId);
-        return decodeSpriteRleData(rleData, versionData_.hasAlphaChannel);
+    if (const QImage* cached = spriteImageCache_.object(actualSprId)) { // Also marks it most recently used
+        ++spriteCacheHits_;
+        return *cached; // Implicitly shared, no pixel copy
     }
+    ++spriteCacheMisses_;
 
     QString error;
-    QByteArray rleData = readRawSpriteData(actualSprId, error);
+    const QByteArrayView rleData = rawSpriteData(actualSprId, error);
     if (!error.isEmpty()) {
         qWarning() << "SpriteManager::getSpriteImage - Error reading raw sprite data for ID" << actualSprId << ":" << error;
         return QImage(); // Return empty or placeholder image
     }
-    if (rleData.isEmpty() && actualSprId != 0) { // ID 0 is expected to be empty
-         // This might be a valid empty sprite, or an error from readRawSpriteData if actualSprId was invalid but not 0.
-         // readRawSpriteData already handles invalid IDs by returning empty QByteArray.
-    }
-
-    sprSheetRleDataCache_.insert(actualSprId, rleData); // Cache it
-    return decodeSpriteRleData(rleData, versionData_.hasAlphaChannel);
+    const QImage image = decodeSpriteRleData(rleData, versionData_.hasAlphaChannel);
+    spriteImageCache_.insert(actualSprId, new QImage(image), image.sizeInBytes());
+    return image;
 }
 
-QImage SpriteManager::getFrameImage(quint32 gameSpriteId, int frame, int patternX_arg, int patternY_arg, int patternZ_arg, int layer_arg) {
+// Locate the sprites of one frame: wraps the pattern/frame/layer arguments to the entry's
+// dimensions and finds its width x height sheets in the sprite id pool.
+bool SpriteManager::resolveFrame(quint32 gameSpriteId, int frame, int patternX_arg, int patternY_arg, int patternZ_arg, int layer_arg, ResolvedFrame& resolved) const {
     if (!assetsLoaded_) {
-        qWarning("SpriteManager::getFrameImage - Assets not loaded.");
-        return QImage();
+        qWarning("SpriteManager::resolveFrame - Assets not loaded.");
+        return false;
     }
 
-    QSharedPointer<const GameSpriteData> data = getGameSpriteData(gameSpriteId);
-    if (!data) {
-        qWarning() << "SpriteManager::getFrameImage - No GameSpriteData found for ID" << gameSpriteId;
-        return QImage(); // Or return a placeholder "unknown item" sprite
+    const int slot = gameSpriteSlot(gameSpriteId);
+    if (slot < 0 || slot >= gameSprites_.size()) {
+        qWarning() << "SpriteManager::resolveFrame - No DAT entry found for ID" << gameSpriteId;
+        return false;
     }
+    const GameSpriteTable& table = gameSprites_;
+    const int width = table.width[slot];
+    const int height = table.height[slot];
+    const int layers = table.layers[slot];
+    const int patternX = table.patternX[slot];
+    const int patternY = table.patternY[slot];
+    const int patternZ = table.patternZ[slot];
+    const int frames = table.frames[slot];
 
     // Validate and wrap around input pattern/frame/layer values based on sprite's dimensions
     // Ensure denominators are not zero.
-    int f = (data->frames > 0) ? (frame % data->frames) : 0;
-    int pZ = (data->patternZ > 0) ? (patternZ_arg % data->patternZ) : 0;
-    int pY = (data->patternY > 0) ? (patternY_arg % data->patternY) : 0;
-    int pX = (data->patternX > 0) ? (patternX_arg % data->patternX) : 0;
-    int l = (data->layers > 0) ? (layer_arg % data->layers) : 0;
-
-    // The calculation for spriteSheetIndex needs to match the order sprites are stored in sprSheetIDs
-    // Based on readDatEntry, the order is:
-    // numSprSheetsToRead = width * height * layers * patternX * patternY * patternZ * frames;
-    // So, reading is frame-outermost, then patternZ, then patternY, then patternX, then layers, then height, then width.
-    // For a single 32x32 sheet, width and height components of this index are 0.
-    // (This assumes spriteWidth/Height in GameSpriteData refer to how many 32x32 sheets make up one "layer-pattern-frame" instance)
-    // For now, let's assume GameSpriteData's spriteWidth/Height are 1 for this calculation,
-    // meaning each entry in sprSheetIDs is a distinct 32x32 sprite.
-    // If a "thing" is e.g. 2x1 sheets (64x32 pixels), then spriteWidth would be 2, spriteHeight 1.
-    // The current readDatEntry sets spriteWidth/Height from DAT, which is this sheet count.
-
-    quint32 sheetsPerFrame = static_cast<quint32>(data->spriteWidth) * data->spriteHeight * data->layers * data->patternX * data->patternY * data->patternZ;
-    quint32 sheetsPerPatternZ = static_cast<quint32>(data->spriteWidth) * data->spriteHeight * data->layers * data->patternX * data->patternY;
-    quint32 sheetsPerPatternY = static_cast<quint32>(data->spriteWidth) * data->spriteHeight * data->layers * data->patternX;
-    quint32 sheetsPerPatternX = static_cast<quint32>(data->spriteWidth) * data->spriteHeight * data->layers;
-    quint32 sheetsPerLayer = static_cast<quint32>(data->spriteWidth) * data->spriteHeight;
+    int f = (frames > 0) ? (frame % frames) : 0;
+    int pZ = (patternZ > 0) ? (patternZ_arg % patternZ) : 0;
+    int pY = (patternY > 0) ? (patternY_arg % patternY) : 0;
+    int pX = (patternX > 0) ? (patternX_arg % patternX) : 0;
+    int l = (layers > 0) ? (layer_arg % layers) : 0;
+
+    // Sprites are stored in the order readDatEntry reads them: frame outermost, then patternZ,
+    // patternY, patternX, layer, height and width innermost, so the width x height sheets of
+    // the requested instance follow each other from this index at (sheet_y * width + sheet_x).
+    const int sheetsPerLayer = width * height;
+    const int sheetsPerPatternX = sheetsPerLayer * layers;
+    const int sheetsPerPatternY = sheetsPerPatternX * patternX;
+    const int sheetsPerPatternZ = sheetsPerPatternY * patternY;
+    const int sheetsPerFrame = sheetsPerPatternZ * patternZ;
 
     int spriteSheetIndex =
         f * sheetsPerFrame +
@@ -763,21 +739,73 @@ QImage SpriteManager::getFrameImage(quint32 gameSpriteId, int frame, int pattern
         pY * sheetsPerPatternY +
         pX * sheetsPerPatternX +
         l * sheetsPerLayer;
-        // Assuming we always want the top-left sheet of a potential multi-sheet arrangement for this specific "thing"
-        // If spriteWidth/Height > 1, this index points to the (0,0)th sheet of that larger sprite.
-        // To get other parts of a large sprite, you'd add offsets: (sheet_y * data->spriteWidth + sheet_x)
 
-    if (spriteSheetIndex < 0 || spriteSheetIndex >= data->sprSheetIDs.size()) {
-        qWarning() << "SpriteManager::getFrameImage - Calculated spriteSheetIndex" << spriteSheetIndex
-                   << "is out of bounds for sprSheetIDs (size" << data->sprSheetIDs.size() << ") for ID" << gameSpriteId;
-        return QImage(); // Or placeholder
+    const int spriteCount = table.spriteCountOf(slot);
+    if (spriteSheetIndex < 0 || spriteSheetIndex + sheetsPerLayer > spriteCount) {
+        qWarning() << "SpriteManager::resolveFrame - Calculated spriteSheetIndex" << spriteSheetIndex
+                   << "is out of bounds (" << spriteCount << "sprites) for ID" << gameSpriteId;
+        return false;
+    }
+
+    resolved.sheets = table.spritesOf(slot) + spriteSheetIndex;
+    resolved.width = width;
+    resolved.height = height;
+    // Slots fit in 24 bits (four kinds of at most 65535 entries) and the wrapped indices in 8.
+    resolved.key = (quint64(slot) << 40) | (quint64(f) << 32) | (quint64(pZ) << 24) |
+                   (quint64(pY) << 16) | (quint64(pX) << 8) | quint64(l);
+    return true;
+}
+
+QImage SpriteManager::getFrameImage(quint32 gameSpriteId, int frame, int patternX, int patternY, int patternZ, int layer) {
+    ResolvedFrame resolved;
+    if (!resolveFrame(gameSpriteId, frame, patternX, patternY, patternZ, layer, resolved)) {
+        return QImage(); // Or return a placeholder "unknown item" sprite
     }
+    return frameImage(resolved);
+}
 
-    quint32 actualSprId = data->sprSheetIDs.value(spriteSheetIndex, 0);
-    if (actualSprId == 0) {
-        // This is a valid case for parts of an object being transparent.
-        return QImage(32,32,QImage::Format_ARGB32_Premultiplied); // Return fully transparent image
+QImage SpriteManager::frameImage(const ResolvedFrame& resolved) {
+    const quint32* sheets = resolved.sheets;
+    const int width = resolved.width;
+    const int height = resolved.height;
+    if (width * height == 1) {
+        // A single sprite; the decoded sprite cache already holds it. Id 0 is a valid
+        // case for parts of an object being transparent.
+        return sheets[0] == 0 ? transparentSprite() : getSpriteImage(sheets[0]);
+    }
+
+    if (const QImage* cached = frameImageCache_.object(resolved.key)) {
+        return *cached;
+    }
+
+    // The object is anchored at its bottom-right sprite: sheet (x, y) lies x sprites left of
+    // and y sprites above it.
+    QImage image(width * 32, height * 32, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    painter.setCompositionMode(QPainter::CompositionMode_Source); // Sheets do not overlap
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const quint32 actualSprId = sheets[y * width + x];
+            if (actualSprId != 0) {
+                painter.drawImage(QPoint((width - 1 - x) * 32, (height - 1 - y) * 32), getSpriteImage(actualSprId));
+            }
+        }
     }
+    painter.end();
+
+    frameImageCache_.insert(resolved.key, new QImage(image), image.sizeInBytes());
+    return image;
+}
 
-    return getSpriteImage(actualSprId);
+SpriteAtlas::Entry SpriteManager::atlasFrame(quint32 gameSpriteId, int frame, int patternX, int patternY, int patternZ, int layer) {
+    ResolvedFrame resolved;
+    if (!resolveFrame(gameSpriteId, frame, patternX, patternY, patternZ, layer, resolved)) {
+        return SpriteAtlas::Entry();
+    }
+    const SpriteAtlas::Entry entry = atlas_.find(resolved.key);
+    if (entry.isValid()) {
+        return entry;
+    }
+    return atlas_.insert(resolved.key, frameImage(resolved));
 }
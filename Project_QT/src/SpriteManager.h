@@ -2,17 +2,18 @@
 #define SPRITEMANAGER_H
 
 #include <QObject>
+#include <QFile>
 #include <QString>
+#include <QByteArrayView>
 #include <QStringList>
 #include <QImage>
-#include <QMap>
+#include <QCache>
 #include <QVector>
 #include <QPair>
-#include <QSharedPointer>
-#include <QPoint> // For GameSpriteData::drawOffset
+#include "SpriteAtlas.h"
 
 // Forward declarations
-class QFile;
+class QDataStream;
 
 // --- Enums from wxwidgets/client_version.h ---
 enum class DatFormat {
@@ -81,40 +82,68 @@ struct ClientVersionData {
     quint32 expectedSprSignature = 0;
 };
 
-// --- SpriteLightData Struct ---
-struct SpriteLightData {
-    quint8 intensity = 0;
-    quint8 color = 0;
-    bool hasLight = false;
-};
+// --- GameSpriteTable ---
+// DAT metadata of every item, outfit, effect and missile, stored column by column: slot i
+// of each vector belongs to the i-th DAT entry (see SpriteManager::gameSpriteSlot). The SPR
+// ids and frame durations of all entries live in two shared pools; entry i owns
+// [spriteBegin[i], spriteBegin[i + 1]) of spriteIds, and likewise for frameDurations.
+struct GameSpriteTable {
+    // One DAT entry while it is being read; see append().
+    struct Entry {
+        SpriteDatFlagValues flags;
+        quint8 width = 1;  // In 32x32 sprites; never 0
+        quint8 height = 1;
+        quint8 layers = 0;
+        quint8 patternX = 0;
+        quint8 patternY = 0;
+        quint8 patternZ = 0;
+        quint8 frames = 0;
+        qint16 drawOffsetX = 0;
+        qint16 drawOffsetY = 0;
+        quint16 drawHeight = 0;
+        quint16 minimapColor = 0;
+        quint8 lightIntensity = 0;
+        quint8 lightColor = 0;
+        qint32 animationLoopCount = 0;
+        qint8 animationStartFrame = 0;
+    };
 
-// --- GameSpriteData Class/Struct ---
-class GameSpriteData {
-public:
-    GameSpriteData() = default;
-
-    quint32 id = 0;
-    quint8 spriteWidth = 1;  // Default to 1 to avoid division by zero if uninitialized
-    quint8 spriteHeight = 1; // Default to 1
-    quint8 layers = 0;
-    quint8 patternX = 0;
-    quint8 patternY = 0;
-    quint8 patternZ = 0;
-    quint8 frames = 0;
-
-    SpriteLightData light;
-    quint16 minimapColor = 0;
-    QPoint drawOffset;
-    quint16 drawHeight = 0;
-    SpriteDatFlagValues flags;
-
-    bool isAnimated = false;
-    qint32 animationLoopCount = 0;
-    qint8 animationStartFrame = 0;
-    QVector<QPair<quint32, quint32>> frameDurations;
-
-    QVector<quint32> sprSheetIDs;
-    QMap<quint32, QByteArray> rawSpriteRleData; // Consider changing to offsets/sizes later
+    QVector<quint32> flags; // SpriteDatFlags bits
+    QVector<quint8> width;
+    QVector<quint8> height;
+    QVector<quint8> layers;
+    QVector<quint8> patternX;
+    QVector<quint8> patternY;
+    QVector<quint8> patternZ;
+    QVector<quint8> frames;
+    QVector<qint16> drawOffsetX;
+    QVector<qint16> drawOffsetY;
+    QVector<quint16> drawHeight;
+    QVector<quint16> minimapColor;
+    QVector<quint8> lightIntensity;
+    QVector<quint8> lightColor;
+    QVector<qint32> animationLoopCount;
+    QVector<qint8> animationStartFrame;
+    QVector<quint32> spriteBegin{0};        // size() + 1 offsets into spriteIds
+    QVector<quint32> frameDurationBegin{0}; // size() + 1 offsets into frameDurations
+
+    QVector<quint32> spriteIds;                     // SPR sprite ids of all entries
+    QVector<QPair<quint32, quint32>> frameDurations; // Min/max ms per frame, if the DAT has them
+
+    int size() const { return flags.size(); }
+    SpriteDatFlagValues flagsOf(int slot) const { return SpriteDatFlagValues::fromInt(flags[slot]); }
+    const quint32* spritesOf(int slot) const { return spriteIds.constData() + spriteBegin[slot]; }
+    int spriteCountOf(int slot) const { return int(spriteBegin[slot + 1] - spriteBegin[slot]); }
+    const QPair<quint32, quint32>* frameDurationsOf(int slot) const { return frameDurations.constData() + frameDurationBegin[slot]; }
+    int frameDurationCountOf(int slot) const { return int(frameDurationBegin[slot + 1] - frameDurationBegin[slot]); }
+
+    // Adds entry as the next slot, owning everything appended to the pools since the last call.
+    void append(const Entry& entry);
+    // Drops what was appended to the pools since the last append() (an entry that failed to read).
+    void discardPending();
+    void reserve(int entryCount, int spriteIdCount);
+    void squeeze();
+    void clear();
 };
 
 // --- SpriteManager Class ---
@@ -127,7 +156,15 @@ public:
     bool loadAssets(const ClientVersionData& clientVersion, QString& error, QStringList& warnings);
     void unloadAssets();
 
-    QSharedPointer<const GameSpriteData> getGameSpriteData(quint32 gameSpriteId) const;
+    // Game sprite ids: items keep their client ids (from ItemIdBase); outfits, effects and
+    // missiles are numbered from their own base. gameSpriteSlot() maps an id to its slot in
+    // gameSprites(), or -1 if there is no such entry.
+    static constexpr quint32 ItemIdBase = 100;
+    static constexpr quint32 OutfitIdBase = 0x10000;
+    static constexpr quint32 EffectIdBase = 0x20000;
+    static constexpr quint32 MissileIdBase = 0x30000;
+    int gameSpriteSlot(quint32 gameSpriteId) const;
+    const GameSpriteTable& gameSprites() const { return gameSprites_; }
     QImage getSpriteImage(quint32 actualSprId);
     QImage getFrameImage(quint32 gameSpriteId, int frame = 0, int patternX = 0, int patternY = 0, int patternZ = 0, int layer = 0);
 
@@ -138,21 +175,80 @@ public:
     quint16 getMissileCount() const;
 
     const ClientVersionData* getCurrentVersionData() const;
+    bool hasAssets() const { return assetsLoaded_; }
+
+    // Decoded sprites are kept in an LRU cache limited to this many bytes of image data.
+    static constexpr qint64 DefaultSpriteCacheBudget = 64 * 1024 * 1024;
+    void setSpriteCacheBudget(qint64 bytes);
+    qint64 spriteCacheBudget() const { return spriteImageCache_.maxCost(); }
+    qint64 spriteCacheSize() const { return spriteImageCache_.totalCost(); }
+    quint64 spriteCacheHits() const { return spriteCacheHits_; }
+    quint64 spriteCacheMisses() const { return spriteCacheMisses_; }
+    void resetSpriteCacheCounters();
+
+    // getFrameImage() composites objects bigger than one sprite once and keeps the result in a
+    // second LRU cache, keyed by (type, frame, patterns, layer) and limited the same way. Its
+    // sub-sprites come from (and stay shared with) the decoded sprite cache.
+    static constexpr qint64 DefaultFrameCacheBudget = 32 * 1024 * 1024;
+    void setFrameCacheBudget(qint64 bytes);
+    qint64 frameCacheBudget() const { return frameImageCache_.maxCost(); }
+    qint64 frameCacheSize() const { return frameImageCache_.totalCost(); }
+
+    // The same frame as getFrameImage(), packed into the sprite atlas on first use; draw it
+    // through a SpriteAtlasBatch over atlas(). GUI thread only.
+    SpriteAtlas::Entry atlasFrame(quint32 gameSpriteId, int frame = 0, int patternX = 0, int patternY = 0, int patternZ = 0, int layer = 0);
+    const SpriteAtlas& atlas() const { return atlas_; }
 
     // Helper to declare Q_ENUMs if they are moved inside SpriteManager
     // static void declareQtEnums();
 
+signals:
+    // After loadAssets() succeeds, and after unloadAssets() drops loaded assets. Anything made
+    // from the old sprites (such as OutfitCompositor's looks) is stale from then on.
+    void assetsChanged();
+
 private:
     bool parseSprFile(QFile& file, QString& error);
+    bool parseSprHeader(QDataStream& stream, QString& error);
+    bool mapSprFile(QString& error);
     bool parseDatFile(QFile& file, QString& error, QStringList& warnings);
-    bool readDatEntry(QFile& file, quint32 gameSpriteId, QString& error);
-    QImage decodeSpriteRleData(const QByteArray& rleData, bool hasAlpha) const;
+    bool parseDatHeader(QDataStream& stream, QString& error);
+    bool loadDatContents(QDataStream& stream, QString& error, QStringList& warnings);
+    bool appendDatEntry(QDataStream& stream, quint32 gameSpriteId, QString& error, QStringList& warnings);
+    bool readDatEntry(QDataStream& stream, quint32 gameSpriteId, GameSpriteTable::Entry& entry, QString& error, QStringList& warnings);
+    // RLE data of a sprite as a view into the mapped SPR file; empty for transparent sprites.
+    QByteArrayView rawSpriteData(quint32 actualSprId, QString& error) const;
+    QImage decodeSpriteRleData(QByteArrayView rleData, bool hasAlpha) const;
+    static QImage transparentSprite();
+
+    // One frame of a DAT entry after wrapping its arguments; key identifies it in the
+    // frame cache and the atlas.
+    struct ResolvedFrame {
+        const quint32* sheets = nullptr; // width * height sprite ids
+        int width = 1;
+        int height = 1;
+        quint64 key = 0;
+    };
+    bool resolveFrame(quint32 gameSpriteId, int frame, int patternX, int patternY, int patternZ, int layer, ResolvedFrame& resolved) const;
+    QImage frameImage(const ResolvedFrame& resolved);
 
     ClientVersionData versionData_;
     bool assetsLoaded_ = false;
 
-    QMap<quint32, QSharedPointer<GameSpriteData>> gameSpriteMetadataCache_;
-    QMap<quint32, QByteArray> sprSheetRleDataCache_; // Alternative: QMap<quint32, quint32> sprSheetAddresses_;
+    GameSpriteTable gameSprites_;
+    // The SPR file stays open and mapped while assets are loaded; sprites are read from it by
+    // offset. sprContents_ only holds the file if mapping it failed.
+    QFile sprFile_;
+    const uchar* sprData_ = nullptr;
+    qint64 sprSize_ = 0;
+    QByteArray sprContents_;
+    QVector<quint32> sprSheetAddresses_; // Indexed by sprite id; [0] is unused, 0 means transparent
+
+    QCache<quint32, QImage> spriteImageCache_; // Decoded sprites by id, cost = image bytes
+    quint64 spriteCacheHits_ = 0;
+    quint64 spriteCacheMisses_ = 0;
+    QCache<quint64, QImage> frameImageCache_; // Composited frames by ResolvedFrame::key, cost = image bytes
+    SpriteAtlas atlas_;                        // Frames by ResolvedFrame::key
 
     quint32 sprSignature_ = 0;
     quint32 sprSpriteCount_ = 0;
@@ -164,6 +260,19 @@ private:
     quint16 datMissileCount_ = 0;
 };
 
+inline int SpriteManager::gameSpriteSlot(quint32 gameSpriteId) const {
+    if (gameSpriteId >= MissileIdBase) {
+        return gameSpriteId - MissileIdBase < datMissileCount_ ? int(datItemCount_ + datOutfitCount_ + datEffectCount_ + (gameSpriteId - MissileIdBase)) : -1;
+    }
+    if (gameSpriteId >= EffectIdBase) {
+        return gameSpriteId - EffectIdBase < datEffectCount_ ? int(datItemCount_ + datOutfitCount_ + (gameSpriteId - EffectIdBase)) : -1;
+    }
+    if (gameSpriteId >= OutfitIdBase) {
+        return gameSpriteId - OutfitIdBase < datOutfitCount_ ? int(datItemCount_ + (gameSpriteId - OutfitIdBase)) : -1;
+    }
+    return gameSpriteId >= ItemIdBase && gameSpriteId - ItemIdBase < datItemCount_ ? int(gameSpriteId - ItemIdBase) : -1;
+}
+
 // Needed if DatFormat and SpriteDatFlags are Q_ENUM/Q_FLAG'd within SpriteManager
 // Q_DECLARE_METATYPE(SpriteManager::DatFormat)
 // Q_DECLARE_METATYPE(SpriteManager::SpriteDatFlags)
@@ -0,0 +1,260 @@
+#include "SpriteRleDecoder.h"
+#include <QRgb>
+#include <cstring> // For memset
+
+// The SIMD paths are compiled for x86 whatever the compiler targets by default, each
+// function for its own instruction set, and picked at run time from what the CPU supports.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SPRITERLE_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h> // For __cpuid/__cpuidex
+#define SPRITERLE_TARGET(isa) // MSVC compiles intrinsics of any instruction set as they are
+#else
+#define SPRITERLE_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace {
+
+inline quint16 readU16(const uchar* p) {
+    return static_cast<quint16>(p[0]) | (static_cast<quint16>(p[1]) << 8);
+}
+
+// --- Scalar colored runs ---
+
+void expandRgbScalar(const uchar* in, quint32* out, int count) {
+    for (int i = 0; i < count; ++i, in += 3) {
+        out[i] = qRgb(in[0], in[1], in[2]);
+    }
+}
+
+void expandRgbaScalar(const uchar* in, quint32* out, int count) {
+    for (int i = 0; i < count; ++i, in += 4) {
+        const quint8 alpha = in[3];
+        // Most sprite pixels are opaque; qPremultiply would leave them unchanged anyway.
+        out[i] = alpha == 255 ? qRgb(in[0], in[1], in[2]) : qPremultiply(qRgba(in[0], in[1], in[2], alpha));
+    }
+}
+
+// --- SIMD colored runs ---
+// The pixels are R, G, B, A in memory, i.e. 0xAABBGGRR as little-endian words; ARGB32 wants
+// 0xAARRGGBB. Swapping the 16-bit halves of the R/B bytes moves R and B into place. The
+// premultiplication matches qPremultiply(): t = c * a, result (t + (t >> 8) + 128) >> 8,
+// with the alpha lane multiplied by 255 so it comes out unchanged.
+
+#if defined(SPRITERLE_X86)
+SPRITERLE_TARGET("avx2") inline __m256i swapRedBlue(__m256i px) {
+    const __m256i ag = _mm256_and_si256(px, _mm256_set1_epi32(int(0xFF00FF00)));
+    __m256i rb = _mm256_and_si256(px, _mm256_set1_epi32(0x00FF00FF));
+    rb = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(rb, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm256_or_si256(ag, rb);
+}
+
+SPRITERLE_TARGET("avx2") inline __m256i premultiplyWords(__m256i px) {
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(px, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    const __m256i alphaLane = _mm256_set1_epi64x(0x00FF000000000000LL);
+    alpha = _mm256_or_si256(_mm256_andnot_si256(_mm256_set1_epi64x(0xFFFF000000000000LL), alpha), alphaLane);
+    const __m256i t = _mm256_mullo_epi16(px, alpha);
+    return _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), _mm256_set1_epi16(128)), 8);
+}
+
+SPRITERLE_TARGET("avx2") int expandRgbaAvx2(const uchar* in, quint32* out, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i px = swapRedBlue(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i * 4)));
+        const __m256i opaque = _mm256_cmpeq_epi8(_mm256_or_si256(px, _mm256_set1_epi32(0x00FFFFFF)), _mm256_set1_epi32(-1));
+        if (_mm256_movemask_epi8(opaque) != -1) {
+            const __m256i zero = _mm256_setzero_si256();
+            px = _mm256_packus_epi16(premultiplyWords(_mm256_unpacklo_epi8(px, zero)),
+                                     premultiplyWords(_mm256_unpackhi_epi8(px, zero)));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), px);
+    }
+    return i;
+}
+
+SPRITERLE_TARGET("sse2") inline __m128i swapRedBlue(__m128i px) {
+    const __m128i ag = _mm_and_si128(px, _mm_set1_epi32(int(0xFF00FF00)));
+    __m128i rb = _mm_and_si128(px, _mm_set1_epi32(0x00FF00FF));
+    rb = _mm_shufflehi_epi16(_mm_shufflelo_epi16(rb, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_or_si128(ag, rb);
+}
+
+SPRITERLE_TARGET("sse2") inline __m128i premultiplyWords(__m128i px) {
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(px, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128i alphaLane = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+    alpha = _mm_or_si128(_mm_andnot_si128(_mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0), alpha), alphaLane);
+    const __m128i t = _mm_mullo_epi16(px, alpha);
+    return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), _mm_set1_epi16(128)), 8);
+}
+
+SPRITERLE_TARGET("sse2") int expandRgbaSse2(const uchar* in, quint32* out, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i px = swapRedBlue(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 4)));
+        const __m128i opaque = _mm_cmpeq_epi8(_mm_or_si128(px, _mm_set1_epi32(0x00FFFFFF)), _mm_set1_epi32(-1));
+        if (_mm_movemask_epi8(opaque) != 0xFFFF) {
+            const __m128i zero = _mm_setzero_si128();
+            px = _mm_packus_epi16(premultiplyWords(_mm_unpacklo_epi8(px, zero)),
+                                  premultiplyWords(_mm_unpackhi_epi8(px, zero)));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), px);
+    }
+    return i;
+}
+
+// Four RGB pixels (12 bytes) to ARGB32 with one shuffle. Reads 16 bytes, so the caller
+// keeps the last 4 bytes of every load inside the run.
+SPRITERLE_TARGET("ssse3") int expandRgbSsse3(const uchar* in, quint32* out, int count) {
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    const __m128i opaque = _mm_set1_epi32(int(0xFF000000));
+    int i = 0;
+    for (; i + 6 <= count; i += 4) { // 16-byte load needs 16 / 3 + 1 pixels of input
+        const __m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), opaque));
+    }
+    return i;
+}
+
+// Whole runs: the SIMD loop, then the scalar code for the last few pixels.
+void expandRgbSsse3Run(const uchar* in, quint32* out, int count) {
+    const int done = expandRgbSsse3(in, out, count);
+    expandRgbScalar(in + done * 3, out + done, count - done);
+}
+
+void expandRgbaSse2Run(const uchar* in, quint32* out, int count) {
+    const int done = expandRgbaSse2(in, out, count);
+    expandRgbaScalar(in + done * 4, out + done, count - done);
+}
+
+void expandRgbaAvx2Run(const uchar* in, quint32* out, int count) {
+    int done = expandRgbaAvx2(in, out, count);
+    done += expandRgbaSse2(in + done * 4, out + done, count - done);
+    expandRgbaScalar(in + done * 4, out + done, count - done);
+}
+
+struct CpuFeatures {
+    bool sse2 = false;
+    bool ssse3 = false;
+    bool avx2 = false;
+};
+
+CpuFeatures detectCpuFeatures() {
+    CpuFeatures features;
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    features.sse2 = (info[3] & (1 << 26)) != 0;
+    features.ssse3 = (info[2] & (1 << 9)) != 0;
+    // AVX2 also needs the OS to save the YMM registers (OSXSAVE, then XCR0 bits 1 and 2).
+    const bool osAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    if (maxLeaf >= 7 && osAvx) {
+        __cpuidex(info, 7, 0);
+        features.avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    features.sse2 = __builtin_cpu_supports("sse2");
+    features.ssse3 = __builtin_cpu_supports("ssse3");
+    features.avx2 = __builtin_cpu_supports("avx2");
+#endif
+    return features;
+}
+#endif // SPRITERLE_X86
+
+using ExpandRun = void (*)(const uchar* in, quint32* out, int count);
+
+// The colored run expanders decode() uses, chosen once for the CPU it runs on.
+struct Expanders {
+    ExpandRun rgb = expandRgbScalar;
+    ExpandRun rgba = expandRgbaScalar;
+    const char* instructionSet = "scalar";
+};
+
+Expanders selectExpanders() {
+    Expanders expanders;
+#if defined(SPRITERLE_X86)
+    const CpuFeatures cpu = detectCpuFeatures();
+    if (cpu.sse2) {
+        expanders.rgba = expandRgbaSse2Run;
+        expanders.instructionSet = "SSE2";
+    }
+    if (cpu.ssse3) {
+        expanders.rgb = expandRgbSsse3Run;
+        expanders.instructionSet = "SSSE3";
+    }
+    if (cpu.avx2) {
+        expanders.rgba = expandRgbaAvx2Run;
+        expanders.instructionSet = "AVX2";
+    }
+#endif
+    return expanders;
+}
+
+const Expanders& expanders() {
+    static const Expanders selected = selectExpanders();
+    return selected;
+}
+
+bool decodeRuns(QByteArrayView rleData, bool hasAlpha, quint32* out, ExpandRun expand) {
+    const uchar* in = reinterpret_cast<const uchar*>(rleData.data());
+    const qsizetype size = rleData.size();
+    const int bytesPerPixel = hasAlpha ? 4 : 3;
+    constexpr int PixelCount = SpriteRleDecoder::PixelCount;
+
+    qsizetype pos = 0;
+    int pixel = 0;
+    bool complete = true;
+    while (pos < size && pixel < PixelCount) {
+        if (size - pos < 2) {
+            complete = false;
+            break;
+        }
+        int transparent = readU16(in + pos);
+        pos += 2;
+        if (transparent > PixelCount - pixel) {
+            transparent = PixelCount - pixel;
+            complete = false;
+        }
+        memset(out + pixel, 0, transparent * sizeof(quint32));
+        pixel += transparent;
+        if (pixel >= PixelCount || pos >= size) {
+            break; // A trailing transparent run needs no colored count
+        }
+
+        if (size - pos < 2) {
+            complete = false;
+            break;
+        }
+        const int colored = readU16(in + pos);
+        pos += 2;
+        const int count = int(qMin<qsizetype>(qMin(colored, PixelCount - pixel), (size - pos) / bytesPerPixel));
+        expand(in + pos, out + pixel, count);
+        pos += qsizetype(count) * bytesPerPixel;
+        pixel += count;
+        if (count < colored) {
+            complete = false;
+            break;
+        }
+    }
+    memset(out + pixel, 0, (PixelCount - pixel) * sizeof(quint32));
+    return complete;
+}
+
+} // namespace
+
+bool SpriteRleDecoder::decode(QByteArrayView rleData, bool hasAlpha, quint32* out) {
+    const Expanders& expand = expanders();
+    return decodeRuns(rleData, hasAlpha, out, hasAlpha ? expand.rgba : expand.rgb);
+}
+
+bool SpriteRleDecoder::decodeScalar(QByteArrayView rleData, bool hasAlpha, quint32* out) {
+    return decodeRuns(rleData, hasAlpha, out, hasAlpha ? expandRgbaScalar : expandRgbScalar);
+}
+
+const char* SpriteRleDecoder::instructionSet() {
+    return expanders().instructionSet;
+}
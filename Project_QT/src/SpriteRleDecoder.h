@@ -0,0 +1,32 @@
+#ifndef SPRITERLEDECODER_H
+#define SPRITERLEDECODER_H
+
+#include <QByteArrayView>
+#include <QtGlobal>
+
+// Decodes the RLE data of one 32x32 SPR sprite into premultiplied ARGB32 pixels
+// (QImage::Format_ARGB32_Premultiplied).
+//
+// The data is a sequence of { u16 transparent count, u16 colored count, colored pixels }
+// where each colored pixel is R, G, B (and A when hasAlpha). Every run is bounds-checked
+// once; transparent runs become memset fills and colored runs are converted several
+// pixels at a time: with AVX2 (8 pixels) or SSE2 (4 pixels) for RGBA, and SSSE3 (4 pixels)
+// for RGB. All of these are built into every x86 binary and the best one the CPU supports
+// is picked on first use; elsewhere decode() falls back to decodeScalar(), which produces
+// identical output.
+class SpriteRleDecoder {
+public:
+    static constexpr int SpriteSize = 32;
+    static constexpr int PixelCount = SpriteSize * SpriteSize;
+
+    // Writes all PixelCount pixels of out; pixels not covered by the data are transparent.
+    // Returns false if the data is truncated or runs past the end of the sprite (out then
+    // holds everything decoded up to that point).
+    static bool decode(QByteArrayView rleData, bool hasAlpha, quint32* out);
+    static bool decodeScalar(QByteArrayView rleData, bool hasAlpha, quint32* out);
+
+    // Name of the widest instruction set decode() uses on this CPU ("AVX2", ..., "scalar").
+    static const char* instructionSet();
+};
+
+#endif // SPRITERLEDECODER_H
@@ -0,0 +1,177 @@
+#include "StartupTaskGraph.h"
+#include "ItemManager.h"
+#include "CreatureManager.h"
+#include "SpriteManager.h"
+#include <QThreadPool>
+#include <QMutexLocker>
+#include <QDebug>
+#include <utility> // For std::as_const
+
+int StartupTaskGraph::addTask(const QString& name, TaskFunction function, const QVector<int>& dependencies) {
+    const int id = tasks_.size();
+    Task task;
+    task.name = name;
+    task.function = std::move(function);
+    for (int dependency : dependencies) {
+        if (dependency < 0 || dependency >= id) {
+            qWarning() << "StartupTaskGraph::addTask - Stage" << name << "depends on unknown stage" << dependency;
+            continue;
+        }
+        tasks_[dependency].dependents.append(id);
+        ++task.dependencyCount;
+    }
+    tasks_.append(std::move(task));
+    return id;
+}
+
+bool StartupTaskGraph::run(int maxThreads) {
+    QThreadPool pool;
+    if (maxThreads > 0) {
+        pool.setMaxThreadCount(maxThreads);
+    }
+    clock_.start();
+
+    QMutexLocker locker(&mutex_);
+    pool_ = &pool;
+    remaining_ = tasks_.size();
+    for (Task& task : tasks_) {
+        task.state = State::Waiting;
+        task.pendingDependencies = task.dependencyCount;
+    }
+    for (int task = 0; task < tasks_.size(); ++task) {
+        if (tasks_.at(task).pendingDependencies == 0) {
+            startTask(task);
+        }
+    }
+    while (remaining_ > 0) {
+        changed_.wait(&mutex_);
+    }
+    locker.unlock();
+
+    pool.waitForDone(); // The last workers may still be returning
+    pool_ = nullptr;
+    elapsedMs_ = clock_.elapsed();
+
+    for (const Task& task : std::as_const(tasks_)) {
+        if (task.state != State::Succeeded) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void StartupTaskGraph::startTask(int task) {
+    tasks_[task].state = State::Running;
+    pool_->start([this, task]() {
+        const qint64 startMs = clock_.elapsed();
+        const TaskFunction& function = tasks_.at(task).function; // tasks_ is not resized while running
+        const bool succeeded = function ? function() : true;
+        finishTask(task, succeeded, startMs, clock_.elapsed() - startMs);
+    });
+}
+
+void StartupTaskGraph::finishTask(int task, bool succeeded, qint64 startMs, qint64 durationMs) {
+    QMutexLocker locker(&mutex_);
+    Task& finished = tasks_[task];
+    finished.state = succeeded ? State::Succeeded : State::Failed;
+    finished.startMs = startMs;
+    finished.durationMs = durationMs;
+    --remaining_;
+
+    if (!succeeded) {
+        skipDependents(task);
+    } else {
+        for (int dependent : std::as_const(finished.dependents)) {
+            Task& next = tasks_[dependent];
+            if (next.state == State::Waiting && --next.pendingDependencies == 0) {
+                startTask(dependent);
+            }
+        }
+    }
+    changed_.wakeAll();
+}
+
+void StartupTaskGraph::skipDependents(int task) {
+    for (int dependent : std::as_const(tasks_.at(task).dependents)) {
+        Task& skipped = tasks_[dependent];
+        if (skipped.state == State::Waiting) {
+            skipped.state = State::Skipped;
+            --remaining_;
+            skipDependents(dependent);
+        }
+    }
+}
+
+QVector<StartupTaskGraph::TaskTiming> StartupTaskGraph::timings() const {
+    QMutexLocker locker(&mutex_);
+    QVector<TaskTiming> result;
+    result.reserve(tasks_.size());
+    for (const Task& task : tasks_) {
+        TaskTiming timing;
+        timing.name = task.name;
+        timing.startMs = task.startMs;
+        timing.durationMs = task.durationMs;
+        timing.succeeded = task.state == State::Succeeded;
+        timing.skipped = task.state == State::Skipped;
+        result.append(timing);
+    }
+    return result;
+}
+
+void StartupTaskGraph::logTimings() const {
+    qint64 sequentialMs = 0;
+    for (const TaskTiming& timing : timings()) {
+        if (timing.skipped) {
+            qDebug().noquote() << "Startup:" << timing.name << "skipped (a stage it needs failed)";
+            continue;
+        }
+        qDebug().noquote() << "Startup:" << timing.name << (timing.succeeded ? "took" : "failed after")
+                           << timing.durationMs << "ms, started at" << timing.startMs << "ms";
+        sequentialMs += timing.durationMs;
+    }
+    qDebug() << "Startup: all stages done in" << elapsedMs_ << "ms (" << sequentialMs << "ms if run one after another)";
+}
+
+bool loadStartupData(const StartupDataSources& sources, QStringList& warnings) {
+    StartupTaskGraph graph;
+
+    int itemsStage = -1;
+    if (sources.items && !sources.itemsOtbPath.isEmpty()) {
+        itemsStage = graph.addTask(QStringLiteral("items"), [&sources]() {
+            return sources.items->loadDefinitions(sources.itemsOtbPath, sources.itemsXmlPath);
+        });
+    }
+    if (sources.creatures && !sources.creaturesXmlPath.isEmpty()) {
+        graph.addTask(QStringLiteral("creatures"), [&sources]() {
+            return sources.creatures->loadCreaturesFromXml(sources.creaturesXmlPath);
+        });
+    }
+    QString spriteError;
+    QStringList spriteWarnings;
+    if (sources.sprites && sources.clientVersion) {
+        graph.addTask(QStringLiteral("sprites"), [&sources, &spriteError, &spriteWarnings]() {
+            return sources.sprites->loadAssets(*sources.clientVersion, spriteError, spriteWarnings);
+        });
+    }
+    if (sources.loadBrushes) {
+        // Brushes look up the item types they place (and register themselves on them).
+        graph.addTask(QStringLiteral("brushes"), sources.loadBrushes,
+                      itemsStage >= 0 ? QVector<int>{itemsStage} : QVector<int>{});
+    }
+
+    const bool succeeded = graph.run();
+    graph.logTimings();
+
+    warnings += spriteWarnings;
+    if (!spriteError.isEmpty()) {
+        warnings.append(spriteError);
+    }
+    for (const StartupTaskGraph::TaskTiming& timing : graph.timings()) {
+        if (timing.skipped) {
+            warnings.append(QStringLiteral("Startup stage '%1' was skipped because a stage it needs failed.").arg(timing.name));
+        } else if (!timing.succeeded) {
+            warnings.append(QStringLiteral("Startup stage '%1' failed.").arg(timing.name));
+        }
+    }
+    return succeeded;
+}
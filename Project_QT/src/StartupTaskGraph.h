@@ -0,0 +1,89 @@
+#ifndef STARTUPTASKGRAPH_H
+#define STARTUPTASKGRAPH_H
+
+#include <QString>
+#include <QVector>
+#include <QStringList>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <functional>
+
+class QThreadPool;
+class ItemManager;
+class CreatureManager;
+class SpriteManager;
+struct ClientVersionData;
+
+// Runs startup stages on a thread pool, each as soon as the stages it depends on are done,
+// so independent loaders (items, creatures, sprites, ...) overlap and startup takes about as
+// long as the longest chain instead of the sum of all stages.
+//
+// A stage may only depend on stages added before it, which keeps the graph acyclic. A stage
+// that returns false fails; everything that depends on it is skipped, the rest still runs.
+// Stage functions run on pool threads: they must not touch widgets, and QObjects they create
+// belong to that thread (move them before returning if the GUI thread needs them).
+class StartupTaskGraph {
+public:
+    using TaskFunction = std::function<bool()>;
+
+    struct TaskTiming {
+        QString name;
+        qint64 startMs = 0;    // Since run() started
+        qint64 durationMs = 0;
+        bool succeeded = false;
+        bool skipped = false;  // A dependency failed, so the stage never ran
+    };
+
+    int addTask(const QString& name, TaskFunction function, const QVector<int>& dependencies = {});
+
+    // Blocks until every stage has finished or been skipped. Returns true if all succeeded.
+    bool run(int maxThreads = -1);
+
+    QVector<TaskTiming> timings() const;
+    qint64 elapsedMs() const { return elapsedMs_; }
+    void logTimings() const; // One qDebug line per stage plus the total
+
+private:
+    enum class State { Waiting, Running, Succeeded, Failed, Skipped };
+    struct Task {
+        QString name;
+        TaskFunction function;
+        QVector<int> dependents;
+        int dependencyCount = 0;
+        int pendingDependencies = 0;
+        State state = State::Waiting;
+        qint64 startMs = 0;
+        qint64 durationMs = 0;
+    };
+
+    void startTask(int task); // mutex_ held
+    void finishTask(int task, bool succeeded, qint64 startMs, qint64 durationMs); // On the worker that ran it
+    void skipDependents(int task); // mutex_ held
+
+    QVector<Task> tasks_;
+    QThreadPool* pool_ = nullptr; // While run() is active
+    int remaining_ = 0;           // Neither finished nor skipped; mutex_ held
+    mutable QMutex mutex_;
+    QWaitCondition changed_;
+    QElapsedTimer clock_;
+    qint64 elapsedMs_ = 0;
+};
+
+// The editor's data loading stages wired into a graph. Items, creatures and sprites do not
+// depend on each other and load in parallel; loadBrushes (brush and material XML) needs
+// the item types and runs once they are in. Empty paths and null callbacks leave their stage
+// out. The managers must already exist (create singletons on the GUI thread first).
+struct StartupDataSources {
+    QString itemsOtbPath;
+    QString itemsXmlPath;
+    QString creaturesXmlPath;
+    const ClientVersionData* clientVersion = nullptr;
+    ItemManager* items = nullptr;
+    CreatureManager* creatures = nullptr;
+    SpriteManager* sprites = nullptr;
+    std::function<bool()> loadBrushes;
+};
+bool loadStartupData(const StartupDataSources& sources, QStringList& warnings);
+
+#endif // STARTUPTASKGRAPH_H
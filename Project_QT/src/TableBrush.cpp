@@ -357,7 +357,7 @@ void TableBrush::draw(Map* map, Tile* tile, void* parameter) {
             //     newItem->setActionID(g_gui.GetCurrentActionID());
             // }
             tile->addItem(newItem);
-            map->markModified();
+            map->markModified(tile);
         }
     }
 }
@@ -365,21 +365,19 @@ void TableBrush::draw(Map* map, Tile* tile, void* parameter) {
 void TableBrush::undraw(Map* map, Tile* tile) {
     if (!map || !tile) return;
 
-    QMutableListIterator<Item*> it(tile->getItemsForWrite()); // Assuming Tile provides this for modification
     bool changed = false;
-    while (it.hasNext()) {
-        Item* item = it.next();
+    for (int i = tile->getItems().size() - 1; i >= 0; --i) {
+        Item* item = tile->getItems().at(i);
         if (item && item->isTable()) {
             Brush* itemBrush = item->getBrush();
             if (itemBrush == this) { // Check if it's the same brush instance
-                it.remove();
-                delete item;
+                tile->removeItem(item); // Deletes it, updates HasTable and marks the tile modified
                 changed = true;
             }
         }
     }
     if (changed) {
-        map->markModified();
+        map->markModified(tile);
         // tile->update(); // Assuming update might be needed, e.g. to clear TILESTATE_HAS_TABLE
                         // This depends on how Tile::hasTable() is determined.
                         // If hasTable() checks items, removing items is enough.
@@ -469,7 +467,7 @@ void TableBrush::doTables(Map* map, Tile* tile) {
             item->setID(newItemId);
             // If setID also implies visual/property changes that need broader updates:
             // item->transform(newItemId); // or similar method if simple setID is not enough
-            map->markModified();
+            map->markModified(tile);
             // tile->update(); // If the tile needs explicit update after item change
         }
     }
@@ -519,7 +517,6 @@ bool Tile::hasTable() const { // Example logic
 }
 void Tile::addItem(Item* item) { items_list_member.append(item); } // Example
 Item* Map::getTile(int x, int y, int z) { return nullptr; } // Example
-void Map::markModified() {} // Example
 int Map::getCurrentFloor() const { return 0; } // Example
 
 bool Item::isTable() const { return false; } // Example
@@ -5,37 +5,68 @@
 #include "TableBrush.h"
 #include "CarpetBrush.h"
 #include "DrawingOptions.h"
+#include "SpriteAtlas.h" // Flushed before anything painted directly
 #include <QPainter>
 #include <QColor>
 #include <QDebug>
 #include <algorithm>
-#include <QMutableVectorIterator>
 
 // Constructor
-Tile::Tile(int x, int y, int z, QObject *parent) 
-    : QObject(parent), 
-      x_(x), y_(y), z_(z),
-      ground_(nullptr),
-      creature_(nullptr),
-      spawn_(nullptr),
-      houseId_(0),
-      mapFlags_(TileMapFlag::NoFlag),
-      stateFlags_(TileStateFlag::NoState) {
+Tile::Tile(MapChunk* chunk, int slot)
+    : chunk_(chunk),
+      slot_(static_cast<quint16>(slot)) {
 }
 
+static_assert(sizeof(Tile) <= MapArena::MaxObjectSize, "Tiles must be block-allocated for MapArena::arenaOf");
+
 // Destructor
 Tile::~Tile() {
+    if (hasFinalizer_) {
+        if (MapArena* arena = MapArena::arenaOf(this)) {
+            arena->removeFinalizer(this);
+        }
+    }
     delete ground_;
     ground_ = nullptr; 
     qDeleteAll(items_);
     items_.clear();
     delete creature_;
     creature_ = nullptr;
+    if (chunk_) {
+        chunk_->zoneIds.remove(slot_); // Zone ids belong to this tile, drop them from the side table
+    }
 }
 
 // Coordinate Getters
 MapPos Tile::mapPos() const {
-    return MapPos(x_, y_, z_);
+    return MapPos(x(), y(), z());
+}
+
+void Tile::notifyChanged(bool visual) {
+    if (Map* map = getMap()) {
+        map->notifyTileChanged(x(), y(), z(), visual);
+    }
+}
+
+void Tile::trackHeapState() {
+    if (hasFinalizer_ || (!creature_ && items_.capacity() <= InlineItemCount)) {
+        return;
+    }
+    if (MapArena* arena = MapArena::arenaOf(this)) {
+        arena->addFinalizer(this, &Tile::finalize);
+        hasFinalizer_ = true;
+    }
+}
+
+void Tile::finalize(void* object) {
+    // The items have finalizers of their own where needed; only the tile's own heap memory
+    // is released here, the tile and its items go with the arena.
+    Tile* tile = static_cast<Tile*>(object);
+    tile->hasFinalizer_ = false;
+    delete tile->creature_;
+    tile->creature_ = nullptr;
+    tile->items_.clear();
+    tile->items_.squeeze(); // Back to the inline storage, freeing the heap buffer
 }
 
 // Item/Creature Management
@@ -48,9 +79,8 @@ void Tile::addItem(Item* item) {
         setGround(item);
     } else {
         items_.append(item);
-        if (item->parent() != this) {
-           item->setParent(this); 
-        }
+        item->setOwnerTile(this);
+        trackHeapState();
         if (item && item->isTable()) {
             setStateFlag(TileStateFlag::HasTable, true);
         }
@@ -58,8 +88,8 @@ void Tile::addItem(Item* item) {
             setStateFlag(TileStateFlag::HasCarpet, true);
         }
         setModified(true);
-        emit tileChanged(x_, y_, z_);
-        // visualChanged is handled by setStateFlag if the flag causes a visual change
+        notifyChanged();
+        // Visual notification is handled by setStateFlag if the flag causes a visual change
     }
 }
 
@@ -71,14 +101,14 @@ bool Tile::removeItem(Item* item) {
         delete ground_;
         ground_ = nullptr;
         setModified(true);
-        emit tileChanged(x_, y_, z_);
-        emit visualChanged(x_, y_, z_); // Ground change is always visual
+        notifyChanged(true); // Ground change is always visual
         return true;
     }
 
     int index = items_.indexOf(item);
     if (index != -1) {
-        Item* removedItem = items_.takeAt(index);
+        Item* removedItem = items_.at(index);
+        items_.remove(index);
         bool wasTable = removedItem && removedItem->isTable();
         bool wasCarpet = removedItem && removedItem->isCarpet();
         delete removedItem;
@@ -94,8 +124,8 @@ bool Tile::removeItem(Item* item) {
             }
         }
         setModified(true);
-        emit tileChanged(x_, y_, z_);
-        // visualChanged is handled by setStateFlag if flags changed
+        notifyChanged();
+        // Visual notification is handled by setStateFlag if flags changed
         return true;
     }
     return false;
@@ -105,8 +135,9 @@ Item* Tile::removeItem(int index) {
     if (index < 0 || index >= items_.size()) {
         return nullptr;
     }
-    Item* item = items_.takeAt(index);
-    item->setParent(nullptr);
+    Item* item = items_.at(index);
+    items_.remove(index);
+    item->setOwnerTile(nullptr);
 
     if (item && item->isTable()) {
         if (!getTable()) {
@@ -119,8 +150,8 @@ Item* Tile::removeItem(int index) {
         }
     }
     setModified(true);
-    emit tileChanged(x_, y_, z_);
-    // visualChanged is handled by setStateFlag if flags changed
+    notifyChanged();
+    // Visual notification is handled by setStateFlag if flags changed
     return item;
 }
 
@@ -128,23 +159,22 @@ void Tile::setGround(Item* groundItem) {
     if (ground_ == groundItem) return;
     delete ground_;
     ground_ = groundItem;
-    if (ground_ && ground_->parent() != this) {
-        ground_->setParent(this);
+    if (ground_) {
+        ground_->setOwnerTile(this);
     }
     setModified(true);
-    emit tileChanged(x_, y_, z_);
-    emit visualChanged(x_, y_, z_); // Ground change is always visual
+    notifyChanged(true); // Ground change is always visual
 }
 
 Item* Tile::getGround() const {
     return ground_;
 }
 
-const QVector<Item*>& Tile::items() const {
+const Tile::ItemList& Tile::items() const {
     return items_;
 }
 
-QVector<Item*>& Tile::items() {
+Tile::ItemList& Tile::items() {
     return items_;
 }
 
@@ -155,13 +185,10 @@ Creature* Tile::creature() const {
 void Tile::setCreature(Creature* newCreature) {
     if (creature_ == newCreature) return;
     delete creature_;
-    creature_ = newCreature;
-    if (creature_ && creature_->parent() != this) {
-        creature_->setParent(this);
-    }
+    creature_ = newCreature; // Owned by the tile, deleted in ~Tile
+    trackHeapState();
     setModified(true);
-    emit tileChanged(x_, y_, z_);
-    emit visualChanged(x_, y_, z_); // Creature change is visual
+    notifyChanged(true); // Creature change is visual
 }
 
 Spawn* Tile::spawn() const {
@@ -171,8 +198,7 @@ Spawn* Tile::spawn() const {
 void Tile::setSpawn(Spawn* newSpawn) {
     if (spawn_ == newSpawn) return;
     spawn_ = newSpawn;
-    emit tileChanged(x_, y_, z_); 
-    emit visualChanged(x_, y_, z_); // Spawn visibility might change
+    notifyChanged(true); // Spawn visibility might change
 }
 
 QList<Item*> Tile::getWallItems() const {
@@ -189,15 +215,15 @@ void Tile::clearWalls() {
     bool changed = false;
     for (int i = items_.size() - 1; i >= 0; --i) {
         if (items_[i] && items_[i]->isWall()) {
-            Item* removedItem = items_.takeAt(i);
+            Item* removedItem = items_.at(i);
+            items_.remove(i);
             delete removedItem;
             changed = true;
         }
     }
     if (changed) {
         setModified(true);
-        emit tileChanged(x_, y_, z_);
-        emit visualChanged(x_, y_, z_);
+        notifyChanged(true);
     }
     qDebug() << "Tile::clearWalls called for" << mapPos();
 }
@@ -207,6 +233,7 @@ void Tile::addWallItemById(quint16 wallItemId) {
         qWarning() << "Tile::addWallItemById: Attempted to add wall with ID 0 to" << mapPos();
         return;
     }
+    MapArena::Scope arenaScope(getMap() ? &getMap()->arena() : nullptr);
     Item* wallItem = new Item(wallItemId);
     if (wallItem) {
         if (!wallItem->isWall()) {
@@ -223,8 +250,8 @@ void Tile::removeGround() {
     if (ground_) {
         delete ground_;
         ground_ = nullptr;
-        emit tileChanged(x_, y_, z_);
-        emit visualChanged(x_, y_, z_);
+        setModified(true);
+        notifyChanged(true);
         qDebug() << "Tile::removeGround called for" << mapPos();
     }
 }
@@ -234,6 +261,7 @@ void Tile::setGroundById(quint16 groundItemId) {
         removeGround();
         return;
     }
+    MapArena::Scope arenaScope(getMap() ? &getMap()->arena() : nullptr);
     Item* newGround = new Item(groundItemId);
     if (newGround) {
         if (!newGround->isGroundTile()) {
@@ -295,7 +323,7 @@ void Tile::setMapFlag(TileMapFlag flag, bool on) {
     mapFlags_.setFlag(flag, on);
     if (oldFlags != mapFlags_) {
         setModified(true);
-        emit tileChanged(x_, y_, z_);
+        notifyChanged();
     }
 }
 
@@ -312,20 +340,18 @@ void Tile::setStateFlag(TileStateFlag flag, bool on) {
     stateFlags_.setFlag(flag, on);
      if (oldFlags != stateFlags_) {
        if (flag == TileStateFlag::Modified && on) {
-           Map* map = qobject_cast<Map*>(parent());
+           Map* map = getMap();
            if (map) {
                map->setModified(true);
            }
        }
-        emit tileChanged(x_, y_, z_); 
-        if (flag == TileStateFlag::Selected ||
-            flag == TileStateFlag::Modified ||
-            flag == TileStateFlag::Blocking ||
-            flag == TileStateFlag::HasTable ||
-            flag == TileStateFlag::HasCarpet ||
-            flag == TileStateFlag::OptionalBorder) { // Added OptionalBorder here
-             emit visualChanged(x_,y_,z_);
-        }
+        const bool visual = (flag == TileStateFlag::Selected ||
+                             flag == TileStateFlag::Modified ||
+                             flag == TileStateFlag::Blocking ||
+                             flag == TileStateFlag::HasTable ||
+                             flag == TileStateFlag::HasCarpet ||
+                             flag == TileStateFlag::OptionalBorder); // Added OptionalBorder here
+        notifyChanged(visual);
     }
 }
 
@@ -359,7 +385,15 @@ bool Tile::isPVPZone() const { return hasMapFlag(TileMapFlag::PVPZone); }
 void Tile::setPVPZone(bool on) { setMapFlag(TileMapFlag::PVPZone, on); }
 
 bool Tile::isModified() const { return hasStateFlag(TileStateFlag::Modified); }
-void Tile::setModified(bool on) { setStateFlag(TileStateFlag::Modified, on); }
+void Tile::setModified(bool on) {
+    // Every modification counts, not just the first: the flag stays set across saves.
+    if (on) {
+        if (Map* map = getMap()) {
+            map->markTileAreaDirty(x(), y(), z());
+        }
+    }
+    setStateFlag(TileStateFlag::Modified, on);
+}
 
 bool Tile::isSelected() const { return hasStateFlag(TileStateFlag::Selected); }
 void Tile::setSelected(bool on) { setStateFlag(TileStateFlag::Selected, on); }
@@ -371,8 +405,7 @@ void Tile::setHouseId(quint32 id) {
     if (houseId_ != id) {
         houseId_ = id;
         setModified(true);
-        emit tileChanged(x_, y_, z_);
-        emit visualChanged(x_,y_,z_);
+        notifyChanged(true);
     }
 }
 bool Tile::isHouseTile() const {
@@ -380,38 +413,51 @@ bool Tile::isHouseTile() const {
 }
 
 void Tile::addZoneId(quint16 zoneId) {
-    if (!zoneIds_.contains(zoneId)) {
-        zoneIds_.append(zoneId);
-        std::sort(zoneIds_.begin(), zoneIds_.end());
+    if (!chunk_) {
+        qWarning() << "Tile::addZoneId: Detached tile has no zone table. Zone" << zoneId << "ignored.";
+        return;
+    }
+    QVector<quint16>& zoneIds = chunk_->zoneIds[slot_];
+    if (!zoneIds.contains(zoneId)) {
+        zoneIds.append(zoneId);
+        std::sort(zoneIds.begin(), zoneIds.end());
         setModified(true);
-        emit tileChanged(x_, y_, z_);
+        notifyChanged();
     }
 }
 bool Tile::removeZoneId(quint16 zoneId) {
-    int removedCount = zoneIds_.removeAll(zoneId); 
+    if (!chunk_) return false;
+    auto it = chunk_->zoneIds.find(slot_);
+    if (it == chunk_->zoneIds.end()) return false;
+    int removedCount = it->removeAll(zoneId); 
+    if (it->isEmpty()) {
+        chunk_->zoneIds.erase(it);
+    }
     if (removedCount > 0) {
         setModified(true);
-        emit tileChanged(x_, y_, z_);
+        notifyChanged();
         return true;
     }
     return false;
 }
 void Tile::clearZoneIds() {
-    if (!zoneIds_.isEmpty()) {
-        zoneIds_.clear();
+    if (chunk_ && chunk_->zoneIds.remove(slot_) > 0) {
         setModified(true);
-        emit tileChanged(x_, y_, z_);
+        notifyChanged();
     }
 }
 const QVector<quint16>& Tile::getZoneIds() const {
-    return zoneIds_;
+    static const QVector<quint16> noZones;
+    if (!chunk_) return noZones;
+    auto it = chunk_->zoneIds.constFind(slot_);
+    return it != chunk_->zoneIds.constEnd() ? it.value() : noZones;
 }
 bool Tile::hasZoneId(quint16 zoneId) const {
-    return zoneIds_.contains(zoneId);
+    return getZoneIds().contains(zoneId);
 }
     
 void Tile::update() {
-    qDebug() << "Tile::update() called for tile at" << x_ << "," << y_ << "," << z_;
+    qDebug() << "Tile::update() called for tile at" << x() << "," << y() << "," << z();
     
     bool newBlockingState = false;
     if (ground_ && ground_->isBlocking()) newBlockingState = true;
@@ -446,7 +492,7 @@ void Tile::update() {
     // Note: TileStateFlag::OptionalBorder is typically set explicitly by user actions,
     // not derived during update(). So, no specific update logic for it here.
 
-    emit visualChanged(x_, y_, z_);
+    notifyChanged(true);
 }
 
 // Table specific method implementations
@@ -463,14 +509,13 @@ Item* Tile::getTable() const {
 }
 void Tile::cleanTables(Map* map_param, bool dontDelete) {
     bool changed = false;
-    QMutableVectorIterator<Item*> it(items_);
-    while (it.hasNext()) {
-        Item* item = it.next();
+    for (int i = items_.size() - 1; i >= 0; --i) {
+        Item* item = items_.at(i);
         if (item && item->isTable()) {
+            items_.remove(i);
             if (dontDelete) {
-                it.remove();
+                item->setOwnerTile(nullptr);
             } else {
-                it.remove();
                 delete item;
             }
             changed = true;
@@ -482,14 +527,12 @@ void Tile::cleanTables(Map* map_param, bool dontDelete) {
         } else {
              setStateFlag(TileStateFlag::HasTable, true);
         }
+        setModified(true);
         if (map_param) {
-             map_param->markModified();
-             emit tileChanged(x_, y_, z_);
-             // visualChanged is handled by setStateFlag
-        } else {
-             emit tileChanged(x_, y_, z_);
-             // visualChanged is handled by setStateFlag
+             map_param->setModified(true);
         }
+        notifyChanged();
+        // Visual notification is handled by setStateFlag
     }
 }
 void Tile::tableize(Map* map_param) {
@@ -514,14 +557,13 @@ Item* Tile::getCarpet() const {
 }
 void Tile::cleanCarpets(Map* map_param, bool dontDelete) {
     bool changed = false;
-    QMutableVectorIterator<Item*> it(items_);
-    while (it.hasNext()) {
-        Item* item = it.next();
+    for (int i = items_.size() - 1; i >= 0; --i) {
+        Item* item = items_.at(i);
         if (item && item->isCarpet()) {
+            items_.remove(i);
             if (dontDelete) {
-                it.remove();
+                item->setOwnerTile(nullptr);
             } else {
-                it.remove();
                 delete item;
             }
             changed = true;
@@ -533,14 +575,12 @@ void Tile::cleanCarpets(Map* map_param, bool dontDelete) {
         } else {
              setStateFlag(TileStateFlag::HasCarpet, true);
         }
+        setModified(true);
         if (map_param) {
-             map_param->markModified();
-             emit tileChanged(x_, y_, z_);
-             // visualChanged is handled by setStateFlag
-        } else {
-             emit tileChanged(x_, y_, z_);
-             // visualChanged is handled by setStateFlag
+             map_param->setModified(true);
         }
+        notifyChanged();
+        // Visual notification is handled by setStateFlag
     }
 }
 void Tile::carpetize(Map* map_param) {
@@ -557,7 +597,7 @@ bool Tile::hasSetOptionalBorder() const {
 }
 
 void Tile::setOptionalBorder(bool on) {
-    // setStateFlag will emit tileChanged and visualChanged if the flag value actually changes.
+    // setStateFlag notifies the Map (tileChanged/tileVisualChanged) if the flag value actually changes.
     // The Map or BorderSystem should observe these signals to trigger border recalculation.
     setStateFlag(TileStateFlag::OptionalBorder, on);
     // Optional: Add a specific log if the flag was indeed changed to help trace border logic.
@@ -567,14 +607,21 @@ void Tile::setOptionalBorder(bool on) {
 }
 
 Map* Tile::getMap() const {
-    // Placeholder: returning nullptr. Proper implementation depends on project structure.
-    // qWarning() << "Tile::getMap() placeholder called. Actual implementation needed if Map context is required directly by Tile methods like setOptionalBorder for borderize calls.";
-    return qobject_cast<Map*>(parent()); // A common approach if Map is the parent
+    // Tiles are owned by a chunk, which knows its map. Detached tiles have no map.
+    return chunk_ ? chunk_->map : nullptr;
 }
 
 void Tile::draw(QPainter* painter, const QRectF& targetScreenRect, const DrawingOptions& options) const {
     if (!painter) return;
+    // Items only queue their frames (see DrawingOptions::spriteBatch); whatever is painted
+    // directly has to go after the frames queued before it.
+    auto flushSprites = [&]() {
+        if (options.spriteBatch) {
+            options.spriteBatch->flush(painter);
+        }
+    };
     if (options.highlightSelectedTile && isSelected()) {
+        flushSprites();
         painter->save();
         QColor selectionColor = Qt::yellow;
         selectionColor.setAlpha(80);
@@ -589,6 +636,7 @@ void Tile::draw(QPainter* painter, const QRectF& targetScreenRect, const Drawing
         DrawingOptions groundOptions = options;
         ground_->draw(painter, targetScreenRect, groundOptions);
     } else if (options.showGround) {
+        flushSprites();
         painter->save();
         painter->fillRect(targetScreenRect, QColor(50, 50, 50, 100));
         painter->restore();
@@ -602,9 +650,11 @@ void Tile::draw(QPainter* painter, const QRectF& targetScreenRect, const Drawing
         }
     }
     if (options.showCreatures && creature_) {
+        flushSprites();
         creature_->draw(painter, targetScreenRect, options);
     }
     if (options.showSpawns && spawn_) {
+        flushSprites();
         painter->save();
         painter->setBrush(QColor(128, 0, 128, 100));
         painter->setPen(Qt::NoPen);
@@ -617,6 +667,7 @@ void Tile::draw(QPainter* painter, const QRectF& targetScreenRect, const Drawing
         if (hasMapFlag(TileMapFlag::NoPVP)) flagsText += "NoPvP ";
         if (hasMapFlag(TileMapFlag::PVPZone)) flagsText += "PvP ";
         if (!flagsText.isEmpty()) {
+            flushSprites();
             painter->save();
             painter->setPen(Qt::white);
             QFont font = painter->font();
@@ -627,12 +678,13 @@ void Tile::draw(QPainter* painter, const QRectF& targetScreenRect, const Drawing
         }
     }
     if (options.drawDebugInfo) {
+        flushSprites();
         painter->save();
         QFont font = painter->font();
         font.setPointSize(7);
         painter->setFont(font);
         painter->setPen(Qt::cyan);
-        QString coordText = QString("%1,%2,%3").arg(x_).arg(y_).arg(z_);
+        QString coordText = QString("%1,%2,%3").arg(x()).arg(y()).arg(z());
         painter->drawText(targetScreenRect.adjusted(2,2,0,0), Qt::AlignTop | Qt::AlignLeft | Qt::TextDontClip, coordText);
         painter->restore();
     }
@@ -1,8 +1,8 @@
 #ifndef TILE_H
 #define TILE_H
 
-#include <QObject>
 #include <QVector>
+#include <QVarLengthArray> // Inline item storage
 #include <QFlags>     // Required for QFlags
 #include "Map.h"      // For MapPos definition (defined in Map.h in Task 11)
                       // This also makes Map class known, though not strictly needed by Tile itself.
@@ -19,10 +19,17 @@ class QPainter; // For draw method
 // MapPos is now included via Map.h
 // class Map; // Already forward declared via Map.h inclusion or defined if Map.h is fully included.
 
-class Tile : public QObject {
-    Q_OBJECT
-
+// Tiles are plain records owned by a MapChunk (see Map.h). They are deliberately not
+// QObjects: a full world holds millions of them, so a tile carries no signals, no
+// QObject parent and no coordinates of its own. Its position is derived from the
+// owning chunk and its slot in it, zone ids live in the chunk's side table, and change
+// notifications are forwarded to the owning Map (Map::tileChanged / tileVisualChanged).
+class Tile {
 public:
+    // Most tiles carry only a handful of items besides the ground; keep those inline.
+    static constexpr int InlineItemCount = 4;
+    using ItemList = QVarLengthArray<Item*, InlineItemCount>;
+
     // Based on TILESTATE_ enums from wxwidgets/tile.h
     enum class TileMapFlag : quint16 {
         NoFlag              = 0x0000,
@@ -49,13 +56,21 @@ public:
     Q_DECLARE_FLAGS(TileStateFlags, TileStateFlag)
 
 public:
-    explicit Tile(int x, int y, int z, QObject *parent = nullptr);
-    ~Tile() override;
+    Tile() = default; // Detached tile; becomes positioned once handed to Map::setTile
+    Tile(MapChunk* chunk, int slot);
+    ~Tile();
+
+    Tile(const Tile&) = delete;
+    Tile& operator=(const Tile&) = delete;
 
-    // Coordinate getters
-    int x() const { return x_; }
-    int y() const { return y_; }
-    int z() const { return z_; }
+    // Tiles live in the current MapArena (the owning map's arena while it creates them)
+    static void* operator new(size_t size) { return MapArena::current()->allocate(size); }
+    static void operator delete(void* p, size_t size) { MapArena::deallocate(p, size); }
+
+    // Coordinate getters (derived from the owning chunk; -1 for a detached tile)
+    int x() const { return chunk_ ? chunk_->baseX + (slot_ & MapChunk::Mask) : -1; }
+    int y() const { return chunk_ ? chunk_->baseY + (slot_ >> MapChunk::SizeShift) : -1; }
+    int z() const { return chunk_ ? chunk_->z : -1; }
     MapPos mapPos() const; 
 
     // Item/Creature Management
@@ -66,8 +81,9 @@ public:
     void setGround(Item* groundItem);
     Item* getGround() const;
 
-    const QVector<Item*>& items() const;
-    QVector<Item*>& items();
+    const ItemList& items() const;
+    ItemList& items();
+    const ItemList& getItems() const { return items_; } // Alias used by brushes/clipboard
     
     Creature* creature() const;
     void setCreature(Creature* creature);
@@ -122,7 +138,7 @@ public:
     void setHouseId(quint32 id);
     bool isHouseTile() const;
 
-    // Zone IDs
+    // Zone IDs (stored in the owning chunk's side table; detached tiles have none)
     void addZoneId(quint16 zoneId);
     bool removeZoneId(quint16 zoneId); 
     void clearZoneIds();
@@ -139,23 +155,32 @@ public:
     void removeGround();
     void setGroundById(quint16 groundItemId);
 
-signals:
-    void tileChanged(int x, int y, int z); 
-    void visualChanged(int x, int y, int z); 
-
 private:
-    int x_, y_, z_;
+    friend class Map; // Map attaches tiles to chunk slots
+
+    void attach(MapChunk* chunk, int slot) { chunk_ = chunk; slot_ = static_cast<quint16>(slot); }
+
+    // Replacement for the former tileChanged/visualChanged signals; forwards to the owning Map.
+    void notifyChanged(bool visual = false);
+
+    // A tile is dropped with its arena (see MapArena::drop) unless it owns memory elsewhere:
+    // a creature or an item list grown past InlineItemCount. Those register finalize().
+    void trackHeapState();
+    static void finalize(void* tile);
+
+    MapChunk* chunk_ = nullptr; // Owning chunk, provides position, zone table and Map
+    quint16 slot_ = 0;          // Index into chunk_->tiles
+
+    TileMapFlags mapFlags_ = TileMapFlag::NoFlag;
+    TileStateFlags stateFlags_ = TileStateFlag::NoState;
+    quint32 houseId_ = 0;
+    bool hasFinalizer_ = false; // Registered with its arena, see trackHeapState()
 
     Item* ground_ = nullptr;
-    QVector<Item*> items_;
     Creature* creature_ = nullptr;
     Spawn* spawn_ = nullptr;
-    quint32 houseId_ = 0;
+    ItemList items_;
 
-    TileMapFlags mapFlags_ = TileMapFlag::NoFlag;
-    TileStateFlags stateFlags_ = TileStateFlag::NoState;
-    QVector<quint16> zoneIds_;
-    
     Map* getMap() const;
 };
 
@@ -0,0 +1,386 @@
+#include "MapCompression.h"
+#include <QtEndian>
+#include <QThread>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QDebug>
+#include <cstring> // For memcpy
+#include <utility> // For std::as_const
+// For inflating gzip files not written by CompressedMapWriter: the zlib bundled with Qt
+// (Qt6::ZlibPrivate), or the system one where Qt itself was built against it.
+#if __has_include(<QtZlib/zlib.h>)
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+namespace {
+
+// gzip member layout used here:
+//   1f 8b 08 04 | mtime(4) = 0 | xfl = 0 | os = 255 | xlen(2) = 14
+//   'O' 'Z' | slen(2) = 10 | member size(4) | zlib header(2) | adler32(4)
+//   raw deflate data | crc32(4) | input size(4)
+// All gzip fields are little-endian; the zlib header and Adler-32 are kept in zlib's
+// big-endian order so they can be put back in front of/behind the deflate data as they are.
+constexpr int GzipHeaderSize = 10;
+constexpr int ExtraSize = 14;
+constexpr int MemberHeaderSize = GzipHeaderSize + 2 + ExtraSize;
+constexpr int MemberTrailerSize = 8;
+
+// Batches of this many blocks per thread are compressed together.
+constexpr int BlocksPerWorker = 2;
+
+QByteArray encodeMember(QByteArrayView raw, int level) {
+    // qCompress output: 4-byte big-endian input size, 2-byte zlib header, deflate data,
+    // 4-byte big-endian Adler-32.
+    const QByteArray zlib = qCompress(reinterpret_cast<const uchar*>(raw.data()), raw.size(), level);
+    if (zlib.size() < 10) {
+        return QByteArray();
+    }
+    const QByteArrayView deflate = QByteArrayView(zlib).sliced(6, zlib.size() - 10);
+    const qsizetype memberSize = MemberHeaderSize + deflate.size() + MemberTrailerSize;
+
+    QByteArray member(memberSize, Qt::Uninitialized);
+    uchar* out = reinterpret_cast<uchar*>(member.data());
+    const uchar gzipHeader[GzipHeaderSize] = { 0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff };
+    memcpy(out, gzipHeader, GzipHeaderSize);
+    out += GzipHeaderSize;
+    qToLittleEndian<quint16>(ExtraSize, out);
+    out += 2;
+    *out++ = 'O';
+    *out++ = 'Z';
+    qToLittleEndian<quint16>(ExtraSize - 4, out);
+    out += 2;
+    qToLittleEndian<quint32>(static_cast<quint32>(memberSize), out);
+    out += 4;
+    memcpy(out, zlib.constData() + 4, 2);                 // zlib header
+    memcpy(out + 2, zlib.constData() + zlib.size() - 4, 4); // Adler-32
+    out += 6;
+    memcpy(out, deflate.data(), deflate.size());
+    out += deflate.size();
+    qToLittleEndian<quint32>(MapCompression::crc32(raw), out);
+    qToLittleEndian<quint32>(static_cast<quint32>(raw.size()), out + 4);
+    return member;
+}
+
+struct MemberInfo {
+    qsizetype offset = 0;     // Of the member in the input
+    qsizetype deflateSize = 0;
+    quint32 rawSize = 0;
+    qsizetype outOffset = 0;  // Of the block in the output
+};
+
+// Validates the member header at offset and fills info; false if it is not one of ours.
+bool parseMember(QByteArrayView data, qsizetype offset, MemberInfo& info) {
+    if (data.size() - offset < MemberHeaderSize + MemberTrailerSize) {
+        return false;
+    }
+    const uchar* p = reinterpret_cast<const uchar*>(data.data()) + offset;
+    if (p[0] != 0x1f || p[1] != 0x8b || p[2] != 0x08 || p[3] != 0x04 ||
+        qFromLittleEndian<quint16>(p + 10) != ExtraSize || p[12] != 'O' || p[13] != 'Z' ||
+        qFromLittleEndian<quint16>(p + 14) != ExtraSize - 4) {
+        return false;
+    }
+    const quint32 memberSize = qFromLittleEndian<quint32>(p + 16);
+    if (memberSize < quint32(MemberHeaderSize + MemberTrailerSize) || memberSize > quint64(data.size() - offset)) {
+        return false;
+    }
+    info.offset = offset;
+    info.deflateSize = memberSize - MemberHeaderSize - MemberTrailerSize;
+    info.rawSize = qFromLittleEndian<quint32>(p + memberSize - 4);
+    return true;
+}
+
+} // namespace
+
+bool MapCompression::hasCompressedSuffix(const QString& path) {
+    return path.endsWith(QLatin1String(".gz"), Qt::CaseInsensitive);
+}
+
+bool MapCompression::isGzip(QByteArrayView data) {
+    return data.size() >= 2 && static_cast<quint8>(data.at(0)) == 0x1f && static_cast<quint8>(data.at(1)) == 0x8b;
+}
+
+bool MapCompression::isCompressedMap(QByteArrayView data) {
+    MemberInfo info;
+    return parseMember(data, 0, info);
+}
+
+quint32 MapCompression::crc32(QByteArrayView data, quint32 crc) {
+    static const auto table = [] {
+        QVector<quint32> t(256);
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    const uchar* p = reinterpret_cast<const uchar*>(data.data());
+    for (qsizetype i = 0; i < data.size(); ++i) {
+        crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+bool MapCompression::decompress(QByteArrayView data, QByteArray& out, const ProgressCallback& progress) {
+    // Index the members first; their sizes are in the headers, so this does not inflate anything.
+    QVector<MemberInfo> members;
+    qint64 totalSize = 0;
+    for (qsizetype offset = 0; offset < data.size();) {
+        MemberInfo info;
+        if (!parseMember(data, offset, info)) {
+            // Not our block layout (e.g. compressed by gzip or another editor): inflate it as
+            // one ordinary gzip stream.
+            return inflateGzip(data, out, progress);
+        }
+        info.outOffset = totalSize;
+        totalSize += info.rawSize;
+        offset += MemberHeaderSize + info.deflateSize + MemberTrailerSize;
+        members.append(info);
+    }
+
+    out = QByteArray(totalSize, Qt::Uninitialized);
+    const int memberCount = members.size();
+    const int workerCount = qBound(1, QThread::idealThreadCount(), qMax(1, memberCount));
+    QAtomicInt nextMember(0);
+    QAtomicInt failedMembers(0);
+    QAtomicInteger<qint64> bytesConsumed(0);
+    QAtomicInt stopped(0);
+
+    auto inflateMembers = [&]() {
+        QByteArray zlib; // Reused: the member rebuilt as qUncompress input
+        for (int index = nextMember.fetchAndAddRelaxed(1); index < memberCount; index = nextMember.fetchAndAddRelaxed(1)) {
+            if (stopped.loadRelaxed()) {
+                break;
+            }
+            const MemberInfo& info = members.at(index);
+            const char* member = data.data() + info.offset;
+            zlib.resize(4 + 2 + info.deflateSize + 4);
+            uchar* z = reinterpret_cast<uchar*>(zlib.data());
+            qToBigEndian<quint32>(info.rawSize, z);
+            memcpy(z + 4, member + 20, 2);                                     // zlib header
+            memcpy(z + 6, member + MemberHeaderSize, info.deflateSize);
+            memcpy(z + 6 + info.deflateSize, member + 22, 4);                  // Adler-32
+
+            const QByteArray raw = qUncompress(zlib);
+            if (raw.size() != qsizetype(info.rawSize)) {
+                failedMembers.ref();
+                continue;
+            }
+            memcpy(out.data() + info.outOffset, raw.constData(), raw.size());
+
+            const qint64 memberSize = MemberHeaderSize + info.deflateSize + MemberTrailerSize;
+            if (progress && !progress(bytesConsumed.fetchAndAddRelaxed(memberSize) + memberSize)) {
+                stopped.storeRelaxed(1);
+            }
+        }
+    };
+
+    if (workerCount == 1) {
+        inflateMembers();
+    } else {
+        QThreadPool pool;
+        pool.setMaxThreadCount(workerCount);
+        for (int worker = 0; worker < workerCount; ++worker) {
+            pool.start(inflateMembers);
+        }
+        pool.waitForDone();
+    }
+
+    if (stopped.loadRelaxed()) {
+        out.clear();
+        return false;
+    }
+    if (failedMembers.loadRelaxed() > 0) {
+        qWarning() << "MapCompression::decompress -" << failedMembers.loadRelaxed() << "of" << memberCount << "blocks are corrupt.";
+        out.clear();
+        return false;
+    }
+    return true;
+}
+
+bool MapCompression::inflateGzip(QByteArrayView data, QByteArray& out, const ProgressCallback& progress) {
+    out.clear();
+    if (!isGzip(data)) {
+        qWarning() << "MapCompression::inflateGzip - Not a gzip stream.";
+        return false;
+    }
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) { // 16: expect a gzip header and trailer
+        qWarning() << "MapCompression::inflateGzip - Could not initialize zlib.";
+        return false;
+    }
+
+    // The last four bytes of a single-member file hold its size (mod 2^32); a good first guess.
+    const uchar* in = reinterpret_cast<const uchar*>(data.data());
+    const qsizetype sizeHint = data.size() >= 18 ? qFromLittleEndian<quint32>(in + data.size() - 4) : 0;
+    out.resize(qMax<qsizetype>(sizeHint, data.size() * 4));
+
+    qsizetype consumed = 0;
+    qsizetype produced = 0;
+    int result = Z_OK;
+    bool stopped = false;
+    while (true) {
+        if (produced == out.size()) {
+            out.resize(out.size() * 2);
+        }
+        // Input goes in by the block, so progress is reported (and a stop noticed) as it is
+        // read; avail_out is 32-bit, so huge output buffers are filled in slices too.
+        const qsizetype inChunk = qMin<qsizetype>(data.size() - consumed, BlockSize);
+        const qsizetype outChunk = qMin<qsizetype>(out.size() - produced, 1 << 30);
+        stream.next_in = const_cast<Bytef*>(in + consumed);
+        stream.avail_in = static_cast<uInt>(inChunk);
+        stream.next_out = reinterpret_cast<Bytef*>(out.data() + produced);
+        stream.avail_out = static_cast<uInt>(outChunk);
+
+        result = inflate(&stream, Z_NO_FLUSH);
+        consumed += inChunk - stream.avail_in;
+        produced += outChunk - stream.avail_out;
+        if (progress && !progress(consumed)) {
+            stopped = true;
+            break;
+        }
+
+        if (result == Z_STREAM_END) {
+            // gzip files may hold several members back to back; gunzip concatenates them.
+            if (consumed < data.size() && isGzip(data.sliced(consumed))) {
+                result = inflateReset(&stream);
+                if (result == Z_OK) {
+                    continue;
+                }
+            }
+            break;
+        }
+        if (result == Z_BUF_ERROR && stream.avail_out == 0) {
+            continue; // Output full; grown at the top of the loop
+        }
+        if (result != Z_OK) {
+            break;
+        }
+        if (consumed == data.size() && stream.avail_out != 0) {
+            result = Z_DATA_ERROR; // Input ended in the middle of a member
+            break;
+        }
+    }
+    const QString zlibMessage = QString::fromLatin1(stream.msg ? stream.msg : "");
+    inflateEnd(&stream);
+
+    if (stopped) {
+        out.clear();
+        return false;
+    }
+    if (result != Z_STREAM_END) {
+        qWarning() << "MapCompression::inflateGzip - Corrupt or truncated gzip data at offset" << consumed << zlibMessage;
+        out.clear();
+        return false;
+    }
+    if (consumed < data.size()) {
+        qWarning() << "MapCompression::inflateGzip - Ignoring" << data.size() - consumed << "trailing bytes.";
+    }
+    out.resize(produced);
+    return true;
+}
+
+CompressedMapWriter::CompressedMapWriter(QIODevice* target, int level, QObject* parent) :
+    QIODevice(parent),
+    target_(target),
+    level_(level)
+{
+}
+
+CompressedMapWriter::~CompressedMapWriter() {
+    if (isOpen()) {
+        close();
+    }
+}
+
+qint64 CompressedMapWriter::readData(char* data, qint64 maxSize) {
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1; // Write-only
+}
+
+qint64 CompressedMapWriter::writeData(const char* data, qint64 size) {
+    if (error_) {
+        return -1;
+    }
+    qint64 remaining = size;
+    while (remaining > 0) {
+        if (current_.isEmpty()) {
+            current_.reserve(MapCompression::BlockSize);
+        }
+        const qint64 take = qMin(remaining, qint64(MapCompression::BlockSize - current_.size()));
+        current_.append(data, take);
+        data += take;
+        remaining -= take;
+        if (current_.size() == MapCompression::BlockSize) {
+            pending_.append(current_);
+            current_ = QByteArray();
+            if (pending_.size() >= QThread::idealThreadCount() * BlocksPerWorker && !flushBlocks()) {
+                return -1;
+            }
+        }
+    }
+    return size;
+}
+
+bool CompressedMapWriter::flushBlocks() {
+    const int blockCount = pending_.size();
+    if (blockCount == 0) {
+        return !error_;
+    }
+
+    QVector<QByteArray> members(blockCount);
+    const int workerCount = qBound(1, QThread::idealThreadCount(), blockCount);
+    QAtomicInt nextBlock(0);
+    auto compressBlocks = [&]() {
+        for (int block = nextBlock.fetchAndAddRelaxed(1); block < blockCount; block = nextBlock.fetchAndAddRelaxed(1)) {
+            members[block] = encodeMember(pending_.at(block), level_);
+        }
+    };
+    if (workerCount == 1) {
+        compressBlocks();
+    } else {
+        QThreadPool pool;
+        pool.setMaxThreadCount(workerCount);
+        for (int worker = 0; worker < workerCount; ++worker) {
+            pool.start(compressBlocks);
+        }
+        pool.waitForDone();
+    }
+    pending_.clear();
+
+    for (const QByteArray& member : std::as_const(members)) {
+        if (member.isEmpty() || target_->write(member) != member.size()) {
+            qWarning() << "CompressedMapWriter - Failed to write compressed block:" << target_->errorString();
+            error_ = true;
+            setErrorString(target_->errorString());
+            return false;
+        }
+    }
+    return true;
+}
+
+void CompressedMapWriter::close() {
+    finish();
+}
+
+bool CompressedMapWriter::finish() {
+    if (!isOpen()) {
+        return !error_;
+    }
+    if (!current_.isEmpty()) {
+        pending_.append(current_);
+        current_ = QByteArray();
+    }
+    flushBlocks();
+    QIODevice::close();
+    return !error_;
+}
@@ -0,0 +1,74 @@
+#ifndef MAPCOMPRESSION_H
+#define MAPCOMPRESSION_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QVector>
+#include <QString>
+#include <functional> // For ProgressCallback
+
+// Compressed map files (*.otbm.gz).
+//
+// The OTBM stream is cut into independent blocks of BlockSize bytes and every block is
+// written as a gzip member of its own (the same layout as BGZF), so the result is a regular
+// multi-member gzip file that gunzip/zcat read as usual. Each member carries an "OZ" extra
+// field holding its total size plus the zlib header and Adler-32 of the block. That lets
+// the reader find every block without inflating the one before it and hand each to
+// qUncompress on its own, so blocks are compressed and decompressed in parallel with the
+// zlib that ships with Qt.
+//
+// Any other gzip file (written by gzip or another editor) is inflated as an ordinary
+// stream instead, on one thread, with zlib's gzip decoder (the copy bundled with Qt).
+class MapCompression {
+public:
+    static constexpr qsizetype BlockSize = 1024 * 1024;
+
+    static bool hasCompressedSuffix(const QString& path); // *.gz
+    static bool isGzip(QByteArrayView data);              // Any gzip stream
+    static bool isCompressedMap(QByteArrayView data);     // Written by CompressedMapWriter
+
+    // Called after every block with the number of compressed bytes read so far, possibly
+    // from several threads at once. Returning false stops the decoding.
+    using ProgressCallback = std::function<bool(qint64 bytesConsumed)>;
+
+    // Decodes a complete compressed map file into out. Returns false on malformed input (with
+    // a warning) or when progress asked to stop (without one).
+    static bool decompress(QByteArrayView data, QByteArray& out, const ProgressCallback& progress = {});
+    // Plain gzip decoding of all members in data, as gunzip would, in blocks of BlockSize
+    // input bytes; used by decompress() for files that are not laid out by CompressedMapWriter.
+    static bool inflateGzip(QByteArrayView data, QByteArray& out, const ProgressCallback& progress = {});
+
+    static quint32 crc32(QByteArrayView data, quint32 crc = 0);
+};
+
+// Write-only device that compresses everything written to it into target. Blocks are
+// compressed in batches on a thread pool as they fill up; close() writes what is left.
+// Check hasError() (or the return of close()) before trusting the output.
+class CompressedMapWriter : public QIODevice {
+    Q_OBJECT
+
+public:
+    explicit CompressedMapWriter(QIODevice* target, int level = 6, QObject* parent = nullptr);
+    ~CompressedMapWriter() override;
+
+    bool isSequential() const override { return true; }
+    void close() override;
+    bool finish(); // close() that reports whether everything reached the target
+    bool hasError() const { return error_; }
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 size) override;
+
+private:
+    bool flushBlocks();
+
+    QIODevice* target_;
+    int level_;
+    QByteArray current_;          // Block being filled
+    QVector<QByteArray> pending_; // Full blocks waiting to be compressed
+    bool error_ = false;
+};
+
+#endif // MAPCOMPRESSION_H
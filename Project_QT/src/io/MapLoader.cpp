@@ -0,0 +1,84 @@
+#include "MapLoader.h"
+#include <QThread>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QDebug>
+
+MapLoader::MapLoader(QObject* parent) : QObject(parent) {
+    progressTimer_ = new QTimer(this);
+    progressTimer_->setInterval(100);
+    connect(progressTimer_, &QTimer::timeout, this, &MapLoader::pollProgress);
+}
+
+MapLoader::~MapLoader() {
+    if (thread_) {
+        cancel();
+        thread_->wait();
+        delete thread_;
+        thread_ = nullptr;
+    }
+    delete result_; // Only set if the load finished but onThreadFinished never ran
+}
+
+bool MapLoader::start(const QString& path, MapLoadMode mode) {
+    if (thread_) {
+        qWarning() << "MapLoader::start - Already loading" << path_;
+        return false;
+    }
+
+    path_ = path;
+    result_ = nullptr;
+    progress_.bytesTotal.storeRelaxed(0);
+    progress_.bytesConsumed.storeRelaxed(0);
+    progress_.areaCount.storeRelaxed(0);
+    progress_.areasDecoded.storeRelaxed(0);
+    progress_.canceled.storeRelaxed(0);
+
+    QThread* targetThread = thread(); // The map is handed to whoever lives on the loader's thread
+    thread_ = QThread::create([this, path, mode, targetThread]() {
+        QElapsedTimer timer;
+        timer.start();
+        Map* map = new Map(); // Created here, so the map and its Selection belong to the worker for now
+        if (map->load(path, &progress_, mode)) {
+            qDebug() << "MapLoader - Loaded" << path << "in" << timer.elapsed() << "ms.";
+            // Still the map's thread, and nothing else can reach it yet. Only the records are
+            // taken here; the source is hashed and the snapshot written on the thread pool.
+            if (mode == MapLoadMode::Full && !map->hasCurrentSnapshot()) {
+                map->saveSnapshotInBackground(path);
+            }
+            map->moveToThread(targetThread); // Must be called from the object's current thread
+            result_ = map;
+        } else {
+            delete map;
+        }
+    });
+    connect(thread_, &QThread::finished, this, &MapLoader::onThreadFinished);
+    thread_->start();
+    progressTimer_->start();
+    return true;
+}
+
+void MapLoader::cancel() {
+    progress_.canceled.storeRelaxed(1);
+}
+
+void MapLoader::pollProgress() {
+    emit progressChanged(progress_.bytesConsumed.loadRelaxed(), progress_.bytesTotal.loadRelaxed(),
+                         progress_.areasDecoded.loadRelaxed(), progress_.areaCount.loadRelaxed());
+}
+
+void MapLoader::onThreadFinished() {
+    progressTimer_->stop();
+    pollProgress(); // Final counts
+
+    thread_->deleteLater();
+    thread_ = nullptr;
+
+    Map* map = result_;
+    result_ = nullptr;
+    if (map) {
+        emit finished(map);
+    } else {
+        emit failed(path_, progress_.isCanceled());
+    }
+}
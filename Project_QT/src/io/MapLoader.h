@@ -0,0 +1,52 @@
+#ifndef MAPLOADER_H
+#define MAPLOADER_H
+
+#include <QObject>
+#include <QString>
+#include "Map.h" // For MapLoadProgress
+
+class QThread;
+class QTimer;
+
+// Loads a map file on a worker thread so the editor stays responsive while large maps open.
+//
+// The Map is built entirely on the worker (see Map::load) and only handed over once it is
+// complete: finished() delivers it on the loader's own thread, unparented, and the receiver
+// takes ownership. While the load runs, progressChanged() reports bytes consumed and tile
+// areas decoded a few times per second; cancel() makes the worker give up at the next area
+// and the partially built map is discarded. With MapLoadMode::OnDemand the worker only
+// indexes the tile areas, so the map arrives almost at once whatever its size.
+// A full load of a map without a current snapshot also queues one for the next open (see
+// Map::saveSnapshotInBackground); writing it does not hold up the handover.
+class MapLoader : public QObject {
+    Q_OBJECT
+
+public:
+    explicit MapLoader(QObject* parent = nullptr);
+    ~MapLoader() override; // Cancels a running load and waits for the worker to stop
+
+    bool start(const QString& path, MapLoadMode mode = MapLoadMode::Full); // Returns false if a load is already running
+    bool isRunning() const { return thread_ != nullptr; }
+    QString path() const { return path_; }
+
+public slots:
+    void cancel();
+
+signals:
+    void progressChanged(qint64 bytesConsumed, qint64 bytesTotal, int areasDecoded, int areaCount);
+    void finished(Map* map);
+    void failed(const QString& path, bool canceled);
+
+private slots:
+    void pollProgress();
+    void onThreadFinished();
+
+private:
+    QString path_;
+    QThread* thread_ = nullptr;
+    QTimer* progressTimer_ = nullptr;
+    Map* result_ = nullptr; // Written by the worker, read after it has finished
+    MapLoadProgress progress_;
+};
+
+#endif // MAPLOADER_H
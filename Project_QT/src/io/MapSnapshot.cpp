@@ -0,0 +1,206 @@
+#include "MapSnapshot.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <QSaveFile>
+#include <QElapsedTimer>
+#include <QtEndian>
+#include <QDebug>
+#include <cstring> // For memcmp, memcpy
+
+namespace {
+
+const char SnapshotMagic[8] = { 'R', 'M', 'E', 'S', 'N', 'A', 'P', '\x1a' };
+
+// Field offsets within the header.
+constexpr int VersionOffset = 8;
+constexpr int ChunkCountOffset = 12;
+constexpr int SourceSizeOffset = 16;
+constexpr int SourceModifiedOffset = 24;
+constexpr int SourceHashOffset = 32;      // 20 bytes, then 4 reserved
+constexpr int SkeletonSizeOffset = 56;
+constexpr int IndexOffsetOffset = 64;
+constexpr int RecordsOffsetOffset = 72;
+constexpr int RecordsSizeOffset = 80;     // Bytes 88..95 are reserved
+constexpr int ItemsOtbHashOffset = 96;    // 20 bytes, then 4 reserved
+constexpr int ItemsXmlHashOffset = 120;   // 20 bytes, then 4 reserved
+
+qint64 alignTo8(qint64 offset) {
+    return (offset + 7) & ~qint64(7);
+}
+
+// As stored: a missing hash (no item database, no items.xml) reads back as zeros.
+QByteArray storedHash(const QByteArray& hash) {
+    return hash.leftJustified(MapSnapshot::SourceHashSize, '\0', true);
+}
+
+} // namespace
+
+QString MapSnapshot::pathFor(const QString& sourcePath) {
+    return sourcePath + QLatin1String(".snapshot");
+}
+
+QByteArray MapSnapshot::hashFile(const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    const qint64 size = file.size();
+    if (uchar* mapped = size > 0 ? file.map(0, size) : nullptr) {
+        hash.addData(QByteArrayView(reinterpret_cast<const char*>(mapped), size));
+        file.unmap(mapped);
+    } else if (!hash.addData(&file)) {
+        return QByteArray();
+    }
+    return hash.result();
+}
+
+bool MapSnapshot::statSource(const QString& sourcePath, Header& header) {
+    const QFileInfo info(sourcePath);
+    if (!info.exists()) {
+        qWarning() << "MapSnapshot::statSource - No such file" << sourcePath;
+        return false;
+    }
+    header.sourceSize = info.size();
+    header.sourceModified = info.lastModified().toMSecsSinceEpoch();
+    return true;
+}
+
+bool MapSnapshot::matchesSource(const Header& header, const QString& sourcePath) {
+    const QFileInfo info(sourcePath);
+    if (!info.exists() || info.size() != header.sourceSize ||
+        info.lastModified().toMSecsSinceEpoch() != header.sourceModified) {
+        return false;
+    }
+    return hashFile(sourcePath) == header.sourceHash;
+}
+
+bool MapSnapshot::matchesItems(const Header& header, const QByteArray& otbHash, const QByteArray& xmlHash) {
+    return storedHash(header.itemsOtbHash) == storedHash(otbHash) && storedHash(header.itemsXmlHash) == storedHash(xmlHash);
+}
+
+bool MapSnapshot::write(const QString& sourcePath, Header header, const QByteArray& skeleton,
+                        const QVector<ChunkRecord>& chunks) {
+    QElapsedTimer timer;
+    timer.start();
+    header.sourceHash = hashFile(sourcePath);
+    // Checked after hashing, so a file replaced while it was read is not recorded either.
+    const QFileInfo info(sourcePath);
+    if (header.sourceHash.size() != SourceHashSize || !info.exists() || info.size() != header.sourceSize ||
+        info.lastModified().toMSecsSinceEpoch() != header.sourceModified) {
+        qDebug() << "MapSnapshot::write -" << sourcePath << "changed since the map was read; not writing a snapshot.";
+        return false;
+    }
+
+    header.chunkCount = chunks.size();
+    header.skeletonSize = skeleton.size();
+    header.indexOffset = alignTo8(HeaderSize + header.skeletonSize);
+    header.recordsOffset = alignTo8(header.indexOffset + qint64(chunks.size()) * IndexEntrySize);
+
+    // Every record starts 8-aligned (they are read in place), so each is followed by padding.
+    QByteArray indexData(header.recordsOffset - header.indexOffset, '\0');
+    uchar* entry = reinterpret_cast<uchar*>(indexData.data());
+    qint64 offset = 0;
+    for (const ChunkRecord& chunk : chunks) {
+        qToLittleEndian<quint64>(chunk.chunkKey, entry);
+        qToLittleEndian<qint64>(offset, entry + 8);
+        qToLittleEndian<qint64>(chunk.data.size(), entry + 16);
+        entry += IndexEntrySize;
+        offset = alignTo8(offset + chunk.data.size());
+    }
+    header.recordsSize = offset;
+    const QByteArray padding(header.indexOffset - HeaderSize - header.skeletonSize, '\0');
+    const QByteArray recordPadding(7, '\0');
+
+    const QString path = pathFor(sourcePath);
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(encodeHeader(header)) != HeaderSize ||
+        file.write(skeleton) != skeleton.size() ||
+        file.write(padding) != padding.size() ||
+        file.write(indexData) != indexData.size()) {
+        qWarning() << "MapSnapshot::write - Could not write" << path << "Error:" << file.errorString();
+        file.cancelWriting();
+        return false;
+    }
+    for (const ChunkRecord& chunk : chunks) {
+        const qint64 paddingSize = alignTo8(chunk.data.size()) - chunk.data.size();
+        if (file.write(chunk.data) != chunk.data.size() ||
+            file.write(recordPadding.constData(), paddingSize) != paddingSize) {
+            qWarning() << "MapSnapshot::write - Could not write" << path << "Error:" << file.errorString();
+            file.cancelWriting();
+            return false;
+        }
+    }
+    if (!file.commit()) {
+        qWarning() << "MapSnapshot::write - Could not write" << path << "Error:" << file.errorString();
+        return false;
+    }
+    qDebug() << "MapSnapshot::write - Wrote" << path << "(" << header.chunkCount << "chunks) in" << timer.elapsed() << "ms.";
+    return true;
+}
+
+QByteArray MapSnapshot::encodeHeader(const Header& header) {
+    QByteArray data(HeaderSize, '\0');
+    uchar* out = reinterpret_cast<uchar*>(data.data());
+    memcpy(out, SnapshotMagic, sizeof(SnapshotMagic));
+    qToLittleEndian<quint32>(Version, out + VersionOffset);
+    qToLittleEndian<quint32>(header.chunkCount, out + ChunkCountOffset);
+    qToLittleEndian<qint64>(header.sourceSize, out + SourceSizeOffset);
+    qToLittleEndian<qint64>(header.sourceModified, out + SourceModifiedOffset);
+    memcpy(out + SourceHashOffset, header.sourceHash.constData(), qMin<qsizetype>(header.sourceHash.size(), SourceHashSize));
+    qToLittleEndian<qint64>(header.skeletonSize, out + SkeletonSizeOffset);
+    qToLittleEndian<qint64>(header.indexOffset, out + IndexOffsetOffset);
+    qToLittleEndian<qint64>(header.recordsOffset, out + RecordsOffsetOffset);
+    qToLittleEndian<qint64>(header.recordsSize, out + RecordsSizeOffset);
+    memcpy(out + ItemsOtbHashOffset, storedHash(header.itemsOtbHash).constData(), SourceHashSize);
+    memcpy(out + ItemsXmlHashOffset, storedHash(header.itemsXmlHash).constData(), SourceHashSize);
+    return data;
+}
+
+bool MapSnapshot::decodeHeader(QByteArrayView data, Header& header) {
+    if (data.size() < HeaderSize || memcmp(data.data(), SnapshotMagic, sizeof(SnapshotMagic)) != 0) {
+        qWarning() << "MapSnapshot::decodeHeader - Not a map snapshot.";
+        return false;
+    }
+    const uchar* in = reinterpret_cast<const uchar*>(data.data());
+    const quint32 version = qFromLittleEndian<quint32>(in + VersionOffset);
+    if (version != Version) {
+        qDebug() << "MapSnapshot::decodeHeader - Snapshot version" << version << "is not" << Version << "; ignoring it.";
+        return false;
+    }
+    header.chunkCount = qFromLittleEndian<quint32>(in + ChunkCountOffset);
+    header.sourceSize = qFromLittleEndian<qint64>(in + SourceSizeOffset);
+    header.sourceModified = qFromLittleEndian<qint64>(in + SourceModifiedOffset);
+    header.sourceHash = QByteArray(data.data() + SourceHashOffset, SourceHashSize);
+    header.skeletonSize = qFromLittleEndian<qint64>(in + SkeletonSizeOffset);
+    header.indexOffset = qFromLittleEndian<qint64>(in + IndexOffsetOffset);
+    header.recordsOffset = qFromLittleEndian<qint64>(in + RecordsOffsetOffset);
+    header.recordsSize = qFromLittleEndian<qint64>(in + RecordsSizeOffset);
+    header.itemsOtbHash = QByteArray(data.data() + ItemsOtbHashOffset, SourceHashSize);
+    header.itemsXmlHash = QByteArray(data.data() + ItemsXmlHashOffset, SourceHashSize);
+
+    const qint64 fileSize = data.size();
+    if (header.skeletonSize < 0 || header.skeletonSize > fileSize - HeaderSize ||
+        header.indexOffset < HeaderSize + header.skeletonSize || header.indexOffset > fileSize ||
+        qint64(header.chunkCount) > (fileSize - header.indexOffset) / IndexEntrySize ||
+        header.recordsOffset < header.indexOffset + qint64(header.chunkCount) * IndexEntrySize ||
+        header.recordsOffset % 8 != 0 || header.recordsOffset > fileSize ||
+        header.recordsSize < 0 || header.recordsSize > fileSize - header.recordsOffset) {
+        qWarning() << "MapSnapshot::decodeHeader - Snapshot is truncated or corrupt.";
+        return false;
+    }
+    return true;
+}
+
+bool MapSnapshot::indexEntry(QByteArrayView data, const Header& header, quint32 i, IndexEntry& entry) {
+    const uchar* in = reinterpret_cast<const uchar*>(data.data()) + header.indexOffset + qint64(i) * IndexEntrySize;
+    entry.chunkKey = qFromLittleEndian<quint64>(in);
+    entry.offset = qFromLittleEndian<qint64>(in + 8);
+    entry.size = qFromLittleEndian<qint64>(in + 16);
+    // Records are read in place, so they must also keep the alignment they were written with.
+    return entry.offset >= 0 && entry.offset % 8 == 0 && entry.size >= qint64(sizeof(SnapshotChunkRecord)) &&
+           entry.offset <= header.recordsSize - entry.size;
+}
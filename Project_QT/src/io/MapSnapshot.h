@@ -0,0 +1,124 @@
+#ifndef MAPSNAPSHOT_H
+#define MAPSNAPSHOT_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <QVector>
+#include <QtEndian> // For the little-endian record fields
+
+// Editor-native snapshot of a loaded map, kept next to its source file as "<map>.snapshot"
+// (see Map::saveSnapshotInBackground and Map::load).
+//
+// Layout (little-endian):
+//   header (HeaderSize bytes, see Header)
+//   skeleton         - the map as an OTBM stream without tile areas (root attributes, towns,
+//                      waypoints), read back with the regular loader
+//   padding to 8
+//   chunk index      - chunkCount entries of { u64 chunkKey, u64 offset, u64 size }, offsets
+//                      relative to recordsOffset
+//   chunk records    - one per occupied MapChunk, each starting on an 8 byte boundary:
+//                        SnapshotChunkRecord
+//                        SnapshotTileRecord[tileCount]
+//                        SnapshotItemRecord[itemCount]  - per tile: ground first, then its items
+//                        u16 zone ids                   - per tile, zoneCount of them
+//                        item extras                    - per item, extraSize bytes (see Item)
+//
+// The records mirror the in-memory chunks field for field, so the loader reads them in place
+// from the mapped file and builds tiles and items straight into the map's arena, without any
+// OTBM decoding. A snapshot is only used while the size, modification time and SHA-1 of the
+// source file match the ones recorded in it, and the loaded item database has the items.otb
+// and items.xml hashes it was taken with: which items count as ground, their charges and the
+// subtypes of old maps all depend on it.
+struct SnapshotChunkRecord {
+    quint16_le baseX;
+    quint16_le baseY;
+    quint8 z;
+    quint8 reserved;
+    quint16_le tileCount;
+    quint32_le itemCount;
+    quint32_le zoneIdCount;
+};
+
+struct SnapshotTileRecord {
+    quint16_le slot;
+    quint16_le mapFlags;
+    quint32_le houseId;
+    quint16_le itemCount; // Ground included
+    quint16_le zoneCount;
+};
+
+struct SnapshotItemRecord {
+    quint16_le serverId;
+    quint16_le attrMask;
+    quint16_le count;
+    quint16_le actionId;
+    quint16_le uniqueId;
+    quint16_le charges;
+    quint32_le extraSize; // 0 if the item has no ItemExtraAttributes
+};
+
+static_assert(sizeof(SnapshotChunkRecord) == 16, "Snapshot records are read in place");
+static_assert(sizeof(SnapshotTileRecord) == 12, "Snapshot records are read in place");
+static_assert(sizeof(SnapshotItemRecord) == 16, "Snapshot records are read in place");
+
+class MapSnapshot {
+public:
+    static constexpr quint32 Version = 3;
+    static constexpr qsizetype HeaderSize = 136;
+    static constexpr qsizetype IndexEntrySize = 24;
+    static constexpr int SourceHashSize = 20; // SHA-1
+
+    struct Header {
+        quint32 chunkCount = 0;
+        qint64 sourceSize = 0;
+        qint64 sourceModified = 0; // ms since the epoch, UTC
+        QByteArray sourceHash;
+        QByteArray itemsOtbHash;   // See ItemManager::otbHash()
+        QByteArray itemsXmlHash;
+        qint64 skeletonSize = 0;   // The skeleton starts right after the header
+        qint64 indexOffset = 0;    // Relative to the file
+        qint64 recordsOffset = 0;  // Relative to the file
+        qint64 recordsSize = 0;
+    };
+
+    struct IndexEntry {
+        quint64 chunkKey = 0;
+        qint64 offset = 0; // Relative to recordsOffset
+        qint64 size = 0;
+    };
+
+    // One chunk record as write() takes it; records are padded to 8 bytes there.
+    struct ChunkRecord {
+        quint64 chunkKey = 0;
+        QByteArray data;
+    };
+
+    static QString pathFor(const QString& sourcePath);
+
+    // Fills sourceSize and sourceModified of header from the file at sourcePath. Cheap; meant
+    // to be called when the records are taken, so a later write can tell the file has changed.
+    static bool statSource(const QString& sourcePath, Header& header);
+    // True if the file at sourcePath is still the one header was stamped from. Size and
+    // modification time are compared first, so a changed file is rejected without hashing it.
+    static bool matchesSource(const Header& header, const QString& sourcePath);
+    // True if header was taken with the item database that has these hashes.
+    static bool matchesItems(const Header& header, const QByteArray& otbHash, const QByteArray& xmlHash);
+
+    // Hashes the source file and writes the snapshot next to it, chunks in the order given.
+    // Runs on any thread; gives up (returning false) if the source no longer has the size and
+    // modification time in header, as the records would then describe another file.
+    static bool write(const QString& sourcePath, Header header, const QByteArray& skeleton,
+                      const QVector<ChunkRecord>& chunks);
+
+    static QByteArray encodeHeader(const Header& header);
+    // Checks the magic, version and that every range lies within a file of data.size() bytes.
+    static bool decodeHeader(QByteArrayView data, Header& header);
+    // Reads entry i of the index that header describes; false if its record lies outside the records.
+    static bool indexEntry(QByteArrayView data, const Header& header, quint32 i, IndexEntry& entry);
+
+private:
+    static QByteArray hashFile(const QString& path);
+};
+
+#endif // MAPSNAPSHOT_H
@@ -1,54 +1,74 @@
 #ifndef OTBMREADER_H
 #define OTBMREADER_H
 
-#include <QDataStream>
+#include <QByteArray>
+#include <QByteArrayView>
 #include <QString>
-#include <QList>
-#include <QScopedPointer>
+#include <QVarLengthArray>
 #include "OtbmTypes.h"
 
 // Forward declarations
 class Item;
 class ItemManager;
+struct ItemAttributeDecoders;
 
 // OTBM structure markers (common values)
 const quint8 OTBM_NODE_START = 0xFC;
 const quint8 OTBM_NODE_END = 0xFD;
 const quint8 OTBM_ESCAPE_CHAR = 0xFE;
 
+// Reads OTBM node trees directly from a byte span, normally a memory-mapped file
+// (see Map::load). Nothing is copied up front: node properties are decoded in place
+// and attribute values are handed out as views into the span.
+//
+// Inside node data any 0xFC/0xFD/0xFE byte is preceded by OTBM_ESCAPE_CHAR. Values
+// whose raw bytes contain no escape (the common case) are returned as views into the
+// span; otherwise they are unescaped into a scratch buffer owned by the reader. Either
+// way a returned view is only valid until the next read call.
+//
+// Errors (truncated data, malformed structure) are sticky: once hasError() is true all
+// further reads fail.
 class OtbmReader {
 public:
-    explicit OtbmReader(QDataStream& stream);
+    explicit OtbmReader(QByteArrayView data);
     ~OtbmReader();
 
     // Node operations
+    // enterNode() returns false without an error when the next byte is not a node start
+    // (e.g. the parent's end marker), so it can drive "for each child" loops.
     bool enterNode(quint8& nodeType);
+    // Skips whatever is left of the current node (unread data and child nodes) and its end marker.
     bool leaveNode();
 
-    // Primitive data type reading (from current node's properties)
-    // These assume the stream is positioned right after an attribute ID byte.
-    // They read the data length (quint16) then the data.
+    // Node property reading (raw little-endian values, escape-aware)
     bool readByte(quint8& value);
     bool readU16(quint16& value);
     bool readU32(quint32& value);
-    bool readString(QString& value);
-    QByteArray readData(quint16 length);
+    bool readString(QString& value); // u16 length + UTF-8 data
+    bool readBytes(qsizetype length, QByteArrayView& view);
 
-    // Attribute reading (reads attribute ID, then its value using above methods)
-    // Returns false if attribute ID cannot be read or if value reading fails.
+    // Attributes: an attribute id followed by a u16 data length and the data.
+    // nextAttributeId() returns false when the node's attribute list ends (child node or node end).
     bool nextAttributeId(quint8& attrId);
+    bool readAttributeData(QByteArrayView& view);
 
-    // Higher-level object reading
-    Item* readItem(ItemManager* itemManager, quint32 mapOtbmFormatVersion, quint32 otbItemsMajorVersion, quint32 otbItemsMinorVersion);
+    // Higher-level object reading; expects to be positioned right after an OTBM_ITEM node type.
+    // decoders comes from Item::otbmAttributeDecoders() for the file being read.
+    Item* readItem(ItemManager* itemManager, const ItemAttributeDecoders& decoders);
 
-    QDataStream& stream() { return m_stream; }
+    bool hasError() const { return error_; }
+    bool atEnd() const { return pos_ >= end_; }
+    qsizetype position() const { return pos_ - begin_; }
 
 private:
-    bool expectByte(quint8 expected);
-    quint8 peekByte();
+    bool fail(const char* what);
 
-    QDataStream& m_stream;
-    QList<quint8> m_nodeTypeStack;
+    const uchar* begin_;
+    const uchar* pos_;
+    const uchar* end_;
+    bool error_ = false;
+    QVarLengthArray<quint8, 8> nodeTypeStack_;
+    QByteArray scratch_; // Holds unescaped values; reused between reads
 };
 
 #endif // OTBMREADER_H
@@ -1,98 +1,100 @@
 #include "OtbmWriter.h"
 #include "Item.h"        // For Item class, needed for writeItemNode
-#include <QIODevice>     // For QIODevice::WriteOnly (not strictly needed for QDataStream operations)
-#include <QByteArray>
+#include <QtEndian>      // For qToLittleEndian
 #include <QDebug>
 
-// Ensure constants are accessible. They are defined in OtbmWriter.h for this scope.
-// const quint8 OTBM_NODE_START_W = 0xFC;
-// const quint8 OTBM_NODE_END_W = 0xFD;
-
-OtbmWriter::OtbmWriter(QDataStream& stream) : m_stream(stream) {
-    m_stream.setByteOrder(QDataStream::LittleEndian);
-}
+OtbmWriter::OtbmWriter() {}
 
 OtbmWriter::~OtbmWriter() {}
 
+void OtbmWriter::writeEscaped(const char* data, qsizetype size) {
+    // Copy runs of ordinary bytes in one go; only the three marker values need escaping.
+    qsizetype runStart = 0;
+    for (qsizetype i = 0; i < size; ++i) {
+        const quint8 byte = static_cast<quint8>(data[i]);
+        if (byte >= OTBM_NODE_START_W && byte <= OTBM_ESCAPE_CHAR_W) {
+            buffer_.append(data + runStart, i - runStart);
+            buffer_.append(static_cast<char>(OTBM_ESCAPE_CHAR_W));
+            runStart = i; // The marker byte itself is copied with the next run
+        }
+    }
+    buffer_.append(data + runStart, size - runStart);
+}
+
 // Use OTBM_NodeTypes_t as defined in OtbmTypes.h
 void OtbmWriter::beginNode(OTBM_NodeTypes_t nodeType) {
-    m_stream << OTBM_NODE_START_W;
-    m_stream << static_cast<quint8>(nodeType);
-    // qDebug() << "OtbmWriter: Began node type" << static_cast<quint8>(nodeType);
+    buffer_.append(static_cast<char>(OTBM_NODE_START_W));
+    writeByte(static_cast<quint8>(nodeType));
 }
 
 void OtbmWriter::endNode() {
-    m_stream << OTBM_NODE_END_W;
-    // qDebug() << "OtbmWriter: Ended node.";
+    buffer_.append(static_cast<char>(OTBM_NODE_END_W));
 }
 
 // Primitive writers
 void OtbmWriter::writeByte(quint8 value) {
-    m_stream << value;
+    writeEscaped(reinterpret_cast<const char*>(&value), 1);
 }
 
 void OtbmWriter::writeU16(quint16 value) {
-    m_stream << value;
+    const quint16 le = qToLittleEndian(value);
+    writeEscaped(reinterpret_cast<const char*>(&le), sizeof(le));
 }
 
 void OtbmWriter::writeU32(quint32 value) {
-    m_stream << value;
+    const quint32 le = qToLittleEndian(value);
+    writeEscaped(reinterpret_cast<const char*>(&le), sizeof(le));
 }
 
 void OtbmWriter::writeString(const QString& value) {
-    QByteArray utf8Value = value.toUtf8();
-    m_stream << static_cast<quint16>(utf8Value.length());
-    m_stream.writeRawData(utf8Value.constData(), utf8Value.length());
+    const QByteArray utf8Value = value.toUtf8();
+    writeU16(static_cast<quint16>(utf8Value.size()));
+    writeEscaped(utf8Value.constData(), utf8Value.size());
 }
 
-void OtbmWriter::writeData(const QByteArray& data) {
-    m_stream.writeRawData(data.constData(), data.length());
+void OtbmWriter::writeData(QByteArrayView data) {
+    writeEscaped(data.data(), data.size());
 }
 
 // Attribute writers
-void OtbmWriter::writeAttributeByte(OTBM_ItemAttribute attrId, quint8 value) {
-    m_stream << static_cast<quint8>(attrId);
-    m_stream << static_cast<quint16>(sizeof(quint8)); // Length of data
-    m_stream << value;
+void OtbmWriter::writeAttributeByte(quint8 attrId, quint8 value) {
+    writeByte(attrId);
+    writeU16(sizeof(quint8)); // Length of data
+    writeByte(value);
 }
 
-void OtbmWriter::writeAttributeU16(OTBM_ItemAttribute attrId, quint16 value) {
-    m_stream << static_cast<quint8>(attrId);
-    m_stream << static_cast<quint16>(sizeof(quint16)); // Length of data
-    m_stream << value;
+void OtbmWriter::writeAttributeU16(quint8 attrId, quint16 value) {
+    writeByte(attrId);
+    writeU16(sizeof(quint16)); // Length of data
+    writeU16(value);
 }
 
-void OtbmWriter::writeAttributeU32(OTBM_ItemAttribute attrId, quint32 value) {
-    m_stream << static_cast<quint8>(attrId);
-    m_stream << static_cast<quint16>(sizeof(quint32)); // Length of data
-    m_stream << value;
+void OtbmWriter::writeAttributeU32(quint8 attrId, quint32 value) {
+    writeByte(attrId);
+    writeU16(sizeof(quint32)); // Length of data
+    writeU32(value);
 }
 
-void OtbmWriter::writeAttributeString(OTBM_ItemAttribute attrId, const QString& value) {
-    m_stream << static_cast<quint8>(attrId);
-    QByteArray utf8Value = value.toUtf8();
-    m_stream << static_cast<quint16>(utf8Value.length()); // This is the DataLength for the attribute
-    m_stream.writeRawData(utf8Value.constData(), utf8Value.length()); // This is the Data
+void OtbmWriter::writeAttributeString(quint8 attrId, const QString& value) {
+    writeByte(attrId);
+    writeString(value); // The u16 string length doubles as the attribute's data length
 }
 
-void OtbmWriter::writeAttributeData(OTBM_ItemAttribute attrId, const QByteArray& data) {
-    m_stream << static_cast<quint8>(attrId);
-    m_stream << static_cast<quint16>(data.length());
-    m_stream.writeRawData(data.constData(), data.length());
+void OtbmWriter::writeAttributeData(quint8 attrId, QByteArrayView data) {
+    writeByte(attrId);
+    writeU16(static_cast<quint16>(data.size()));
+    writeData(data);
 }
 
-
 // Higher-level object writing
 void OtbmWriter::writeItemNode(const Item* item, quint32 mapOtbmFormatVersion, quint32 otbItemsMajorVersion, quint32 otbItemsMinorVersion) {
     if (!item) {
         qWarning() << "OtbmWriter::writeItemNode - Attempted to write null item.";
         return;
     }
-    // Item::serializeOtbmNode is responsible for writing its node type (OTBM_ITEM),
-    // its server ID, and then calling its own serializeOtbmAttributes method.
-    // The OtbmWriter's beginNode/endNode are for higher-level nodes (MapData, TileArea, Tile etc.)
-    // that would wrap item nodes or other data.
-    if (!item->serializeOtbmNode(m_stream, mapOtbmFormatVersion, otbItemsMajorVersion, otbItemsMinorVersion)) {
-         qWarning() << "OtbmWriter::writeItemNode - Failed to serialize item node for ID:" << item->getServerId();
-    }
+    item->serializeOtbmNode(*this, mapOtbmFormatVersion, otbItemsMajorVersion, otbItemsMinorVersion);
+}
+
+void OtbmWriter::writeEncoded(QByteArrayView encoded) {
+    buffer_.append(encoded.data(), encoded.size());
 }
@@ -1,7 +1,8 @@
 #ifndef OTBMWRITER_H
 #define OTBMWRITER_H
 
-#include <QDataStream>
+#include <QByteArray>
+#include <QByteArrayView>
 #include <QString>
 #include "OtbmTypes.h" // From previous step
 
@@ -13,40 +14,50 @@ const quint8 OTBM_NODE_START_W = 0xFC; // Suffix _W to avoid redefinition if in
 const quint8 OTBM_NODE_END_W = 0xFD;
 const quint8 OTBM_ESCAPE_CHAR_W = 0xFE;
 
-
+// Serializes OTBM nodes into an in-memory buffer. Node data is escaped as it is written
+// (0xFC/0xFD/0xFE are prefixed with OTBM_ESCAPE_CHAR_W), so the buffer is valid OTBM.
+// Independent writers can serialize separate nodes concurrently; their buffers are then
+// joined in order with writeEncoded() or written out one after another (see Map::saveToOTBM).
 class OtbmWriter {
 public:
-    explicit OtbmWriter(QDataStream& stream);
+    OtbmWriter();
     ~OtbmWriter();
 
     // Node operations
-    void beginNode(OtbmNodeType nodeType); // Changed from OTBM_NodeTypes_t to OtbmNodeType for consistency if enum class was used
-                                         // Keeping OTBM_NodeTypes_t as per OtbmTypes.h content
     void beginNode(OTBM_NodeTypes_t nodeType);
     void endNode();
 
-    // Primitive data type writing (raw data, no attribute ID or length prefix here)
+    // Primitive data type writing (raw little-endian data, no attribute ID or length prefix here)
     void writeByte(quint8 value);
     void writeU16(quint16 value);
     void writeU32(quint32 value);
     void writeString(const QString& value); // Writes u16 length + UTF-8 data
-    void writeData(const QByteArray& data); // Writes raw byte array
+    void writeData(QByteArrayView data);    // Writes raw bytes
 
     // Attribute writing methods (writes AttributeID, DataLength, then Data)
-    void writeAttributeByte(OTBM_ItemAttribute attrId, quint8 value);
-    void writeAttributeU16(OTBM_ItemAttribute attrId, quint16 value);
-    void writeAttributeU32(OTBM_ItemAttribute attrId, quint32 value);
-    void writeAttributeString(OTBM_ItemAttribute attrId, const QString& value);
-    void writeAttributeData(OTBM_ItemAttribute attrId, const QByteArray& data);
+    void writeAttributeByte(quint8 attrId, quint8 value);
+    void writeAttributeU16(quint8 attrId, quint16 value);
+    void writeAttributeU32(quint8 attrId, quint32 value);
+    void writeAttributeString(quint8 attrId, const QString& value);
+    void writeAttributeData(quint8 attrId, QByteArrayView data);
 
     // Higher-level object writing
-    // This method will handle the OTBM_ITEM node itself.
+    // Writes a complete OTBM_ITEM node (see Item::serializeOtbmNode).
     void writeItemNode(const Item* item, quint32 mapOtbmFormatVersion, quint32 otbItemsMajorVersion, quint32 otbItemsMinorVersion);
 
-    QDataStream& stream() { return m_stream; }
+    // Appends bytes that are already OTBM-encoded, e.g. the buffer of another writer.
+    void writeEncoded(QByteArrayView encoded);
+
+    const QByteArray& data() const { return buffer_; }
+    qsizetype size() const { return buffer_.size(); }
+    bool isEmpty() const { return buffer_.isEmpty(); }
+    void clear() { buffer_.clear(); }
+    void reserve(qsizetype size) { buffer_.reserve(size); }
 
 private:
-    QDataStream& m_stream;
+    void writeEscaped(const char* data, qsizetype size);
+
+    QByteArray buffer_;
 };
 
 #endif // OTBMWRITER_H
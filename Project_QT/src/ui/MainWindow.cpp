@@ -30,6 +30,16 @@
 #include <QSettings>                // For saving/restoring state
 #include <QByteArray>               // For saving/restoring state
 #include <QCloseEvent>              // For closeEvent
+#include <QFileDialog>              // For File -> Open
+#include <QFileInfo>
+#include <QMessageBox>
+#include <QProgressDialog>          // Map loading progress
+#include <QBuffer>                  // For the save round trip test
+#include "io/MapLoader.h"           // Background map loading
+#include "MapView.h"
+#include "BrushManager.h"
+#include "SpriteManager.h"
+#include <QUndoStack>
 // QDebug is already included via QAction or similar Qt headers usually, but explicit include is fine if needed
 
 
@@ -38,6 +48,14 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     resize(1280, 720);
 
     internalClipboard_ = new ClipboardData();
+    brushManager_ = new BrushManager(this);
+    spriteManager_ = new SpriteManager(this);
+    undoStack_ = new QUndoStack(this);
+
+    mapLoader_ = new MapLoader(this); // Waits for a running load when destroyed
+    connect(mapLoader_, &MapLoader::progressChanged, this, &MainWindow::onMapLoadProgress);
+    connect(mapLoader_, &MapLoader::finished, this, &MainWindow::onMapLoaded);
+    connect(mapLoader_, &MapLoader::failed, this, &MainWindow::onMapLoadFailed);
 
     setupMenuBar();
     setupToolBars(); 
@@ -100,6 +118,9 @@ void MainWindow::setupMenuBar() {
         QAction* testTilePropsAction = new QAction(tr("Test Update Tile Properties"), this);
         connect(testTilePropsAction, &QAction::triggered, this, &MainWindow::onTestUpdateTileProperties);
         experimentalMenu->addAction(testTilePropsAction);
+        QAction* testRoundTripAction = new QAction(tr("Test Save Round Trip"), this);
+        connect(testRoundTripAction, &QAction::triggered, this, &MainWindow::onTestSaveRoundTrip);
+        experimentalMenu->addAction(testRoundTripAction);
     } else {
         qWarning() << "Could not find Experimental menu to add 'Test Update Tile Properties' action. Creating Debug menu.";
         QMenu* debugMenu = menuBar_ ? menuBar_->addMenu(tr("&Debug")) : nullptr;
@@ -107,6 +128,9 @@ void MainWindow::setupMenuBar() {
             QAction* testTilePropsAction = new QAction(tr("Test Update Tile Properties"), this);
             connect(testTilePropsAction, &QAction::triggered, this, &MainWindow::onTestUpdateTileProperties);
             debugMenu->addAction(testTilePropsAction);
+            QAction* testRoundTripAction = new QAction(tr("Test Save Round Trip"), this);
+            connect(testRoundTripAction, &QAction::triggered, this, &MainWindow::onTestSaveRoundTrip);
+            debugMenu->addAction(testRoundTripAction);
         } else {
             qWarning() << "Could not add Test Tile Properties action to any menu.";
         }
@@ -254,6 +278,7 @@ QMenu* MainWindow::createFileMenu() {
     fileMenu->addAction(newAction_);
     openAction_ = createAction("&Open...", "OPEN", QIcon::fromTheme("document-open"), QKeySequence::Open, "Open another map.");
     fileMenu->addAction(openAction_);
+    fileMenu->addAction(createAction("Open for &Quick Edit...", "OPEN_ON_DEMAND", QIcon::fromTheme("document-open"), "", "Open a map and only load the regions that are viewed or edited."));
     saveAction_ = createAction("&Save", "SAVE", QIcon::fromTheme("document-save"), QKeySequence::Save, "Save the current map.");
     fileMenu->addAction(saveAction_);
     fileMenu->addAction(createAction("Save &As...", "SAVE_AS", QIcon::fromTheme("document-save-as"), QKeySequence::SaveAs, "Save the current map as a new file."));
@@ -780,7 +805,18 @@ void MainWindow::onMenuActionTriggered() {
     }
     // Placeholder command handlers for common actions from menubar.xml
     else if (actionName == QLatin1String("NEW")) { qDebug() << "Placeholder: File -> New action triggered."; }
-    else if (actionName == QLatin1String("OPEN")) { qDebug() << "Placeholder: File -> Open action triggered."; }
+    else if (actionName == QLatin1String("OPEN")) {
+        const QString path = QFileDialog::getOpenFileName(this, tr("Open Map"), QString(), tr("OpenTibia Binary Map (*.otbm *.otbm.gz);;All Files (*)"));
+        if (!path.isEmpty()) {
+            openMap(path, MapLoadMode::Full);
+        }
+    }
+    else if (actionName == QLatin1String("OPEN_ON_DEMAND")) {
+        const QString path = QFileDialog::getOpenFileName(this, tr("Open Map for Quick Edit"), QString(), tr("OpenTibia Binary Map (*.otbm *.otbm.gz);;All Files (*)"));
+        if (!path.isEmpty()) {
+            openMap(path, MapLoadMode::OnDemand);
+        }
+    }
     else if (actionName == QLatin1String("SAVE")) { qDebug() << "Placeholder: File -> Save action triggered."; }
     else if (actionName == QLatin1String("SAVE_AS")) { qDebug() << "Placeholder: File -> Save As action triggered."; }
     else if (actionName == QLatin1String("UNDO")) { qDebug() << "Placeholder: Edit -> Undo action triggered."; }
@@ -971,11 +1007,8 @@ bool MainWindow::canPaste() const {
 
 // --- Stubbed Helper Methods for Clipboard ---
 
-Map* MainWindow::getCurrentMap() const { 
-    qDebug("MainWindow::getCurrentMap (stub) - returning nullptr for now."); 
-    // In a real app, this would return a pointer to the currently active Map object.
-    // For example: return currentMapDocument_ ? currentMapDocument_->getMap() : nullptr;
-    return nullptr; 
+Map* MainWindow::getCurrentMap() const {
+    return currentMap_;
 }
 
 MapPos MainWindow::getPasteTargetPosition() const { 
@@ -1028,6 +1061,9 @@ void MainWindow::showTemporaryStatusMessage(const QString& message, int timeout)
 
 // State Saving and Restoring
 void MainWindow::closeEvent(QCloseEvent *event) {
+    if (mapLoader_ && mapLoader_->isRunning()) {
+        mapLoader_->cancel(); // ~MapLoader waits for the worker to notice
+    }
     saveToolBarState();
     QMainWindow::closeEvent(event); // Important to call base class
 }
@@ -1170,38 +1206,35 @@ void MainWindow::restoreToolBarState() {
 }
 
 void MainWindow::onTestUpdateTileProperties() {
-    // Create a couple of static dummy Tile objects for testing persistence across calls
-    static Tile testTile1(100, 200, 7); // Parentless for this static test case
-    static bool tile1Initialized = false;
-    if (!tile1Initialized) {
-        testTile1.setHouseId(123);
-        testTile1.setPZ(true);
-        testTile1.addZoneId(10);
-        testTile1.addZoneId(15);
-
+    // Tiles only exist inside a Map (positions and zone ids live in its chunks), so the test
+    // tiles are placed on a small scratch map that persists across calls.
+    static Map testMap(256, 256, MAP_MAX_FLOORS);
+    static Tile* testTile1 = nullptr;
+    if (!testTile1) {
+        testTile1 = testMap.createTile(100, 200, 7);
+        testTile1->setHouseId(123);
+        testTile1->setPZ(true);
+        testTile1->addZoneId(10);
+        testTile1->addZoneId(15);
+
+        MapArena::Scope arenaScope(testMap.arena());
         Item* dummyGround = new Item(357); // Example ground item ID
-        // dummyGround->setParent(&testTile1); // This would make Tile a QObject, which it is now.
-        testTile1.setGround(dummyGround); // Tile takes ownership if designed so. Current Tile destructor deletes ground_.
+        testTile1->setGround(dummyGround); // Tile takes ownership
 
-        // testTile1.setMapFlag(TileMapFlags::Modified, true); // Assuming TileMapFlags is the enum type
-        // testTile1.setMapFlag(TileMapFlags::Selected, true);
-        testTile1.setModified(true); // Use existing setters if available
-        testTile1.setSelected(true); // Use existing setters if available
+        testTile1->setModified(true);
+        testTile1->setSelected(true);
 
-
-        testTile1.setStateFlag(Tile::TileStateFlag::HasTable, true); // Example state flag
-        tile1Initialized = true;
+        testTile1->setStateFlag(Tile::TileStateFlag::HasTable, true); // Example state flag
         qDebug() << "Initialized Test Tile 1";
     }
 
-    static Tile testTile2(55, 65, 6);
-    static bool tile2Initialized = false;
-    if (!tile2Initialized) {
-        testTile2.setNoPVP(true);
-        testTile2.addZoneId(99);
+    static Tile* testTile2 = nullptr;
+    if (!testTile2) {
+        testTile2 = testMap.createTile(55, 65, 6);
+        testTile2->setNoPVP(true);
+        testTile2->addZoneId(99);
         // No ground for this one to test itemCount variation
-        testTile2.setStateFlag(Tile::TileStateFlag::HasCarpet, true);
-        tile2Initialized = true;
+        testTile2->setStateFlag(Tile::TileStateFlag::HasCarpet, true);
         qDebug() << "Initialized Test Tile 2";
     }
 
@@ -1209,8 +1242,8 @@ void MainWindow::onTestUpdateTileProperties() {
     static int testState = 0;
     Tile* tileToDisplay = nullptr;
     switch (testState) {
-        case 0: tileToDisplay = &testTile1; qDebug() << "Testing with Tile 1"; break;
-        case 1: tileToDisplay = &testTile2; qDebug() << "Testing with Tile 2"; break;
+        case 0: tileToDisplay = testTile1; qDebug() << "Testing with Tile 1"; break;
+        case 1: tileToDisplay = testTile2; qDebug() << "Testing with Tile 2"; break;
         case 2: tileToDisplay = nullptr;    qDebug() << "Testing with nullptr Tile"; break;
     }
     testState = (testState + 1) % 3;
@@ -1228,6 +1261,72 @@ void MainWindow::onTestUpdateTileProperties() {
     }
 }
 
+void MainWindow::onTestSaveRoundTrip() {
+    // Without an open map, a scratch map with a few grounds and items stands in for it.
+    Map scratchMap(256, 256, MAP_MAX_FLOORS);
+    Map* map = currentMap_;
+    if (!map) {
+        map = &scratchMap;
+        MapArena::Scope arenaScope(scratchMap.arena());
+        for (int i = 0; i < 4; ++i) {
+            Tile* tile = scratchMap.createTile(10 + i * 100, 20 + i * 50, 7 - i);
+            tile->setGround(new Item(static_cast<quint16>(351 + i))); // Example ground item IDs
+            if (i % 2 == 0) {
+                tile->addItem(new Item(1987)); // Example item ID
+            }
+        }
+    }
+
+    // Server ids of a tile's stack as saved: ground first, then the items bottom to top.
+    auto stackOf = [](const Tile* tile) {
+        QVector<quint16> stack;
+        if (const Item* ground = tile->getGround()) {
+            stack.append(ground->getServerId());
+        }
+        for (const Item* item : tile->getItems()) {
+            if (item) {
+                stack.append(item->getServerId());
+            }
+        }
+        return stack;
+    };
+
+    // Every area is marked dirty so none of it comes from the save cache.
+    map->loadAllTileAreas();
+    const QRect wholeMap(0, 0, map->width(), map->height());
+    for (int z = 0; z < map->floors(); ++z) {
+        map->forEachTileIn(wholeMap, z, [map, z](Tile*, int x, int y) { map->markTileAreaDirty(x, y, z); });
+    }
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    Map reloaded;
+    if (!map->saveToOTBM(buffer) || !reloaded.loadFromOTBM(buffer.data())) {
+        QMessageBox::warning(this, tr("Save Round Trip"), tr("Could not save or reload the map."));
+        return;
+    }
+
+    int tiles = 0;
+    int mismatches = 0;
+    for (int z = 0; z < map->floors(); ++z) {
+        map->forEachTileIn(wholeMap, z, [&](Tile* tile, int x, int y) {
+            ++tiles;
+            const Tile* copy = reloaded.getTile(x, y, z);
+            if (!copy || stackOf(copy) != stackOf(tile)) {
+                if (++mismatches <= 10) {
+                    qWarning() << "MainWindow::onTestSaveRoundTrip - Tile" << x << y << z << "saved" << stackOf(tile)
+                               << "but reads back as" << (copy ? stackOf(copy) : QVector<quint16>());
+                }
+            }
+        });
+    }
+    qDebug() << "MainWindow::onTestSaveRoundTrip -" << tiles << "tiles," << mismatches << "mismatches.";
+    if (mismatches > 0) {
+        QMessageBox::warning(this, tr("Save Round Trip"), tr("%1 of %2 tiles differ after saving and reloading.").arg(mismatches).arg(tiles));
+    } else {
+        showTemporaryStatusMessage(tr("Save round trip: all %1 tiles match").arg(tiles), 5000);
+    }
+}
+
 void MainWindow::onShowReplaceItemsDialog() {
     qDebug() << "Showing ReplaceItemsDialog...";
     ReplaceItemsDialog dialog(this); // Parent the dialog to MainWindow
@@ -1236,3 +1335,77 @@ void MainWindow::onShowReplaceItemsDialog() {
     qDebug() << "ReplaceItemsDialog closed with result:" << result;
     // result will be QDialog::Accepted or QDialog::Rejected if dialog uses accept()/reject()
 }
+
+// --- Map Loading ---
+
+void MainWindow::openMap(const QString& path, MapLoadMode mode) {
+    if (mapLoader_->isRunning()) {
+        showTemporaryStatusMessage(tr("Already opening %1").arg(QFileInfo(mapLoader_->path()).fileName()), 3000);
+        return;
+    }
+    if (!mapLoader_->start(path, mode)) {
+        return;
+    }
+
+    // Non-modal, so the rest of the editor stays usable while a large map loads.
+    loadProgressDialog_ = new QProgressDialog(tr("Opening %1...").arg(QFileInfo(path).fileName()), tr("Cancel"), 0, 1000, this);
+    loadProgressDialog_->setWindowTitle(tr("Open Map"));
+    loadProgressDialog_->setAutoClose(false);
+    loadProgressDialog_->setAutoReset(false);
+    loadProgressDialog_->setMinimumDuration(300);
+    loadProgressDialog_->setValue(0);
+    connect(loadProgressDialog_, &QProgressDialog::canceled, mapLoader_, &MapLoader::cancel);
+    showTemporaryStatusMessage(tr("Opening %1...").arg(path));
+}
+
+void MainWindow::onMapLoadProgress(qint64 bytesConsumed, qint64 bytesTotal, int areasDecoded, int areaCount) {
+    if (!loadProgressDialog_ || bytesTotal <= 0) {
+        return;
+    }
+    loadProgressDialog_->setValue(static_cast<int>(bytesConsumed * 1000 / bytesTotal));
+    if (areaCount > 0) {
+        loadProgressDialog_->setLabelText(tr("Opening %1...\nDecoded %2 of %3 areas (%4 of %5 MB)")
+                                              .arg(QFileInfo(mapLoader_->path()).fileName())
+                                              .arg(areasDecoded).arg(areaCount)
+                                              .arg(bytesConsumed / (1024 * 1024)).arg(bytesTotal / (1024 * 1024)));
+    }
+}
+
+void MainWindow::onMapLoaded(Map* map) {
+    if (loadProgressDialog_) {
+        loadProgressDialog_->deleteLater(); // Also hidden already if it was canceled
+        loadProgressDialog_ = nullptr;
+    }
+
+    // The map arrives fully built; swap it in only now so the old one stays usable until then.
+    Map* previous = currentMap_;
+    map->setParent(this);
+    currentMap_ = map;
+    if (!mapView_) {
+        mapView_ = new MapView(brushManager_, currentMap_, undoStack_, this);
+        mapView_->setSpriteManager(spriteManager_);
+        setCentralWidget(mapView_);
+        connect(this, &MainWindow::currentMapChanged, mapView_, &MapView::setMap);
+    }
+    emit currentMapChanged(currentMap_);
+    // Undo commands hold tiles and items of the previous map; drop them before the map goes.
+    undoStack_->clear();
+    if (previous) {
+        previous->deleteLater();
+    }
+
+    showTemporaryStatusMessage(tr("Opened %1 (%2 tiles)").arg(mapLoader_->path()).arg(map->tileCount()), 5000);
+}
+
+void MainWindow::onMapLoadFailed(const QString& path, bool canceled) {
+    if (loadProgressDialog_) {
+        loadProgressDialog_->deleteLater(); // Also hidden already if it was canceled
+        loadProgressDialog_ = nullptr;
+    }
+
+    if (canceled) {
+        showTemporaryStatusMessage(tr("Opening %1 was canceled.").arg(path), 5000);
+    } else {
+        QMessageBox::warning(this, tr("Open Map"), tr("Could not open %1.").arg(path));
+    }
+}
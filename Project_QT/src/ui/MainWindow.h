@@ -24,6 +24,13 @@ class ClipboardData;           // Forward declaration for clipboard
 class Map;                     // Already forward declared in Map.h, but good practice if Map.h isn't fully included here
 class Selection;               // Already forward declared in Selection.h, but good practice
 class MapPos;                  // Required for updateMouseMapCoordinates if Map.h doesn't bring it transitively
+class MapLoader;               // Background map loading
+class MapView;
+class BrushManager;
+class SpriteManager;
+class QUndoStack;
+class QProgressDialog;
+enum class MapLoadMode;        // Defined in Map.h (opaque declaration; enumerators need the header)
 
 
 class MainWindow : public QMainWindow {
@@ -55,6 +62,10 @@ public: // Public methods for other status updates if not slots (canPaste kept h
 
     // Automagic settings methods
     void openAutomagicSettingsDialog();
+
+    // Opens a map file on a background thread; the current map is replaced once it has loaded.
+    void openMap(const QString& path, MapLoadMode mode);
+
     bool mainGetAutomagicEnabled() const;
     bool mainGetSameGroundTypeBorderEnabled() const;
     bool mainGetWallsRepelBordersEnabled() const;
@@ -65,6 +76,9 @@ public: // Public methods for other status updates if not slots (canPaste kept h
     void mainUpdateAutomagicSettings(bool automagicEnabled, bool sameGround, bool wallsRepel, bool layerCarpets, bool borderizeDelete, bool customBorder, int customBorderId);
     void mainTriggerMapOrUIRefreshForAutomagic();
 
+signals:
+    void currentMapChanged(Map* map); // The previous map is deleted (deleteLater) right after this is emitted
+
 protected:
     void closeEvent(QCloseEvent *event) override;
 
@@ -82,7 +96,14 @@ private slots:
     void onBrushSizeActionTriggered();
     // Slot for testing TilePropertyEditor
     void onTestUpdateTileProperties();
+    // Re-encodes every tile area of the current map (or a scratch map), reads the result back
+    // and compares the item stacks, ground included
+    void onTestSaveRoundTrip();
     void onShowReplaceItemsDialog();
+    // Map loading
+    void onMapLoadProgress(qint64 bytesConsumed, qint64 bytesTotal, int areasDecoded, int areaCount);
+    void onMapLoaded(Map* map);
+    void onMapLoadFailed(const QString& path, bool canceled);
 
 private:
     // Main setup methods
@@ -177,6 +198,15 @@ private:
     // Internal clipboard
     ClipboardData* internalClipboard_ = nullptr;
 
+    // Current map and its background loader
+    Map* currentMap_ = nullptr;           // Owned (QObject child) once loaded
+    MapView* mapView_ = nullptr;          // Central widget, created with the first loaded map
+    BrushManager* brushManager_ = nullptr;
+    SpriteManager* spriteManager_ = nullptr; // Client sprites the map view draws with
+    QUndoStack* undoStack_ = nullptr;     // Commands refer to currentMap_; cleared when it is replaced
+    MapLoader* mapLoader_ = nullptr;
+    QProgressDialog* loadProgressDialog_ = nullptr; // Visible while mapLoader_ runs
+
     // Stubbed helper methods for map/position access (can be private)
 // private: // Making them private as they are internal helpers for clipboard ops
     Map* getCurrentMap() const; 
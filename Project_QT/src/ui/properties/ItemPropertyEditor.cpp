@@ -24,12 +24,9 @@ ItemPropertyEditor::~ItemPropertyEditor() {
 void ItemPropertyEditor::setEditingObject(QObject* object) {
     // Store the generic QObject pointer in the base class member
     m_editingObject = object;
+    m_currentItem = nullptr;
 
-    Item* item = qobject_cast<Item*>(object);
-
-    if (item) {
-        qDebug() << "ItemPropertyEditor: Editing item with ID:" << item->getServerId() << "Name:" << item->name();
-    } else if (object) {
+    if (object) {
         qDebug() << "ItemPropertyEditor: Received a QObject that is not an Item. ClassName:" << object->metaObject()->className();
     } else {
         qDebug() << "ItemPropertyEditor: Editing object set to nullptr.";
@@ -38,15 +35,27 @@ void ItemPropertyEditor::setEditingObject(QObject* object) {
     loadPropertiesFromObject();
 }
 
+void ItemPropertyEditor::setEditingItem(Item* item) {
+    m_editingObject = nullptr;
+    m_currentItem = item;
+
+    if (item) {
+        qDebug() << "ItemPropertyEditor: Editing item with ID:" << item->getServerId() << "Name:" << item->name();
+    } else {
+        qDebug() << "ItemPropertyEditor: Editing item set to nullptr.";
+    }
+    loadPropertiesFromObject();
+}
+
 void ItemPropertyEditor::loadPropertiesFromObject() {
-    if (!m_editingObject) {
+    if (!m_editingObject && !m_currentItem) {
         qDebug() << "ItemPropertyEditor::loadPropertiesFromObject: No object to load from.";
         m_placeholderLabel->setText("No item selected.");
         // In a real implementation, disable UI elements or clear them.
         return;
     }
 
-    Item* item = qobject_cast<Item*>(m_editingObject);
+    Item* item = m_currentItem;
     if (item) {
         qDebug() << "ItemPropertyEditor::loadPropertiesFromObject: Called for Item ID:" << item->getServerId();
         m_placeholderLabel->setText(QString("Editing Item: %1 (ID: %2)")
@@ -61,16 +70,16 @@ void ItemPropertyEditor::loadPropertiesFromObject() {
 }
 
 void ItemPropertyEditor::savePropertiesToObject() {
-    if (!m_editingObject) {
+    if (!m_editingObject && !m_currentItem) {
         qDebug() << "ItemPropertyEditor::savePropertiesToObject: No object to save to.";
         return;
     }
 
-    Item* item = qobject_cast<Item*>(m_editingObject);
+    Item* item = m_currentItem;
     if (item) {
         qDebug() << "ItemPropertyEditor::savePropertiesToObject: Called for Item ID:" << item->getServerId();
         // In a real implementation, get values from UI fields and set them on 'item'.
-        // e.g., item->setName(m_nameLineEdit->text());
+        // e.g., item->setText(m_textLineEdit->text());
         // This should ideally create an QUndoCommand.
     } else {
          qDebug() << "ItemPropertyEditor::savePropertiesToObject: Editing object is not an Item. ClassName:" << m_editingObject->metaObject()->className();
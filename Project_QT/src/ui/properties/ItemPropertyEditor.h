@@ -20,12 +20,15 @@ public:
     void loadPropertiesFromObject() override;
     void savePropertiesToObject() override;
 
+    // Items are not QObjects, so they are handed over directly rather than via setEditingObject().
+    void setEditingItem(Item* item);
+
     // Override hasPendingChanges if specific logic is needed, otherwise base impl is fine for a stub
     // bool hasPendingChanges() const override;
 
 private:
     QLabel* m_placeholderLabel = nullptr; // Initialize to nullptr
-    // Item* m_currentItem = nullptr; // Optional: store the casted object if frequently accessed
+    Item* m_currentItem = nullptr; // Not owned
 };
 
 #endif // ITEMPROPERTYEDITOR_H
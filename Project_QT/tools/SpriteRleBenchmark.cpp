@@ -0,0 +1,165 @@
+// Times SpriteRleDecoder::decode() (the SIMD path picked for this CPU) and decodeScalar()
+// against the per-pixel decoder SpriteManager used before them, on synthetic sprites, and
+// checks that decode() and decodeScalar() produce the same pixels.
+//
+// Usage: sprite_rle_benchmark [iterations]
+
+#include "SpriteRleDecoder.h"
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QVector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring> // For memcmp
+#include <algorithm> // For std::fill
+
+namespace {
+
+constexpr int SpriteCount = 4096;
+
+// Builds RLE data in the SPR layout: alternating transparent and colored runs covering the
+// whole sprite. Run lengths resemble item sprites (short transparent gaps, colored runs of a
+// few to a few dozen pixels); with alpha, about one pixel in eight is translucent.
+QByteArray makeSprite(QRandomGenerator& random, bool hasAlpha) {
+    QByteArray data;
+    auto appendU16 = [&data](int value) {
+        data.append(char(value & 0xFF));
+        data.append(char(value >> 8));
+    };
+    int pixel = 0;
+    while (pixel < SpriteRleDecoder::PixelCount) {
+        const int transparent = qMin(random.bounded(12), SpriteRleDecoder::PixelCount - pixel);
+        appendU16(transparent);
+        pixel += transparent;
+        if (pixel >= SpriteRleDecoder::PixelCount) {
+            break;
+        }
+        const int colored = qMin(1 + random.bounded(48), SpriteRleDecoder::PixelCount - pixel);
+        appendU16(colored);
+        for (int i = 0; i < colored; ++i) {
+            const quint32 rgb = random.generate();
+            data.append(char(rgb));
+            data.append(char(rgb >> 8));
+            data.append(char(rgb >> 16));
+            if (hasAlpha) {
+                data.append(char(random.bounded(8) == 0 ? random.bounded(255) : 255));
+            }
+        }
+        pixel += colored;
+    }
+    return data;
+}
+
+// The loop of the old SpriteManager::decodeSpriteRleData, minus its warnings (the sprites
+// here are well-formed) and writing into out instead of a fresh QImage; the QImage is
+// allocated the same way on either side, so it is left out. Like the original it clears the
+// sprite first, checks the input for every pixel and does not premultiply translucent
+// pixels, so its RGBA output is not compared.
+bool decodeBaseline(QByteArrayView rleData, bool hasAlpha, quint32* out) {
+    std::fill(out, out + SpriteRleDecoder::PixelCount, 0u); // image.fill(Qt::transparent)
+    uchar* imageData = reinterpret_cast<uchar*>(out);
+    const uchar* rleBytes = reinterpret_cast<const uchar*>(rleData.data());
+    const int rleSize = int(rleData.size());
+    const int bytesPerPixel = hasAlpha ? 4 : 3;
+    int rleIdx = 0;
+    int currentPixel = 0;
+
+    while (rleIdx < rleSize && currentPixel < SpriteRleDecoder::PixelCount) {
+        if (rleIdx + 1 >= rleSize) {
+            break;
+        }
+        const quint16 transparentPixels = quint16(rleBytes[rleIdx] | (rleBytes[rleIdx + 1] << 8));
+        rleIdx += 2;
+        currentPixel += transparentPixels;
+        if (currentPixel > SpriteRleDecoder::PixelCount && transparentPixels > 0) {
+            currentPixel = SpriteRleDecoder::PixelCount;
+        }
+        if (currentPixel >= SpriteRleDecoder::PixelCount || rleIdx >= rleSize) {
+            break;
+        }
+
+        if (rleIdx + 1 >= rleSize) {
+            break;
+        }
+        const quint16 coloredPixels = quint16(rleBytes[rleIdx] | (rleBytes[rleIdx + 1] << 8));
+        rleIdx += 2;
+        for (quint16 i = 0; i < coloredPixels; ++i) {
+            if (currentPixel >= SpriteRleDecoder::PixelCount) {
+                break;
+            }
+            if (rleIdx + bytesPerPixel > rleSize) {
+                rleIdx = rleSize;
+                break;
+            }
+            const int imgByteIdx = currentPixel * 4;
+            imageData[imgByteIdx + 2] = rleBytes[rleIdx + 0]; // Red
+            imageData[imgByteIdx + 1] = rleBytes[rleIdx + 1]; // Green
+            imageData[imgByteIdx + 0] = rleBytes[rleIdx + 2]; // Blue
+            imageData[imgByteIdx + 3] = hasAlpha ? rleBytes[rleIdx + 3] : 255; // Alpha
+            rleIdx += bytesPerPixel;
+            currentPixel++;
+        }
+    }
+    return true;
+}
+
+using DecodeFunction = bool (*)(QByteArrayView rleData, bool hasAlpha, quint32* out);
+
+// Decodes every sprite iterations times; returns the time per sprite in nanoseconds.
+double measure(DecodeFunction decode, const QVector<QByteArray>& sprites, bool hasAlpha, int iterations) {
+    quint32 pixels[SpriteRleDecoder::PixelCount];
+    QElapsedTimer timer;
+    timer.start();
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        for (const QByteArray& sprite : sprites) {
+            decode(sprite, hasAlpha, pixels);
+        }
+    }
+    return double(timer.nsecsElapsed()) / (double(iterations) * sprites.size());
+}
+
+bool sameOutput(DecodeFunction a, DecodeFunction b, const QVector<QByteArray>& sprites, bool hasAlpha) {
+    quint32 pixelsA[SpriteRleDecoder::PixelCount];
+    quint32 pixelsB[SpriteRleDecoder::PixelCount];
+    for (const QByteArray& sprite : sprites) {
+        a(sprite, hasAlpha, pixelsA);
+        b(sprite, hasAlpha, pixelsB);
+        if (memcmp(pixelsA, pixelsB, sizeof(pixelsA)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int iterations = argc > 1 ? qMax(1, atoi(argv[1])) : 50;
+    QRandomGenerator random(0x5EED); // Same sprites on every run
+    std::printf("SpriteRleDecoder: %d sprites x %d iterations, decode() uses %s\n",
+                SpriteCount, iterations, SpriteRleDecoder::instructionSet());
+
+    bool identical = true;
+    for (const bool hasAlpha : { false, true }) {
+        QVector<QByteArray> sprites;
+        sprites.reserve(SpriteCount);
+        for (int i = 0; i < SpriteCount; ++i) {
+            sprites.append(makeSprite(random, hasAlpha));
+        }
+        const char* format = hasAlpha ? "RGBA" : "RGB";
+        if (!sameOutput(SpriteRleDecoder::decode, SpriteRleDecoder::decodeScalar, sprites, hasAlpha) ||
+            (!hasAlpha && !sameOutput(SpriteRleDecoder::decode, decodeBaseline, sprites, hasAlpha))) {
+            std::printf("%s: the decoders' output differs!\n", format);
+            identical = false;
+            continue;
+        }
+        measure(SpriteRleDecoder::decode, sprites, hasAlpha, 1); // Warm-up
+        const double baseline = measure(decodeBaseline, sprites, hasAlpha, iterations);
+        const double scalar = measure(SpriteRleDecoder::decodeScalar, sprites, hasAlpha, iterations);
+        const double simd = measure(SpriteRleDecoder::decode, sprites, hasAlpha, iterations);
+        std::printf("%-4s  per-pixel (old) %8.1f ns/sprite   decodeScalar %8.1f ns/sprite (%.2fx)   decode %8.1f ns/sprite (%.2fx)\n",
+                    format, baseline, scalar, baseline / scalar, simd, baseline / simd);
+    }
+    return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}